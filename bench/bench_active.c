@@ -0,0 +1,133 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Cost of the guard conditions of a hot handler: HSM_IsInState() on states of a chart with two branches of
+// "depth" states, and the test whether the instance is in any of several states.  Build with
+// -DHSM_FEATURE_ACTIVE_SET=0 or 1 to compare the walk up the parents with the bit tests of the active set, which
+// also shows the cost of updating the active set in HSM_Tran().
+// Usage: active_walk|active_set [depth]
+#include "hsm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_ITERATIONS    2000000
+#define BENCH_GUARDS        4
+#define BENCH_ANY           2
+
+static HSM_STATE astBranchA[HSM_MAX_DEPTH];
+static HSM_STATE astBranchB[HSM_MAX_DEPTH];
+static HSM_STATE *apGuard[BENCH_GUARDS];
+#if HSM_FEATURE_ACTIVE_SET
+static HSM_STATE_SET stAny;
+#endif // HSM_FEATURE_ACTIVE_SET
+
+static HSM_EVENT BENCH_StateHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    return event;
+}
+
+static double BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint8_t BENCH_IsInAny(HSM *This)
+{
+#if HSM_FEATURE_ACTIVE_SET
+    return HSM_IsInAnyState(This, &stAny);
+#else
+    uint8_t idx;
+    for (idx = 0; idx < BENCH_ANY; idx++)
+    {
+        if (HSM_IsInState(This, apGuard[idx]))
+        {
+            return 1;
+        }
+    }
+    return 0;
+#endif // HSM_FEATURE_ACTIVE_SET
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t uDepth = (argc > 1) ? atoi(argv[1]) : HSM_MAX_DEPTH - 1;
+    HSM stHsm;
+    uint32_t hits = 0;
+    uint32_t any = 0;
+    uint32_t iter;
+    uint8_t idx;
+    double start;
+    double guard;
+    double anyOf;
+    double tran;
+
+    if (uDepth < 2 || uDepth >= HSM_MAX_DEPTH)
+    {
+        printf("depth must be 2 to %u\n", HSM_MAX_DEPTH - 1);
+        return 1;
+    }
+    for (idx = 0; idx < uDepth; idx++)
+    {
+        HSM_STATE_Create(&astBranchA[idx], "A", BENCH_StateHndlr, idx ? &astBranchA[idx - 1] : NULL);
+        HSM_STATE_Create(&astBranchB[idx], "B", BENCH_StateHndlr, idx ? &astBranchB[idx - 1] : NULL);
+    }
+    // Guards on the leaf and the top of each branch, half of them true
+    apGuard[0] = &astBranchB[uDepth - 1];
+    apGuard[1] = &astBranchB[0];
+    apGuard[2] = &astBranchA[0];
+    apGuard[3] = &astBranchA[uDepth - 1];
+#if HSM_FEATURE_ACTIVE_SET
+    // The guards of branch B
+    HSM_STATE_SET_Create(&stAny, apGuard, BENCH_ANY);
+#endif // HSM_FEATURE_ACTIVE_SET
+    HSM_Create(&stHsm, "Bench", &astBranchA[uDepth - 1]);
+
+    start = BENCH_Now();
+    for (iter = 0; iter < BENCH_ITERATIONS; iter++)
+    {
+        hits += HSM_IsInState(&stHsm, apGuard[iter % BENCH_GUARDS]);
+    }
+    guard = BENCH_Now() - start;
+
+    // In any of the states of branch B, which walks the whole branch A for each of them
+    start = BENCH_Now();
+    for (iter = 0; iter < BENCH_ITERATIONS; iter++)
+    {
+        any += BENCH_IsInAny(&stHsm);
+    }
+    anyOf = BENCH_Now() - start;
+
+    start = BENCH_Now();
+    for (iter = 0; iter < BENCH_ITERATIONS / 4; iter++)
+    {
+        HSM_Tran(&stHsm, (iter & 1) ? &astBranchA[uDepth - 1] : &astBranchB[uDepth - 1], 0, NULL);
+    }
+    tran = BENCH_Now() - start;
+
+    printf("active set:%d depth:%u  isInState %5.1f ns  isInAny %5.1f ns  tran %6.1f ns  hits:%u any:%u\n",
+           HSM_FEATURE_ACTIVE_SET, uDepth, guard / BENCH_ITERATIONS, anyOf / BENCH_ITERATIONS,
+           tran * 4 / BENCH_ITERATIONS, hits, any);
+    return 0;
+}
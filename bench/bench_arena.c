@@ -0,0 +1,152 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Cost of allocating the params of the events: each poster mallocs a payload freed by the handler, compared with
+// payloads from the arena of the instance, released at once when the cycle ends.  The events are posted in batches
+// drained by HSM_Dispatch(), and run one at a time with HSM_Run().  A static payload, never allocated, gives the
+// cost of the event path itself.
+// Usage: arena [events] [batch]
+#include "hsm_arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_EVT_DATA      (HSME_START)
+#define BENCH_ALLOC_STATIC  0
+#define BENCH_ALLOC_MALLOC  1
+#define BENCH_ALLOC_ARENA   2
+
+typedef struct BENCH_MSG_T
+{
+    uint32_t seq;
+    uint32_t len;               // Bytes of data
+    uint8_t data[];
+} BENCH_MSG;
+
+static HSM_STATE BENCH_StateRx;
+static uint8_t ucAlloc;
+static uint64_t ulSum;
+static uint8_t aucStatic[512];
+static uint8_t aucArena[16384];
+
+static HSM_EVENT BENCH_StateRxHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_DATA)
+    {
+        BENCH_MSG *msg = (BENCH_MSG *)param;
+        ulSum += msg->seq + msg->data[msg->len - 1];
+        if (ucAlloc == BENCH_ALLOC_MALLOC)
+        {
+            free(msg);
+        }
+        return 0;
+    }
+    return event;
+}
+
+static double BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Payloads of 16 to 208 bytes of data
+static BENCH_MSG *BENCH_NewMsg(HSM *hsm, uint32_t seq)
+{
+    uint32_t len = 16 + (seq * 40) % 193;
+    BENCH_MSG *msg;
+    if (ucAlloc == BENCH_ALLOC_MALLOC)
+    {
+        msg = malloc(sizeof(BENCH_MSG) + len);
+    }
+    else if (ucAlloc == BENCH_ALLOC_ARENA)
+    {
+        msg = HSM_ParamAlloc(hsm, sizeof(BENCH_MSG) + len);
+    }
+    else
+    {
+        msg = (BENCH_MSG *)aucStatic;
+    }
+    msg->seq = seq;
+    msg->len = len;
+    msg->data[len - 1] = (uint8_t)seq;
+    return msg;
+}
+
+// Returns ns per event
+static double BENCH_Run(HSM *hsm, uint8_t alloc, uint32_t events, uint32_t batch)
+{
+    uint32_t idx;
+    uint32_t cnt;
+    double start;
+    ucAlloc = alloc;
+    start = BENCH_Now();
+    for (idx = 0; idx < events; idx += batch)
+    {
+        if (batch == 1)
+        {
+            HSM_Run(hsm, BENCH_EVT_DATA, BENCH_NewMsg(hsm, idx));
+            continue;
+        }
+        for (cnt = 0; cnt < batch; cnt++)
+        {
+            HSM_Post(hsm, BENCH_EVT_DATA, BENCH_NewMsg(hsm, idx + cnt));
+        }
+        HSM_Dispatch(hsm);
+    }
+    return (BENCH_Now() - start) / events;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t events = (argc > 1) ? atoi(argv[1]) : 10000000;
+    uint32_t batch = (argc > 2) ? atoi(argv[2]) : HSM_QUEUE_DEPTH;
+    uint32_t sizes[2] = { 1, batch };
+    HSM_ARENA stArena;
+    HSM_ARENA_STATS stats;
+    HSM stHsm;
+    uint32_t idx;
+    double base;
+    double heap;
+    double arena;
+    HSM_STATE_Create(&BENCH_StateRx, "Rx", BENCH_StateRxHndlr, NULL);
+    HSM_Create(&stHsm, "Rx", &BENCH_StateRx);
+    HSM_ARENA_Create(&stArena, aucArena, sizeof(aucArena));
+    HSM_ARENA_Attach(&stArena, &stHsm);
+    events -= events % batch;
+    printf("events:%u payload:24..216 bytes\n", events);
+    for (idx = 0; idx < 2; idx++)
+    {
+        base = BENCH_Run(&stHsm, BENCH_ALLOC_STATIC, events, sizes[idx]);
+        heap = BENCH_Run(&stHsm, BENCH_ALLOC_MALLOC, events, sizes[idx]);
+        arena = BENCH_Run(&stHsm, BENCH_ALLOC_ARENA, events, sizes[idx]);
+        printf("%-8s batch:%-3u static %5.1f  malloc %5.1f  arena %5.1f ns/event  alloc: malloc %5.1f  arena %5.1f ns/event\n",
+               sizes[idx] == 1 ? "HSM_Run" : "Dispatch", sizes[idx], base, heap, arena, heap - base, arena - base);
+    }
+    HSM_ARENA_GetStats(&stArena, &stats, 0);
+    printf("arena: size:%u used:%u highWater:%u overflows:%u allocs:%llu cycles:%llu sum:%llu\n", stats.size,
+           stats.used, stats.highWater, stats.overflows, (unsigned long long)stats.allocs,
+           (unsigned long long)stats.cycles, (unsigned long long)ulSum);
+    return (stats.used || stats.overflows) ? 1 : 0;
+}
@@ -0,0 +1,173 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Events per second of a fleet of identical instances: a loop of HSM_Run() over an array of HSM
+// compared with HSM_RunBatch() over an array of state indexes.  The chart has two parents with four
+// leaves each; PING is handled by the parents, TICK moves each leaf to the next one.
+// Usage: batch [instances] [rounds]
+#include "hsm_batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_EVT_PING      (HSME_START)
+#define BENCH_EVT_TICK      (HSME_START + 1)
+#define BENCH_LEAVES        8
+#define BENCH_REPEAT        5
+
+// States 0 and 1 are the parents, 2 to 9 the leaves
+static HSM_STATE astChart[2 + BENCH_LEAVES];
+static uint32_t *puPings;
+
+static uint32_t BENCH_Instance(HSM *This);
+
+static HSM_EVENT BENCH_StateParentHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_PING)
+    {
+        puPings[BENCH_Instance(This)]++;
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_StateLeafHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_TICK)
+    {
+        uint32_t leaf = This->curState - &astChart[2];
+        HSM_Tran(This, &astChart[2 + (leaf + 1) % BENCH_LEAVES], 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+//----Baseline: one HSM per instance----
+typedef struct BENCH_DEVICE_T
+{
+    HSM parent;
+    uint32_t index;
+} BENCH_DEVICE;
+
+static BENCH_DEVICE *pstDevices;
+static uint8_t bBatch;
+
+static uint32_t BENCH_Instance(HSM *This)
+{
+    return bBatch ? HSM_BATCH_Current(This) : ((BENCH_DEVICE *)This)->index;
+}
+
+static double BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t uInstances = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+    uint32_t uRounds = (argc > 2) ? strtoul(argv[2], NULL, 0) : 10;
+    HSM_BATCH stBatch;
+    HSM_BATCH_IDX *pState = malloc(uInstances * sizeof(HSM_BATCH_IDX));
+    uint32_t idx;
+    uint32_t round;
+    uint32_t repeat;
+    double start;
+    double elapsed;
+    double loop;
+    double batch;
+    uint64_t checkLoop = 0;
+    uint64_t checkBatch = 0;
+    uint8_t evt;
+
+    pstDevices = malloc(uInstances * sizeof(BENCH_DEVICE));
+    puPings = calloc(uInstances, sizeof(uint32_t));
+    HSM_STATE_Create(&astChart[0], "P0", BENCH_StateParentHndlr, NULL);
+    HSM_STATE_Create(&astChart[1], "P1", BENCH_StateParentHndlr, NULL);
+    for (idx = 0; idx < BENCH_LEAVES; idx++)
+    {
+        HSM_STATE_Create(&astChart[2 + idx], "Leaf", BENCH_StateLeafHndlr, &astChart[idx < BENCH_LEAVES / 2 ? 0 : 1]);
+    }
+
+    // Same pseudo-random initial leaf for each instance in both runtimes
+    bBatch = 1;
+    HSM_BATCH_Create(&stBatch, "Fleet", astChart, 2 + BENCH_LEAVES, &astChart[2], pState, uInstances);
+    bBatch = 0;
+    for (idx = 0; idx < uInstances; idx++)
+    {
+        pState[idx] = 2 + (idx * 2654435761u >> 16) % BENCH_LEAVES;
+        pstDevices[idx].index = idx;
+        HSM_Create(&pstDevices[idx].parent, "Device", &astChart[pState[idx]]);
+    }
+
+    printf("instances:%u  sizeof(HSM):%u  sizeof(HSM_BATCH_IDX):%u\n", uInstances, (unsigned)sizeof(HSM),
+           (unsigned)sizeof(HSM_BATCH_IDX));
+    for (evt = BENCH_EVT_PING; evt <= BENCH_EVT_TICK; evt++)
+    {
+        // Best of several alternating runs, so both runtimes see the same noise
+        loop = batch = 0;
+        for (repeat = 0; repeat < BENCH_REPEAT; repeat++)
+        {
+            start = BENCH_Now();
+            for (round = 0; round < uRounds; round++)
+            {
+                for (idx = 0; idx < uInstances; idx++)
+                {
+                    HSM_Run(&pstDevices[idx].parent, evt, 0);
+                }
+            }
+            elapsed = BENCH_Now() - start;
+            loop = (repeat && loop < elapsed) ? loop : elapsed;
+
+            bBatch = 1;
+            start = BENCH_Now();
+            for (round = 0; round < uRounds; round++)
+            {
+                HSM_RunBatch(&stBatch, evt, 0, NULL, 0);
+            }
+            elapsed = BENCH_Now() - start;
+            batch = (repeat && batch < elapsed) ? batch : elapsed;
+            bBatch = 0;
+        }
+
+        printf("%-4s loop:%7.2f Mevents/s  batch:%7.2f Mevents/s  speedup %.2fx\n",
+               evt == BENCH_EVT_PING ? "PING" : "TICK", (double)uRounds * uInstances * 1e3 / loop,
+               (double)uRounds * uInstances * 1e3 / batch, loop / batch);
+    }
+
+    // Both runtimes must end in the same states
+    for (idx = 0; idx < uInstances; idx++)
+    {
+        checkLoop += pstDevices[idx].parent.curState - astChart;
+        checkBatch += pState[idx];
+    }
+    free(pstDevices);
+    free(puPings);
+    free(pState);
+    if (checkLoop != checkBatch)
+    {
+        printf("State mismatch\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,378 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// The camera.c chart implemented with the C API (hsm.h), the C++ template front-end (hsm.hpp) and
+// the C code generated by hsmgen.py from camera.scxml.
+// The actions print nothing; instead they record a trace so the implementations can be
+// checked for identical ENTRY/EXIT/INIT ordering before they are timed.
+#include "hsm.hpp"
+#include "camera_chart.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+// Camera HSM Events are generated in camera_chart.h
+
+#define BENCH_CYCLES    2000000
+#define BENCH_TRACE     256
+
+// Handled events only, unhandled events reach HSM_RootHandler() which always prints
+static const HSM_EVENT aEvents[] = { HSME_PWR, HSME_RELEASE, HSME_MODE, HSME_MODE, HSME_LOWBATT, HSME_MODE, HSME_PWR };
+static const unsigned uEvents = sizeof(aEvents) / sizeof(aEvents[0]);
+
+struct Trace
+{
+    char log[BENCH_TRACE];
+    unsigned len = 0;
+    void Add(char action)
+    {
+        log[len % BENCH_TRACE] = action;
+        len++;
+    }
+};
+
+//----C API----
+struct CAMERA
+{
+    HSM parent;
+    Trace trace;
+};
+
+static HSM_STATE CAMERA_StateOff;
+static HSM_STATE CAMERA_StateOn;
+static HSM_STATE CAMERA_StateOnShoot;
+static HSM_STATE CAMERA_StateOnDisp;
+static HSM_STATE CAMERA_StateOnDispPlay;
+static HSM_STATE CAMERA_StateOnDispMenu;
+
+#define ACTION(x) (((CAMERA *)This)->trace.Add(x))
+
+static HSM_EVENT CAMERA_StateOffHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_ENTRY)
+    {
+        ACTION('a');
+    }
+    else if (event == HSME_EXIT)
+    {
+        ACTION('b');
+    }
+    else if (event == HSME_PWR)
+    {
+        HSM_Tran(This, &CAMERA_StateOn, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT CAMERA_StateOnHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_ENTRY)
+    {
+        ACTION('c');
+    }
+    else if (event == HSME_EXIT)
+    {
+        ACTION('d');
+    }
+    else if (event == HSME_INIT)
+    {
+        HSM_Tran(This, &CAMERA_StateOnShoot, 0, NULL);
+    }
+    else if (event == HSME_PWR)
+    {
+        HSM_Tran(This, &CAMERA_StateOff, 0, NULL);
+        return 0;
+    }
+    else if (event == HSME_LOWBATT)
+    {
+        ACTION('e');
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT CAMERA_StateOnShootHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_ENTRY)
+    {
+        ACTION('f');
+    }
+    else if (event == HSME_EXIT)
+    {
+        ACTION('g');
+    }
+    else if (event == HSME_RELEASE)
+    {
+        ACTION('h');
+        return 0;
+    }
+    else if (event == HSME_MODE)
+    {
+        HSM_Tran(This, &CAMERA_StateOnDispPlay, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT CAMERA_StateOnDispHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_ENTRY)
+    {
+        ACTION('i');
+    }
+    else if (event == HSME_EXIT)
+    {
+        ACTION('j');
+    }
+    return event;
+}
+
+static HSM_EVENT CAMERA_StateOnDispPlayHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_ENTRY)
+    {
+        ACTION('k');
+    }
+    else if (event == HSME_MODE)
+    {
+        HSM_Tran(This, &CAMERA_StateOnDispMenu, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT CAMERA_StateOnDispMenuHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_ENTRY)
+    {
+        ACTION('l');
+    }
+    else if (event == HSME_MODE)
+    {
+        HSM_Tran(This, &CAMERA_StateOnShoot, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static void CAMERA_Init(CAMERA *This)
+{
+    HSM_STATE_Create(&CAMERA_StateOff, "Off", CAMERA_StateOffHndlr, NULL);
+    HSM_STATE_Create(&CAMERA_StateOn, "On", CAMERA_StateOnHndlr, NULL);
+    HSM_STATE_Create(&CAMERA_StateOnShoot, "On.Shoot", CAMERA_StateOnShootHndlr, &CAMERA_StateOn);
+    HSM_STATE_Create(&CAMERA_StateOnDisp, "On.Disp", CAMERA_StateOnDispHndlr, &CAMERA_StateOn);
+    HSM_STATE_Create(&CAMERA_StateOnDispPlay, "On.Disp.Play", CAMERA_StateOnDispPlayHndlr, &CAMERA_StateOnDisp);
+    HSM_STATE_Create(&CAMERA_StateOnDispMenu, "On.Disp.Menu", CAMERA_StateOnDispMenuHndlr, &CAMERA_StateOnDisp);
+    HSM_Create((HSM *)This, "Camera", &CAMERA_StateOff);
+}
+
+//----Generated from camera.scxml----
+struct CAMERA_GEN
+{
+    HSM parent;
+    Trace trace;
+};
+
+#define GEN_ACTION(x) (((CAMERA_GEN *)This)->trace.Add(x))
+
+void GEN_OffEntry(HSM *This, void *param) { GEN_ACTION('a'); }
+void GEN_OffExit(HSM *This, void *param) { GEN_ACTION('b'); }
+void GEN_OnEntry(HSM *This, void *param) { GEN_ACTION('c'); }
+void GEN_OnExit(HSM *This, void *param) { GEN_ACTION('d'); }
+void GEN_On_LOWBATT(HSM *This, void *param) { GEN_ACTION('e'); }
+void GEN_OnShootEntry(HSM *This, void *param) { GEN_ACTION('f'); }
+void GEN_OnShootExit(HSM *This, void *param) { GEN_ACTION('g'); }
+void GEN_OnShoot_RELEASE(HSM *This, void *param) { GEN_ACTION('h'); }
+void GEN_OnDispEntry(HSM *This, void *param) { GEN_ACTION('i'); }
+void GEN_OnDispExit(HSM *This, void *param) { GEN_ACTION('j'); }
+void GEN_OnDispPlayEntry(HSM *This, void *param) { GEN_ACTION('k'); }
+void GEN_OnDispMenuEntry(HSM *This, void *param) { GEN_ACTION('l'); }
+
+//----C++ API----
+struct Off : hsm::State<> {};
+struct On : hsm::State<> {};
+struct OnShoot : hsm::State<On> {};
+struct OnDisp : hsm::State<On> {};
+struct OnDispPlay : hsm::State<OnDisp> {};
+struct OnDispMenu : hsm::State<OnDisp> {};
+
+struct Camera : hsm::Machine<Camera, Off, On, OnShoot, OnDisp, OnDispPlay, OnDispMenu>
+{
+    Trace trace;
+
+    HSM_EVENT Handle(Off, HSM_EVENT event, void *param)
+    {
+        if (event == HSME_ENTRY)
+        {
+            trace.Add('a');
+        }
+        else if (event == HSME_EXIT)
+        {
+            trace.Add('b');
+        }
+        else if (event == HSME_PWR)
+        {
+            Tran<On>();
+            return 0;
+        }
+        return event;
+    }
+
+    HSM_EVENT Handle(On, HSM_EVENT event, void *param)
+    {
+        if (event == HSME_ENTRY)
+        {
+            trace.Add('c');
+        }
+        else if (event == HSME_EXIT)
+        {
+            trace.Add('d');
+        }
+        else if (event == HSME_INIT)
+        {
+            Tran<OnShoot>();
+        }
+        else if (event == HSME_PWR)
+        {
+            Tran<Off>();
+            return 0;
+        }
+        else if (event == HSME_LOWBATT)
+        {
+            trace.Add('e');
+            return 0;
+        }
+        return event;
+    }
+
+    HSM_EVENT Handle(OnShoot, HSM_EVENT event, void *param)
+    {
+        if (event == HSME_ENTRY)
+        {
+            trace.Add('f');
+        }
+        else if (event == HSME_EXIT)
+        {
+            trace.Add('g');
+        }
+        else if (event == HSME_RELEASE)
+        {
+            trace.Add('h');
+            return 0;
+        }
+        else if (event == HSME_MODE)
+        {
+            Tran<OnDispPlay>();
+            return 0;
+        }
+        return event;
+    }
+
+    HSM_EVENT Handle(OnDisp, HSM_EVENT event, void *param)
+    {
+        if (event == HSME_ENTRY)
+        {
+            trace.Add('i');
+        }
+        else if (event == HSME_EXIT)
+        {
+            trace.Add('j');
+        }
+        return event;
+    }
+
+    HSM_EVENT Handle(OnDispPlay, HSM_EVENT event, void *param)
+    {
+        if (event == HSME_ENTRY)
+        {
+            trace.Add('k');
+        }
+        else if (event == HSME_MODE)
+        {
+            Tran<OnDispMenu>();
+            return 0;
+        }
+        return event;
+    }
+
+    HSM_EVENT Handle(OnDispMenu, HSM_EVENT event, void *param)
+    {
+        if (event == HSME_ENTRY)
+        {
+            trace.Add('l');
+        }
+        else if (event == HSME_MODE)
+        {
+            Tran<OnShoot>();
+            return 0;
+        }
+        return event;
+    }
+};
+
+static double BENCH_Run(const char *name, void (*run)(HSM_EVENT event))
+{
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned cycle = 0; cycle < BENCH_CYCLES; cycle++)
+    {
+        for (unsigned idx = 0; idx < uEvents; idx++)
+        {
+            run(aEvents[idx]);
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    ns /= (double)BENCH_CYCLES * uEvents;
+    std::printf("%-4s %6.1f ns/event\n", name, ns);
+    return ns;
+}
+
+static CAMERA stCamera;
+static Camera camera;
+static CAMERA_GEN stGen;
+
+int main(void)
+{
+    CAMERA_Init(&stCamera);
+    camera.Create<Off>();
+    GEN_Create((HSM *)&stGen, "Gen");
+    // All charts must produce the same actions in the same order
+    for (unsigned idx = 0; idx < uEvents * 4; idx++)
+    {
+        HSM_Run((HSM *)&stCamera, aEvents[idx % uEvents], 0);
+        camera.Run(aEvents[idx % uEvents]);
+        HSM_Run((HSM *)&stGen, aEvents[idx % uEvents], 0);
+    }
+    if (stCamera.trace.len != camera.trace.len || std::memcmp(stCamera.trace.log, camera.trace.log, stCamera.trace.len) ||
+        stCamera.trace.len != stGen.trace.len || std::memcmp(stCamera.trace.log, stGen.trace.log, stCamera.trace.len))
+    {
+        std::printf("Trace mismatch: C:%.*s C++:%.*s Gen:%.*s\n", (int)stCamera.trace.len, stCamera.trace.log,
+                    (int)camera.trace.len, camera.trace.log, (int)stGen.trace.len, stGen.trace.log);
+        return 1;
+    }
+    std::printf("trace: %.*s\n", (int)stCamera.trace.len, stCamera.trace.log);
+    double c = BENCH_Run("C", [](HSM_EVENT event) { HSM_Run((HSM *)&stCamera, event, 0); });
+    double cpp = BENCH_Run("C++", [](HSM_EVENT event) { camera.Run(event); });
+    double gen = BENCH_Run("Gen", [](HSM_EVENT event) { HSM_Run((HSM *)&stGen, event, 0); });
+    std::printf("speedup C++ %.2fx  Gen %.2fx\n", c / cpp, c / gen);
+    return 0;
+}
@@ -0,0 +1,294 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// A chart whose "Open Lens" entry action waits on a simulated I/O device, driven by one thread for many
+// cameras.  The blocking version waits in HSME_ENTRY inside HSM_Run() and transitions from HSME_INIT, the
+// coroutine version co_awaits the completion with hsm_co.hpp so the waits of all cameras overlap.
+// The overhead of the adapter is measured with completions that are already done when awaited.
+#include "hsm_co.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#define HSME_PWR        (HSME_START)
+
+#define BENCH_CAMERAS   256
+#define BENCH_ROUNDS    4
+#define BENCH_LATENCY   std::chrono::microseconds(200)
+#define BENCH_CYCLES    1000000
+
+//----Simulated I/O device, completing each request BENCH_LATENCY after it is submitted----
+class Device
+{
+public:
+    typedef void (*Callback)(void *ctx, intptr_t result);
+
+    Device(void) : thread([this] { Loop(); })
+    {
+    }
+    ~Device()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+        }
+        cond.notify_one();
+        thread.join();
+    }
+
+    void Submit(Callback fn, void *ctx)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        reqs.push_back({std::chrono::steady_clock::now() + BENCH_LATENCY, fn, ctx});
+        cond.notify_one();
+    }
+
+private:
+    struct Req
+    {
+        std::chrono::steady_clock::time_point deadline;
+        Callback fn;
+        void *ctx;
+    };
+
+    void Loop(void)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopped)
+        {
+            if (reqs.empty())
+            {
+                cond.wait(lock);
+            }
+            else if (std::chrono::steady_clock::now() < reqs.front().deadline)
+            {
+                cond.wait_until(lock, reqs.front().deadline);
+            }
+            else
+            {
+                Req req = reqs.front();
+                reqs.pop_front();
+                lock.unlock();
+                req.fn(req.ctx, 0);
+                lock.lock();
+            }
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<Req> reqs;
+    bool stopped = false;
+    std::thread thread;
+};
+
+//----Camera chart----
+struct CAMERA
+{
+    HSM parent;
+    hsm::co::Actor actor;
+    hsm::co::Completion lens;
+    // Used by the blocking version
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done;
+    CAMERA(hsm::co::Dispatcher &dispatcher) : actor(&parent, dispatcher)
+    {
+    }
+};
+
+static HSM_STATE CAMERA_StateOff;
+static HSM_STATE CAMERA_StateOn;
+static HSM_STATE CAMERA_StateOnReady;
+
+static Device *pDevice;         // Completes the lens at once when null
+static bool bBlocking;
+static unsigned uReady;         // Number of entries in CAMERA_StateOnReady
+static unsigned uOpened;        // Number of lens actions returned
+
+static void CAMERA_LensDone(void *ctx, intptr_t result)
+{
+    ((CAMERA *)ctx)->lens.Complete(result);
+}
+
+static void CAMERA_LensWake(void *ctx, intptr_t result)
+{
+    CAMERA *This = (CAMERA *)ctx;
+    std::lock_guard<std::mutex> lock(This->mutex);
+    This->done = true;
+    This->cond.notify_one();
+}
+
+static hsm::co::Action CAMERA_OpenLens(CAMERA *This)
+{
+    This->lens.Reset();
+    if (pDevice)
+    {
+        pDevice->Submit(CAMERA_LensDone, This);
+    }
+    else
+    {
+        This->lens.Complete(0);
+    }
+    co_await This->lens;
+    uOpened++;
+    HSM_Tran((HSM *)This, &CAMERA_StateOnReady, 0, NULL);
+}
+
+// Wait in the handler, blocking the thread running the cameras
+static void CAMERA_OpenLensBlocking(CAMERA *This)
+{
+    if (pDevice)
+    {
+        std::unique_lock<std::mutex> lock(This->mutex);
+        This->done = false;
+        pDevice->Submit(CAMERA_LensWake, This);
+        This->cond.wait(lock, [This] { return This->done; });
+    }
+    uOpened++;
+}
+
+static HSM_EVENT CAMERA_StateOffHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_PWR)
+    {
+        HSM_Tran(This, &CAMERA_StateOn, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT CAMERA_StateOnHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_ENTRY)
+    {
+        if (bBlocking)
+        {
+            CAMERA_OpenLensBlocking((CAMERA *)This);
+        }
+        else
+        {
+            ((CAMERA *)This)->actor.Spawn(CAMERA_OpenLens((CAMERA *)This));
+        }
+    }
+    else if (event == HSME_INIT)
+    {
+        // The blocking version needs HSME_INIT to leave the state entered
+        if (bBlocking)
+        {
+            HSM_Tran(This, &CAMERA_StateOnReady, 0, NULL);
+        }
+    }
+    else if (event == HSME_PWR)
+    {
+        HSM_Tran(This, &CAMERA_StateOff, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT CAMERA_StateOnReadyHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_ENTRY)
+    {
+        uReady++;
+    }
+    return event;
+}
+
+// Send each camera "power on" then "power off" for a number of rounds.  Returns the time in ns
+static double BENCH_Run(CAMERA **cameras, unsigned count, unsigned rounds, hsm::co::Dispatcher &dispatcher)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned round = 1; round <= rounds; round++)
+    {
+        for (unsigned idx = 0; idx < count; idx++)
+        {
+            // The second event is queued by the actor while the lens opens
+            cameras[idx]->actor.Post(HSME_PWR);
+            cameras[idx]->actor.Post(HSME_PWR);
+        }
+        while (uOpened < round * count)
+        {
+            if (pDevice)
+            {
+                dispatcher.Wait();
+            }
+            dispatcher.Poll();
+        }
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(void)
+{
+    static CAMERA *apCameras[BENCH_CAMERAS];
+    hsm::co::Dispatcher dispatcher;
+    HSM_STATE_Create(&CAMERA_StateOff, "Off", CAMERA_StateOffHndlr, NULL);
+    HSM_STATE_Create(&CAMERA_StateOn, "On", CAMERA_StateOnHndlr, NULL);
+    HSM_STATE_Create(&CAMERA_StateOnReady, "On Ready", CAMERA_StateOnReadyHndlr, &CAMERA_StateOn);
+    for (unsigned idx = 0; idx < BENCH_CAMERAS; idx++)
+    {
+        apCameras[idx] = new CAMERA(dispatcher);
+        HSM_Create((HSM *)apCameras[idx], "Camera", &CAMERA_StateOff);
+    }
+
+    // Overhead of the adapter on a single camera, without I/O latency
+    bBlocking = true;
+    double sync = BENCH_Run(apCameras, 1, BENCH_CYCLES, dispatcher);
+    bBlocking = false;
+    uOpened = 0;
+    double async = BENCH_Run(apCameras, 1, BENCH_CYCLES, dispatcher);
+    std::printf("overhead  sync %6.1f ns/cycle  co_await %6.1f ns/cycle\n", sync / BENCH_CYCLES, async / BENCH_CYCLES);
+
+    // Cameras waiting on the device
+    Device device;
+    pDevice = &device;
+    uReady = 0;
+    uOpened = 0;
+    bBlocking = true;
+    double block = BENCH_Run(apCameras, BENCH_CAMERAS, BENCH_ROUNDS, dispatcher);
+    uOpened = 0;
+    bBlocking = false;
+    double co = BENCH_Run(apCameras, BENCH_CAMERAS, BENCH_ROUNDS, dispatcher);
+    unsigned opens = BENCH_CAMERAS * BENCH_ROUNDS;
+    std::printf("cameras:%u rounds:%u latency:%lld us\n", BENCH_CAMERAS, BENCH_ROUNDS, (long long)BENCH_LATENCY.count());
+    std::printf("blocking  %8.2f ms  %8.0f opens/s\n", block / 1e6, opens / (block / 1e9));
+    std::printf("co_await  %8.2f ms  %8.0f opens/s  speedup %.1fx\n", co / 1e6, opens / (co / 1e9), block / co);
+    for (unsigned idx = 0; idx < BENCH_CAMERAS; idx++)
+    {
+        if (!HSM_IsInState((HSM *)apCameras[idx], &CAMERA_StateOff) || apCameras[idx]->actor.IsBusy())
+        {
+            std::printf("Camera %u not off\n", idx);
+            return 1;
+        }
+    }
+    if (uReady != 2 * opens)
+    {
+        std::printf("Ready mismatch: %u of %u\n", uReady, 2 * opens);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Cycles per second of leaving a composite state and returning to the innermost state it was in.  The
+// HSME_INIT handler of each nested state transitions to the remembered substate, one HSM_Tran() per level,
+// compared with a single HSM_TranHistory() to the deep history of the composite state.
+// Usage: history [depth] [cycles]
+#include "hsm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_EVT_CYCLE     (HSME_START)
+#define BENCH_EVT_BACK      (HSME_START + 1)
+#define BENCH_MAX_DEPTH     (HSM_MAX_DEPTH - 1)
+
+// Each level has a leaf and a composite state, the composite state holds the next level
+static HSM_STATE stOff;
+static HSM_STATE stOn;
+static HSM_STATE astNode[BENCH_MAX_DEPTH][2];
+static uint32_t uDepth;
+static uint8_t bHistory;
+static uint32_t uEntries;
+
+static HSM_EVENT BENCH_OffHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_BACK)
+    {
+        if (bHistory)
+        {
+            HSM_TranHistory(This, &stOn, 0, NULL);
+        }
+        else
+        {
+            HSM_Tran(This, &stOn, 0, NULL);
+        }
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_OnHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_ENTRY)
+    {
+        uEntries++;
+    }
+    else if (event == HSME_INIT)
+    {
+        // Back to the remembered substate
+        HSM_Tran(This, &astNode[0][1], 0, NULL);
+    }
+    else if (event == BENCH_EVT_CYCLE)
+    {
+        HSM_Tran(This, &stOff, 0, NULL);
+        HSM_Run(This, BENCH_EVT_BACK, 0);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_NodeHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_ENTRY)
+    {
+        uEntries++;
+    }
+    else if (event == HSME_INIT && This->curState->level < uDepth + 1)
+    {
+        // Back to the remembered substate
+        HSM_Tran(This, &astNode[This->curState->level - 1][1], 0, NULL);
+    }
+    return event;
+}
+
+static double BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t uCycles = (argc > 2) ? strtoul(argv[2], NULL, 0) : 1000000;
+    HSM stHsm;
+    HSM_STATE *pstLeaf;
+    HSM_STATE *parent = &stOn;
+    uint32_t idx;
+    uint32_t entries[2];
+    double start;
+    double time[2];
+
+    uDepth = (argc > 1) ? strtoul(argv[1], NULL, 0) : 4;
+    if (uDepth < 1 || uDepth > BENCH_MAX_DEPTH - 1)
+    {
+        printf("depth must be 1 to %u\n", BENCH_MAX_DEPTH - 1);
+        return 1;
+    }
+    HSM_STATE_Create(&stOff, "Off", BENCH_OffHndlr, NULL);
+    HSM_STATE_Create(&stOn, "On", BENCH_OnHndlr, NULL);
+    HSM_STATE_SetHistory(&stOn, HSM_HISTORY_DEEP);
+    for (idx = 0; idx < uDepth; idx++)
+    {
+        HSM_STATE_Create(&astNode[idx][0], "Leaf", BENCH_NodeHndlr, parent);
+        HSM_STATE_Create(&astNode[idx][1], "Node", BENCH_NodeHndlr, parent);
+        parent = &astNode[idx][1];
+    }
+    pstLeaf = parent;
+    HSM_Create(&stHsm, "History", &stOn);
+
+    for (bHistory = 0; bHistory < 2; bHistory++)
+    {
+        uEntries = 0;
+        start = BENCH_Now();
+        for (idx = 0; idx < uCycles; idx++)
+        {
+            HSM_Run(&stHsm, BENCH_EVT_CYCLE, 0);
+        }
+        time[bHistory] = BENCH_Now() - start;
+        entries[bHistory] = uEntries;
+        if (stHsm.curState != pstLeaf)
+        {
+            printf("Not back in %s\n", pstLeaf->name);
+            return 1;
+        }
+    }
+    printf("depth:%u  init:%7.2f Mcycles/s  history:%7.2f Mcycles/s  speedup %.2fx\n", uDepth,
+           uCycles * 1e3 / time[0], uCycles * 1e3 / time[1], time[0] / time[1]);
+    // Both return paths enter the same states
+    if (entries[0] != entries[1])
+    {
+        printf("Entries mismatch %u != %u\n", entries[0], entries[1]);
+        return 1;
+    }
+    return 0;
+}
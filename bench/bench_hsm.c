@@ -0,0 +1,276 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Microbenchmark of the HSM core (HSM_Run/HSM_Tran) on a generated chart.
+//
+// The chart is a "comb" of the given depth: every composite state has "fanout" children, one of which
+// continues the spine down to the deepest leaf and the rest are leaves.  Measurements:
+//   run  - HSM_Run() on the deepest leaf with an event handled "locality" levels above it
+//   tran - HSM_Tran() between the deepest leaf and a leaf child of the top level state, so each
+//          transition exits and enters (depth - 1) states on average
+// Results are written as CSV lines, with instructions and cache misses from the perf counters when the
+// kernel allows it (otherwise -1).  Build once per feature flag combination, see makefile.
+// Usage: hsm [-d depth] [-f fanout] [-l locality] [-n iterations] [-c config] [-H]
+#include "hsm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif // __linux__
+
+#define BENCH_EVT_WORK      (HSME_START)
+#define BENCH_EVT_TOGGLE    (HSME_START + 1)
+#define BENCH_MAX_LEVEL     32
+#define BENCH_MAX_FANOUT    16
+
+#if HSM_MAX_DEPTH <= BENCH_MAX_LEVEL
+#error "Build with -DHSM_MAX_DEPTH > BENCH_MAX_LEVEL"
+#endif
+
+static HSM_STATE astStates[BENCH_MAX_LEVEL][BENCH_MAX_FANOUT];
+static HSM_STATE *pDeep;            // Deepest leaf of the spine
+static HSM_STATE *pShallow;         // Leaf child of the top level state
+static uint8_t ucWorkLevel;         // Level of the state that handles BENCH_EVT_WORK
+static volatile uint32_t uWorkDone;
+
+// Each level has its own handler so the handler knows the level it runs at
+#define BENCH_HNDLR(lvl)                                                    \
+static HSM_EVENT BENCH_StateHndlr##lvl(HSM *This, HSM_EVENT event, void *param) \
+{                                                                           \
+    if (event == BENCH_EVT_WORK && ucWorkLevel == (lvl) + 1)                \
+    {                                                                       \
+        uWorkDone++;                                                        \
+        return 0;                                                           \
+    }                                                                       \
+    else if (event == BENCH_EVT_TOGGLE && This->curState->level == (lvl) + 1) \
+    {                                                                       \
+        HSM_Tran(This, (This->curState == pDeep) ? pShallow : pDeep, 0, NULL); \
+        return 0;                                                           \
+    }                                                                       \
+    return event;                                                           \
+}
+BENCH_HNDLR(0)  BENCH_HNDLR(1)  BENCH_HNDLR(2)  BENCH_HNDLR(3)  BENCH_HNDLR(4)  BENCH_HNDLR(5)  BENCH_HNDLR(6)  BENCH_HNDLR(7)
+BENCH_HNDLR(8)  BENCH_HNDLR(9)  BENCH_HNDLR(10) BENCH_HNDLR(11) BENCH_HNDLR(12) BENCH_HNDLR(13) BENCH_HNDLR(14) BENCH_HNDLR(15)
+BENCH_HNDLR(16) BENCH_HNDLR(17) BENCH_HNDLR(18) BENCH_HNDLR(19) BENCH_HNDLR(20) BENCH_HNDLR(21) BENCH_HNDLR(22) BENCH_HNDLR(23)
+BENCH_HNDLR(24) BENCH_HNDLR(25) BENCH_HNDLR(26) BENCH_HNDLR(27) BENCH_HNDLR(28) BENCH_HNDLR(29) BENCH_HNDLR(30) BENCH_HNDLR(31)
+
+static const HSM_FN apfnHndlr[BENCH_MAX_LEVEL] =
+{
+    BENCH_StateHndlr0,  BENCH_StateHndlr1,  BENCH_StateHndlr2,  BENCH_StateHndlr3,
+    BENCH_StateHndlr4,  BENCH_StateHndlr5,  BENCH_StateHndlr6,  BENCH_StateHndlr7,
+    BENCH_StateHndlr8,  BENCH_StateHndlr9,  BENCH_StateHndlr10, BENCH_StateHndlr11,
+    BENCH_StateHndlr12, BENCH_StateHndlr13, BENCH_StateHndlr14, BENCH_StateHndlr15,
+    BENCH_StateHndlr16, BENCH_StateHndlr17, BENCH_StateHndlr18, BENCH_StateHndlr19,
+    BENCH_StateHndlr20, BENCH_StateHndlr21, BENCH_StateHndlr22, BENCH_StateHndlr23,
+    BENCH_StateHndlr24, BENCH_StateHndlr25, BENCH_StateHndlr26, BENCH_StateHndlr27,
+    BENCH_StateHndlr28, BENCH_StateHndlr29, BENCH_StateHndlr30, BENCH_StateHndlr31,
+};
+
+static void BENCH_Build(uint8_t depth, uint8_t fanout)
+{
+    uint8_t lvl;
+    uint8_t idx;
+    // Child 0 of each level is the spine, the rest are leaves
+    for (lvl = 0; lvl < depth; lvl++)
+    {
+        for (idx = 0; idx < fanout; idx++)
+        {
+            HSM_STATE_Create(&astStates[lvl][idx], "S", apfnHndlr[lvl], lvl ? &astStates[lvl - 1][0] : NULL);
+        }
+    }
+    pDeep = &astStates[depth - 1][0];
+    pShallow = (depth > 1) ? &astStates[1][fanout - 1] : &astStates[0][fanout - 1];
+}
+
+//----Perf counters----
+typedef struct BENCH_PERF_T
+{
+    int fdInstr;
+    int fdMiss;
+    long long instr;
+    long long miss;
+} BENCH_PERF;
+
+#ifdef __linux__
+static int BENCH_PerfOpen(uint32_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif // __linux__
+
+static void BENCH_PerfStart(BENCH_PERF *perf)
+{
+    perf->fdInstr = -1;
+    perf->fdMiss = -1;
+#ifdef __linux__
+    perf->fdInstr = BENCH_PerfOpen(PERF_COUNT_HW_INSTRUCTIONS);
+    perf->fdMiss = BENCH_PerfOpen(PERF_COUNT_HW_CACHE_MISSES);
+    if (perf->fdInstr >= 0)
+    {
+        ioctl(perf->fdInstr, PERF_EVENT_IOC_RESET, 0);
+        ioctl(perf->fdInstr, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    if (perf->fdMiss >= 0)
+    {
+        ioctl(perf->fdMiss, PERF_EVENT_IOC_RESET, 0);
+        ioctl(perf->fdMiss, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif // __linux__
+}
+
+static long long BENCH_PerfRead(int fd)
+{
+    long long value = -1;
+#ifdef __linux__
+    if (fd >= 0)
+    {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &value, sizeof(value)) != sizeof(value))
+        {
+            value = -1;
+        }
+        close(fd);
+    }
+#endif // __linux__
+    return value;
+}
+
+static void BENCH_PerfStop(BENCH_PERF *perf)
+{
+    perf->instr = BENCH_PerfRead(perf->fdInstr);
+    perf->miss = BENCH_PerfRead(perf->fdMiss);
+}
+
+static double BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+//----Measurements----
+static const char *pcConfig = "default";
+static uint8_t ucDepth = 4;
+static uint8_t ucFanout = 2;
+static uint8_t ucLocality = 0;
+static uint32_t uIterations = 1000000;
+
+static void BENCH_Report(const char *metric, double elapsed, BENCH_PERF *perf)
+{
+    printf("%ld,%s,%d,%d,%d,%s,%u,%.2f,%.1f,%.3f\n", (long)time(NULL), pcConfig, ucDepth, ucFanout, ucLocality,
+           metric, uIterations, elapsed / uIterations,
+           perf->instr < 0 ? -1.0 : (double)perf->instr / uIterations,
+           perf->miss < 0 ? -1.0 : (double)perf->miss / uIterations);
+}
+
+static void BENCH_MeasureRun(void)
+{
+    HSM hsm;
+    BENCH_PERF perf;
+    uint32_t idx;
+    double start;
+
+    ucWorkLevel = ucDepth - ucLocality;
+    HSM_Create(&hsm, "Bench", pDeep);
+    BENCH_PerfStart(&perf);
+    start = BENCH_Now();
+    for (idx = 0; idx < uIterations; idx++)
+    {
+        HSM_Run(&hsm, BENCH_EVT_WORK, 0);
+    }
+    start = BENCH_Now() - start;
+    BENCH_PerfStop(&perf);
+    BENCH_Report("run", start, &perf);
+}
+
+static void BENCH_MeasureTran(void)
+{
+    HSM hsm;
+    BENCH_PERF perf;
+    uint32_t idx;
+    double start;
+
+    HSM_Create(&hsm, "Bench", pDeep);
+    BENCH_PerfStart(&perf);
+    start = BENCH_Now();
+    for (idx = 0; idx < uIterations; idx++)
+    {
+        HSM_Run(&hsm, BENCH_EVT_TOGGLE, 0);
+    }
+    start = BENCH_Now() - start;
+    BENCH_PerfStop(&perf);
+    BENCH_Report("tran", start, &perf);
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "d:f:l:n:c:H")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd':
+            ucDepth = atoi(optarg);
+            break;
+        case 'f':
+            ucFanout = atoi(optarg);
+            break;
+        case 'l':
+            ucLocality = atoi(optarg);
+            break;
+        case 'n':
+            uIterations = strtoul(optarg, NULL, 0);
+            break;
+        case 'c':
+            pcConfig = optarg;
+            break;
+        case 'H':
+            printf("time,config,depth,fanout,locality,metric,iterations,ns_per_op,instr_per_op,cache_miss_per_op\n");
+            return 0;
+        default:
+            fprintf(stderr, "Usage: %s [-d depth] [-f fanout] [-l locality] [-n iterations] [-c config] [-H]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (ucDepth < 1 || ucDepth > BENCH_MAX_LEVEL || ucFanout < 2 || ucFanout > BENCH_MAX_FANOUT || ucLocality >= ucDepth)
+    {
+        fprintf(stderr, "Requires 1 <= depth <= %d, 2 <= fanout <= %d, locality < depth\n", BENCH_MAX_LEVEL, BENCH_MAX_FANOUT);
+        return 1;
+    }
+    BENCH_Build(ucDepth, ucFanout);
+    BENCH_MeasureRun();
+    BENCH_MeasureTran();
+    return 0;
+}
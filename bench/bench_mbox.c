@@ -0,0 +1,177 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Throughput of N producer threads feeding one HSM through the lock-free HSM_MBOX, compared with
+// the baseline of each producer calling HSM_Run() under a mutex.  Every event carries its producer
+// and sequence number, so the handler also verifies that no event is lost or reordered within a producer.
+// Usage: mbox [producers] [events per producer]
+#include "hsm_mbox.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_EVT_DATA      (HSME_START)
+#define BENCH_MAX_PRODUCERS 64
+
+static HSM_STATE BENCH_StateRun;
+static HSM stHsm;
+static HSM_MBOX stMbox;
+static pthread_mutex_t stLock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t auNextSeq[BENCH_MAX_PRODUCERS];
+static uint64_t ulReceived;
+static uint64_t ulErrors;
+static uint32_t uProducers = 4;
+static uint32_t uEvents = 1000000;
+static volatile int bDone;
+
+static HSM_EVENT BENCH_StateRunHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_DATA)
+    {
+        uintptr_t producer = (uintptr_t)param >> 32;
+        uint32_t seq = (uint32_t)(uintptr_t)param;
+        if (seq != auNextSeq[producer])
+        {
+            ulErrors++;
+        }
+        auNextSeq[producer] = seq + 1;
+        ulReceived++;
+        return 0;
+    }
+    return event;
+}
+
+static void *BENCH_MutexProducer(void *arg)
+{
+    uintptr_t producer = (uintptr_t)arg;
+    uint32_t seq;
+    for (seq = 0; seq < uEvents; seq++)
+    {
+        pthread_mutex_lock(&stLock);
+        HSM_Run(&stHsm, BENCH_EVT_DATA, (void *)((producer << 32) | seq));
+        pthread_mutex_unlock(&stLock);
+    }
+    return NULL;
+}
+
+static void *BENCH_MboxProducer(void *arg)
+{
+    uintptr_t producer = (uintptr_t)arg;
+    uint32_t seq;
+    for (seq = 0; seq < uEvents; seq++)
+    {
+        while (!HSM_MBOX_Post(&stMbox, BENCH_EVT_DATA, (void *)((producer << 32) | seq)))
+        {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *BENCH_MboxConsumer(void *arg)
+{
+    while (!bDone)
+    {
+        if (!HSM_MBOX_Dispatch(&stMbox))
+        {
+            sched_yield();
+        }
+    }
+    HSM_MBOX_Dispatch(&stMbox);
+    return NULL;
+}
+
+static double BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void BENCH_Measure(const char *name, void *(*producer)(void *), uint8_t useConsumer)
+{
+    pthread_t athProducer[BENCH_MAX_PRODUCERS];
+    pthread_t thConsumer;
+    uintptr_t idx;
+    double start;
+    double elapsed;
+
+    HSM_Create(&stHsm, "Bench", &BENCH_StateRun);
+    HSM_MBOX_Create(&stMbox, &stHsm);
+    for (idx = 0; idx < uProducers; idx++)
+    {
+        auNextSeq[idx] = 0;
+    }
+    ulReceived = 0;
+    ulErrors = 0;
+    bDone = 0;
+
+    start = BENCH_Now();
+    if (useConsumer)
+    {
+        pthread_create(&thConsumer, NULL, BENCH_MboxConsumer, NULL);
+    }
+    for (idx = 0; idx < uProducers; idx++)
+    {
+        pthread_create(&athProducer[idx], NULL, producer, (void *)idx);
+    }
+    for (idx = 0; idx < uProducers; idx++)
+    {
+        pthread_join(athProducer[idx], NULL);
+    }
+    if (useConsumer)
+    {
+        bDone = 1;
+        pthread_join(thConsumer, NULL);
+    }
+    elapsed = BENCH_Now() - start;
+
+    printf("%-6s producers:%-3u %8.2f Mevents/s  received:%llu/%llu  reordered:%llu\n", name, uProducers,
+           ulReceived * 1e3 / elapsed, (unsigned long long)ulReceived,
+           (unsigned long long)uProducers * uEvents, (unsigned long long)ulErrors);
+    if (ulErrors || ulReceived != (uint64_t)uProducers * uEvents)
+    {
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1)
+    {
+        uProducers = atoi(argv[1]);
+        if (uProducers < 1 || uProducers > BENCH_MAX_PRODUCERS)
+        {
+            uProducers = 4;
+        }
+    }
+    if (argc > 2)
+    {
+        uEvents = atoi(argv[2]);
+    }
+    HSM_STATE_Create(&BENCH_StateRun, "Run", BENCH_StateRunHndlr, NULL);
+    BENCH_Measure("mutex", BENCH_MutexProducer, 0);
+    BENCH_Measure("mbox", BENCH_MboxProducer, 1);
+    return 0;
+}
@@ -0,0 +1,190 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Cost of creating and destroying HSM instances per connection: malloc() and free() around HSM_Create() and
+// HSM_Destroy(), compared with HSM_Alloc() and HSM_Free() from an instance pool.  Each step destroys a random
+// live connection and creates a new one, while untimed request buffers of random sizes are allocated and freed
+// with malloc() in both runs, as a server would, so the heap fragments.  Each step is timed for the tail latency.
+// Usage: pool [connections] [steps]
+#include "hsm_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct BENCH_CONN_T
+{
+    HSM parent;
+    uint32_t id;                // User data of the connection
+    uint8_t rx[180];
+} BENCH_CONN;
+
+static HSM_STATE BENCH_StateConnected;
+static HSM_STATE BENCH_StateConnectedIdle;
+static HSM_POOL stPool;
+static uint64_t ulEntries;
+static uint64_t ulExits;
+static uint32_t uSeed = 1;
+
+static HSM_EVENT BENCH_StateConnectedHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_ENTRY)
+    {
+        ulEntries++;
+    }
+    else if (event == HSME_EXIT)
+    {
+        ulExits++;
+    }
+    else if (event == HSME_INIT)
+    {
+        HSM_Tran(This, &BENCH_StateConnectedIdle, 0, NULL);
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_StateConnectedIdleHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_ENTRY)
+    {
+        ulEntries++;
+    }
+    else if (event == HSME_EXIT)
+    {
+        ulExits++;
+    }
+    return event;
+}
+
+static uint32_t BENCH_Rand(void)
+{
+    uSeed = uSeed * 1103515245 + 12345;
+    return uSeed >> 8;
+}
+
+static uint64_t BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static BENCH_CONN *BENCH_Open(uint8_t pool)
+{
+    BENCH_CONN *conn;
+    if (pool)
+    {
+        return (BENCH_CONN *)HSM_Alloc(&stPool, "Conn", &BENCH_StateConnected);
+    }
+    conn = malloc(sizeof(BENCH_CONN));
+    memset(conn, 0, sizeof(BENCH_CONN));
+    HSM_Create((HSM *)conn, "Conn", &BENCH_StateConnected);
+    return conn;
+}
+
+static void BENCH_Close(BENCH_CONN *conn, uint8_t pool)
+{
+    if (pool)
+    {
+        HSM_Free(&stPool, (HSM *)conn, NULL);
+        return;
+    }
+    HSM_Destroy((HSM *)conn, NULL);
+    free(conn);
+}
+
+static int BENCH_Cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Returns the mean ns per step
+static double BENCH_Run(const char *name, uint8_t pool, uint32_t conns, uint32_t steps, uint32_t *lat)
+{
+    BENCH_CONN **aConn = calloc(conns, sizeof(BENCH_CONN *));
+    void **aBuf = calloc(conns, sizeof(void *));
+    uint64_t start;
+    uint64_t total = 0;
+    uint32_t idx;
+    uint32_t slot;
+    uSeed = 1;
+    for (idx = 0; idx < conns; idx++)
+    {
+        aConn[idx] = BENCH_Open(pool);
+        aBuf[idx] = malloc(16 + BENCH_Rand() % 4096);
+    }
+    for (idx = 0; idx < steps; idx++)
+    {
+        slot = BENCH_Rand() % conns;
+        free(aBuf[slot]);
+        aBuf[slot] = malloc(16 + BENCH_Rand() % 4096);
+        slot = BENCH_Rand() % conns;
+        start = BENCH_Now();
+        BENCH_Close(aConn[slot], pool);
+        aConn[slot] = BENCH_Open(pool);
+        lat[idx] = (uint32_t)(BENCH_Now() - start);
+        total += lat[idx];
+        aConn[slot]->id = idx;
+    }
+    for (idx = 0; idx < conns; idx++)
+    {
+        BENCH_Close(aConn[idx], pool);
+        free(aBuf[idx]);
+    }
+    free(aConn);
+    free(aBuf);
+    qsort(lat, steps, sizeof(uint32_t), BENCH_Cmp);
+    printf("%-6s %6.1f ns/step  p50 %5u  p99 %5u  p99.9 %6u  max %7u ns\n", name, (double)total / steps,
+           lat[steps / 2], lat[(uint64_t)steps * 99 / 100], lat[(uint64_t)steps * 999 / 1000], lat[steps - 1]);
+    return (double)total / steps;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t conns = (argc > 1) ? atoi(argv[1]) : 8192;
+    uint32_t steps = (argc > 2) ? atoi(argv[2]) : 2000000;
+    uint32_t *lat = malloc(steps * sizeof(uint32_t));
+    HSM_POOL_STATS stats;
+    HSM_STATE_Create(&BENCH_StateConnected, "Connected", BENCH_StateConnectedHndlr, NULL);
+    HSM_STATE_Create(&BENCH_StateConnectedIdle, "Connected.Idle", BENCH_StateConnectedIdleHndlr, &BENCH_StateConnected);
+    HSM_POOL_Create(&stPool, sizeof(BENCH_CONN), 0);
+
+    printf("connections:%u steps:%u instance:%u bytes\n", conns, steps, (unsigned)sizeof(BENCH_CONN));
+    double heap = BENCH_Run("malloc", 0, conns, steps, lat);
+    double pool = BENCH_Run("pool", 1, conns, steps, lat);
+    printf("speedup %.2fx\n", heap / pool);
+    HSM_POOL_GetStats(&stPool, &stats, 0);
+    printf("pool: size:%u slabs:%u capacity:%u used:%u highWater:%u allocs:%llu frees:%llu failed:%u\n",
+           stats.size, stats.slabs, stats.capacity, stats.used, stats.highWater,
+           (unsigned long long)stats.allocs, (unsigned long long)stats.frees, stats.failed);
+    HSM_POOL_Destroy(&stPool);
+    free(lat);
+    if (ulEntries != ulExits || stats.used)
+    {
+        printf("Teardown mismatch: entries %llu exits %llu used %u\n", (unsigned long long)ulEntries,
+               (unsigned long long)ulExits, stats.used);
+        return 1;
+    }
+    return 0;
+}
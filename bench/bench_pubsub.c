@@ -0,0 +1,202 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Cost of broadcasting an event to many HSM instances of which few handle it: the loop calling HSM_Run() on every
+// instance, compared with HSM_BUS_Publish() that only runs the subscribers.  One instance in 8 is awake, and only
+// the awake instances subscribe to LOWBATT, both in Awake and in its substate Awake.Busy.  Each broadcast allocates
+// one payload shared by all the instances, which is freed after the last one.
+// Usage: pubsub [instances] [broadcasts]
+#include "hsm_pubsub.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_EVT_LOWBATT   (HSME_START)
+#define BENCH_EVT_TOGGLE    (HSME_START + 1)
+
+typedef struct BENCH_BATT_T
+{
+    HSM_MSG msg;                // Header of the shared payload
+    uint32_t level;             // Battery level
+} BENCH_BATT;
+
+typedef struct BENCH_DEV_T
+{
+    HSM parent;
+    HSM_SUB subs[1];            // Awake and Awake.Busy subscribe to the same event
+    uint64_t level;             // Sum of the battery levels received
+} BENCH_DEV;
+
+static HSM_STATE BENCH_StateSleep;
+static HSM_STATE BENCH_StateAwake;
+static HSM_STATE BENCH_StateAwakeBusy;
+static const HSM_EVENT aeAwakeEvents[] = { BENCH_EVT_LOWBATT };
+static HSM_BUS stBus;
+static uint64_t ulWarnings;
+static uint32_t uReleased;
+
+static HSM_EVENT BENCH_StateSleepHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_TOGGLE)
+    {
+        HSM_Tran(This, &BENCH_StateAwakeBusy, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_StateAwakeHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_LOWBATT)
+    {
+        ((BENCH_DEV *)This)->level += ((BENCH_BATT *)param)->level;
+        ulWarnings++;
+        return 0;
+    }
+    if (event == BENCH_EVT_TOGGLE)
+    {
+        HSM_Tran(This, &BENCH_StateSleep, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_StateAwakeBusyHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    return event;
+}
+
+static void BENCH_Release(HSM_MSG *msg)
+{
+    uReleased++;
+    free(msg);
+}
+
+static BENCH_BATT *BENCH_NewBatt(uint32_t level)
+{
+    BENCH_BATT *batt = malloc(sizeof(BENCH_BATT));
+    HSM_MSG_Create(&batt->msg, BENCH_Release);
+    batt->level = level;
+    return batt;
+}
+
+// Toggles one instance per broadcast and toggles it back on the next, so one instance in 8 stays awake
+static void BENCH_Toggle(BENCH_DEV *aDev, uint32_t instances, uint32_t round)
+{
+    if (round)
+    {
+        HSM_Run((HSM *)&aDev[((round - 1) * 7919) % instances], BENCH_EVT_TOGGLE, NULL);
+    }
+    HSM_Run((HSM *)&aDev[(round * 7919) % instances], BENCH_EVT_TOGGLE, NULL);
+}
+
+static double BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void BENCH_Create(BENCH_DEV *aDev, uint32_t instances, uint8_t join)
+{
+    uint32_t idx;
+    HSM_BUS_Create(&stBus);
+    for (idx = 0; idx < instances; idx++)
+    {
+        HSM_Create((HSM *)&aDev[idx], "Dev", (idx % 8) ? &BENCH_StateSleep : &BENCH_StateAwakeBusy);
+        aDev[idx].level = 0;
+        if (join)
+        {
+            HSM_BUS_Join(&stBus, (HSM *)&aDev[idx], aDev[idx].subs, 1);
+        }
+    }
+    ulWarnings = 0;
+    uReleased = 0;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t uInstances = (argc > 1) ? atoi(argv[1]) : 10000;
+    uint32_t uBroadcasts = (argc > 2) ? atoi(argv[2]) : 10000;
+    BENCH_DEV *aDev = malloc(uInstances * sizeof(BENCH_DEV));
+    BENCH_BATT *batt;
+    uint64_t ulLoopWarnings;
+    uint64_t ulLoopLevel = 0;
+    uint64_t ulBusLevel = 0;
+    uint32_t round;
+    uint32_t idx;
+    double start;
+    double loop;
+    double bus;
+
+    HSM_STATE_Create(&BENCH_StateSleep, "Sleep", BENCH_StateSleepHndlr, NULL);
+    HSM_STATE_Create(&BENCH_StateAwake, "Awake", BENCH_StateAwakeHndlr, NULL);
+    HSM_STATE_Create(&BENCH_StateAwakeBusy, "Awake.Busy", BENCH_StateAwakeBusyHndlr, &BENCH_StateAwake);
+    HSM_STATE_Subscribe(&BENCH_StateAwake, aeAwakeEvents, 1);
+    HSM_STATE_Subscribe(&BENCH_StateAwakeBusy, aeAwakeEvents, 1);
+
+    // 1) Loop over every instance: O(instances) per broadcast
+    BENCH_Create(aDev, uInstances, 0);
+    start = BENCH_Now();
+    for (round = 0; round < uBroadcasts; round++)
+    {
+        BENCH_Toggle(aDev, uInstances, round);
+        batt = BENCH_NewBatt(round % 100);
+        for (idx = 0; idx < uInstances; idx++)
+        {
+            HSM_Run((HSM *)&aDev[idx], BENCH_EVT_LOWBATT, batt);
+        }
+        HSM_MSG_Unref(&batt->msg);
+    }
+    loop = BENCH_Now() - start;
+    ulLoopWarnings = ulWarnings;
+    for (idx = 0; idx < uInstances; idx++)
+    {
+        ulLoopLevel += aDev[idx].level;
+    }
+
+    // 2) Bus: O(subscribers) per broadcast, the subscriptions follow the transitions
+    BENCH_Create(aDev, uInstances, 1);
+    start = BENCH_Now();
+    for (round = 0; round < uBroadcasts; round++)
+    {
+        BENCH_Toggle(aDev, uInstances, round);
+        HSM_BUS_Publish(&stBus, BENCH_EVT_LOWBATT, &BENCH_NewBatt(round % 100)->msg);
+    }
+    bus = BENCH_Now() - start;
+    for (idx = 0; idx < uInstances; idx++)
+    {
+        ulBusLevel += aDev[idx].level;
+    }
+
+    printf("instances:%u broadcasts:%u deliveries:%llu\n", uInstances, uBroadcasts, (unsigned long long)ulWarnings);
+    printf("loop %9.1f ns/broadcast\n", loop / uBroadcasts);
+    printf("bus  %9.1f ns/broadcast  speedup %.1fx\n", bus / uBroadcasts, loop / bus);
+    free(aDev);
+    if (ulWarnings != ulLoopWarnings || ulBusLevel != ulLoopLevel || uReleased != uBroadcasts ||
+        stBus.delivered != ulWarnings)
+    {
+        printf("Delivery mismatch: loop %llu released %u\n", (unsigned long long)ulLoopWarnings, uReleased);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+"""
+
+# Benchmark of hsm.py against the hsmc extension module: the silent camera chart runs the same events with the
+# dispatch in Python, with the dispatch in hsm.c, with run_many() and with a C handler for the hot state.
+# Run from bench/ after "make -C ../python" with PYTHONPATH=..:../python
+import ctypes
+import os
+import sys
+import time
+
+import hsm
+import hsmc
+
+# Integer events are passed to hsm.c unchanged, so the C handler of bench_python_hot.c sees the same values
+PWR, RELEASE, MODE, LOWBATT = range(hsm.HSM_Event.FIRST, hsm.HSM_Event.FIRST + 4)
+SEQUENCE = [PWR] + [RELEASE] * 6 + [MODE, RELEASE, MODE, MODE, RELEASE, LOWBATT, PWR]
+
+def MakeCamera(base, hot=None):
+    '''Returns the camera derived from hsm.HSM or hsmc.HSM, with the handler of On.Shoot given by hot(stateOnDisp)'''
+    ENTRY, EXIT, INIT = base is hsm.HSM and (hsm.HSM_Event.ENTRY, hsm.HSM_Event.EXIT, hsm.HSM_Event.INIT) or \
+        (hsmc.HSM_Event.ENTRY, hsmc.HSM_Event.EXIT, hsmc.HSM_Event.INIT)
+
+    class Camera(base):
+        def __init__(self):
+            super(Camera, self).__init__("Bench")
+            self.trace = {}
+            self.stateOff = self.CreateState("Off", self.StateOffHndlr)
+            self.stateOn = self.CreateState("On", self.StateOnHndlr)
+            self.stateOnDisp = self.CreateState("On.Disp", self.StateOnDispHndlr, self.stateOn)
+            self.stateOnShoot = self.CreateState("On.Shoot", hot(self.stateOnDisp) if hot else self.StateOnShootHndlr,
+                                                 self.stateOn)
+            self.stateOnDispPlay = self.CreateState("On.Disp.Play", self.StateOnDispPlayHndlr, self.stateOnDisp)
+            self.stateOnDispMenu = self.CreateState("On.Disp.Menu", self.StateOnDispMenuHndlr, self.stateOnDisp)
+            self.SetInitState(self.stateOff)
+
+        def Count(self, name, event):
+            self.trace[name, event] = self.trace.get((name, event), 0) + 1
+
+        def StateOffHndlr(self, event):
+            self.Count("Off", event)
+            if event == PWR:
+                self.Tran(self.stateOn)
+                return None
+            return event
+
+        def StateOnHndlr(self, event):
+            self.Count("On", event)
+            if event == INIT:
+                self.Tran(self.stateOnShoot)
+            elif event == PWR:
+                self.Tran(self.stateOff)
+                return None
+            elif event == LOWBATT:
+                return None
+            return event
+
+        def StateOnShootHndlr(self, event):
+            self.Count("On.Shoot", event)
+            if event == RELEASE:
+                return None
+            elif event == MODE:
+                self.Tran(self.stateOnDisp)
+                return None
+            return event
+
+        def StateOnDispHndlr(self, event):
+            self.Count("On.Disp", event)
+            if event == INIT:
+                self.Tran(self.stateOnDispPlay)
+            elif event == RELEASE:
+                return None
+            elif event == MODE:
+                self.Tran(self.stateOnShoot)
+                return None
+            return event
+
+        def StateOnDispPlayHndlr(self, event):
+            self.Count("On.Disp.Play", event)
+            if event == MODE:
+                self.Tran(self.stateOnDispMenu)
+                return None
+            return event
+
+        def StateOnDispMenuHndlr(self, event):
+            self.Count("On.Disp.Menu", event)
+            return event
+
+    return Camera()
+
+def Bench(name, camera, events, many):
+    start = time.perf_counter()
+    if many:
+        camera.run_many(events)
+    else:
+        for event in events:
+            camera.Run(event)
+    ns = (time.perf_counter() - start) * 1e9 / len(events)
+    print("%-10s %7.1f ns/event" % (name, ns))
+    return ns
+
+def main():
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else 20000
+    events = SEQUENCE * count
+    lib = ctypes.PyDLL(os.path.join(os.path.dirname(os.path.abspath(__file__)), "bench_python_hot.so"))
+    lib.BENCH_Hot.restype = ctypes.py_object
+    lib.BENCH_Hot.argtypes = [ctypes.py_object]
+    shots = ctypes.c_long.in_dll(lib, "lBenchShots")
+
+    cameras = [MakeCamera(hsm.HSM), MakeCamera(hsmc.HSM), MakeCamera(hsmc.HSM), MakeCamera(hsmc.HSM, lib.BENCH_Hot)]
+    py = Bench("hsm.py", cameras[0], events, False)
+    run = Bench("hsmc", cameras[1], events, False)
+    many = Bench("run_many", cameras[2], events, True)
+    hot = Bench("C handler", cameras[3], events, True)
+
+    # All the cameras must see the same events, except the hot state that runs in C
+    for camera in cameras[1:3]:
+        if camera.trace != cameras[0].trace or camera.GetState().name != cameras[0].GetState().name:
+            print("Trace mismatch")
+            return 1
+    pytrace = dict((key, val) for key, val in cameras[0].trace.items() if key[0] != "On.Shoot")
+    if cameras[3].trace != pytrace or shots.value != cameras[0].trace["On.Shoot", RELEASE]:
+        print("Trace mismatch: C handler")
+        return 1
+    print("speedup hsmc %.2fx  run_many %.2fx  C handler %.2fx" % (py / run, py / many, py / hot))
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
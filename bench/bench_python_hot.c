@@ -0,0 +1,72 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// C handler of the hot state of bench_python.py, loaded with ctypes and registered with hsmc.HSM.CreateState()
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include "hsmc.h"
+
+// Events of bench_python.py
+#define BENCH_EVT_RELEASE   5
+#define BENCH_EVT_MODE      6
+
+static HSMC_API *pstApi;
+static HSM_STATE *pstDisp;
+long lBenchShots;
+
+static HSM_EVENT BENCH_ShootHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_RELEASE)
+    {
+        lBenchShots++;
+        return 0;
+    }
+    else if (event == BENCH_EVT_MODE)
+    {
+        pstApi->tran(This, pstDisp, 0, ((void *)0));
+        return 0;
+    }
+    else if (event == HSME_ENTRY || event == HSME_EXIT || event == HSME_INIT)
+    {
+        return 0;
+    }
+    return event;
+}
+
+// Returns the handler as an hsmc.handler capsule, once the state it transitions to is known
+PyObject *BENCH_Hot(PyObject *disp)
+{
+    pstApi = (HSMC_API *)PyCapsule_Import(HSMC_API_CAPSULE, 0);
+    if (!pstApi)
+    {
+        return ((void *)0);
+    }
+    pstDisp = pstApi->state(disp);
+    if (!pstDisp)
+    {
+        PyErr_SetString(PyExc_TypeError, "not an hsmc.State");
+        return ((void *)0);
+    }
+    lBenchShots = 0;
+    return PyCapsule_New((void *)BENCH_ShootHndlr, HSMC_HNDLR_CAPSULE, ((void *)0));
+}
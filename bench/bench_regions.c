@@ -0,0 +1,251 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Events per second of a composite state with orthogonal regions, native HSM_STATE_CreateRegion() regions
+// compared with the proxy pattern where the composite state handler runs HSM_Run() on one child HSM per region.
+// Each region has two leaves: PING is handled by the active leaf, TICK moves to the other leaf, and CYCLE
+// leaves the composite state and enters it again, exiting and entering every region.
+// Usage: regions [events]
+#include "hsm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_EVT_PING      (HSME_START)
+#define BENCH_EVT_TICK      (HSME_START + 1)
+#define BENCH_EVT_CYCLE     (HSME_START + 2)
+#define BENCH_EVT_BACK      (HSME_START + 3)
+#define BENCH_REGIONS       4
+
+static uint32_t auPings[2][BENCH_REGIONS];
+
+//----Native regions----
+static HSM_STATE stIdle;
+static HSM_STATE stComposite;
+static HSM_STATE astRegion[BENCH_REGIONS];
+static HSM_STATE astLeaf[BENCH_REGIONS][2];
+
+static HSM_EVENT BENCH_IdleHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_BACK)
+    {
+        HSM_Tran(This, &stComposite, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_CompositeHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_CYCLE)
+    {
+        HSM_Tran(This, &stIdle, 0, NULL);
+        HSM_Run(This, BENCH_EVT_BACK, 0);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_RegionHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_INIT)
+    {
+        HSM_Tran(This, &astLeaf[This->region][0], 0, NULL);
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_LeafHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    HSM_STATE *leaf = This->regions[This->region];
+    if (event == BENCH_EVT_PING)
+    {
+        auPings[0][This->region]++;
+        return 0;
+    }
+    else if (event == BENCH_EVT_TICK)
+    {
+        HSM_Tran(This, (leaf == &astLeaf[This->region][0]) ? &astLeaf[This->region][1] : &astLeaf[This->region][0], 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+//----Proxy pattern----
+typedef struct BENCH_PART_T
+{
+    HSM parent;
+    uint8_t index;
+} BENCH_PART;
+
+static HSM stProxy;
+static BENCH_PART astPart[BENCH_REGIONS];
+static HSM_STATE stProxyIdle;
+static HSM_STATE stProxyComposite;
+static HSM_STATE stPartOff;
+static HSM_STATE astPartLeaf[2];
+
+static HSM_EVENT BENCH_ProxyIdleHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_BACK)
+    {
+        HSM_Tran(This, &stProxyComposite, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_ProxyCompositeHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    uint8_t idx;
+    if (event == HSME_ENTRY || event == HSME_EXIT)
+    {
+        // The child machines are entered and exited with the composite state
+        for (idx = 0; idx < BENCH_REGIONS; idx++)
+        {
+            HSM_Run(&astPart[idx].parent, event == HSME_ENTRY ? BENCH_EVT_BACK : BENCH_EVT_CYCLE, 0);
+        }
+    }
+    else if (event == BENCH_EVT_CYCLE)
+    {
+        HSM_Tran(This, &stProxyIdle, 0, NULL);
+        HSM_Run(This, BENCH_EVT_BACK, 0);
+        return 0;
+    }
+    else if (event != HSME_INIT)
+    {
+        // Forward the event to every child machine
+        for (idx = 0; idx < BENCH_REGIONS; idx++)
+        {
+            HSM_Run(&astPart[idx].parent, event, param);
+        }
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_PartOffHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_BACK)
+    {
+        HSM_Tran(This, &astPartLeaf[0], 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_PartLeafHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_PING)
+    {
+        auPings[1][((BENCH_PART *)This)->index]++;
+        return 0;
+    }
+    else if (event == BENCH_EVT_TICK)
+    {
+        HSM_Tran(This, (This->curState == &astPartLeaf[0]) ? &astPartLeaf[1] : &astPartLeaf[0], 0, NULL);
+        return 0;
+    }
+    else if (event == BENCH_EVT_CYCLE)
+    {
+        HSM_Tran(This, &stPartOff, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static double BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t uEvents = (argc > 1) ? strtoul(argv[1], NULL, 0) : 2000000;
+    const char *apcName[] = { "PING", "TICK", "CYCLE" };
+    HSM stNative;
+    uint32_t idx;
+    uint32_t cnt;
+    double start;
+    double native;
+    double proxy;
+    uint8_t evt;
+
+    HSM_STATE_Create(&stIdle, "Idle", BENCH_IdleHndlr, NULL);
+    HSM_STATE_Create(&stComposite, "Composite", BENCH_CompositeHndlr, NULL);
+    for (idx = 0; idx < BENCH_REGIONS; idx++)
+    {
+        HSM_STATE_CreateRegion(&astRegion[idx], "Region", BENCH_RegionHndlr, &stComposite);
+        HSM_STATE_Create(&astLeaf[idx][0], "Leaf0", BENCH_LeafHndlr, &astRegion[idx]);
+        HSM_STATE_Create(&astLeaf[idx][1], "Leaf1", BENCH_LeafHndlr, &astRegion[idx]);
+    }
+    HSM_Create(&stNative, "Native", &stComposite);
+
+    HSM_STATE_Create(&stProxyIdle, "Idle", BENCH_ProxyIdleHndlr, NULL);
+    HSM_STATE_Create(&stProxyComposite, "Composite", BENCH_ProxyCompositeHndlr, NULL);
+    HSM_STATE_Create(&stPartOff, "Off", BENCH_PartOffHndlr, NULL);
+    HSM_STATE_Create(&astPartLeaf[0], "Leaf0", BENCH_PartLeafHndlr, NULL);
+    HSM_STATE_Create(&astPartLeaf[1], "Leaf1", BENCH_PartLeafHndlr, NULL);
+    for (idx = 0; idx < BENCH_REGIONS; idx++)
+    {
+        astPart[idx].index = idx;
+        HSM_Create(&astPart[idx].parent, "Part", &stPartOff);
+    }
+    HSM_Create(&stProxy, "Proxy", &stProxyComposite);
+
+    printf("regions:%u  events:%u\n", BENCH_REGIONS, uEvents);
+    for (evt = BENCH_EVT_PING; evt <= BENCH_EVT_CYCLE; evt++)
+    {
+        // Fewer cycles, each one exits and enters every region
+        uint32_t uCount = (evt == BENCH_EVT_CYCLE) ? uEvents / 10 : uEvents;
+        start = BENCH_Now();
+        for (cnt = 0; cnt < uCount; cnt++)
+        {
+            HSM_Run(&stNative, evt, 0);
+        }
+        native = BENCH_Now() - start;
+
+        start = BENCH_Now();
+        for (cnt = 0; cnt < uCount; cnt++)
+        {
+            HSM_Run(&stProxy, evt, 0);
+        }
+        proxy = BENCH_Now() - start;
+
+        printf("%-5s proxy:%7.2f Mevents/s  native:%7.2f Mevents/s  speedup %.2fx\n", apcName[evt - BENCH_EVT_PING],
+               (double)uCount * 1e3 / proxy, (double)uCount * 1e3 / native, proxy / native);
+    }
+
+    // Both models must end in the same states and handle the same events
+    for (idx = 0; idx < BENCH_REGIONS; idx++)
+    {
+        if (auPings[0][idx] != auPings[1][idx] ||
+            stNative.regions[astRegion[idx].region] - astLeaf[idx] != astPart[idx].parent.curState - astPartLeaf)
+        {
+            printf("Region %u mismatch\n", idx);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,213 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Records random traffic of a fleet of instances with HSM_RECORD, then replays the log at full speed on a
+// fresh fleet with HSM_REPLAY_File(), checking that every call ends in the recorded state.  Reports the
+// overhead of recording and the replay throughput.  With -c the chart is changed before the replay, so
+// the replay reports the calls that no longer end in the same state.
+// Usage: replay [-c] [instances] [events] [log file]
+#include "hsm_record.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_EVT_PWR       (HSME_START)
+#define BENCH_EVT_MODE      (HSME_START + 1)
+#define BENCH_EVT_SHOOT     (HSME_START + 2)
+
+static HSM_STATE BENCH_StateOff;
+static HSM_STATE BENCH_StateOn;
+static HSM_STATE BENCH_StateOnShoot;
+static HSM_STATE BENCH_StateOnDisp;
+static HSM_STATE *apstStates[] = { &BENCH_StateOff, &BENCH_StateOn, &BENCH_StateOnShoot, &BENCH_StateOnDisp };
+static uint8_t bChanged;
+
+static HSM_EVENT BENCH_StateOffHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_PWR)
+    {
+        HSM_Tran(This, &BENCH_StateOn, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_StateOnHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_INIT)
+    {
+        HSM_Tran(This, &BENCH_StateOnShoot, 0, NULL);
+        return 0;
+    }
+    if (event == BENCH_EVT_PWR)
+    {
+        HSM_Tran(This, &BENCH_StateOff, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_StateOnShootHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_SHOOT)
+    {
+        // The changed chart powers off after a shot
+        if (bChanged)
+        {
+            HSM_Tran(This, &BENCH_StateOff, 0, NULL);
+        }
+        return 0;
+    }
+    if (event == BENCH_EVT_MODE)
+    {
+        HSM_Tran(This, &BENCH_StateOnDisp, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_StateOnDispHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_MODE)
+    {
+        HSM_Tran(This, &BENCH_StateOnShoot, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+typedef struct BENCH_FLEET_T
+{
+    HSM *aHsm;
+    uint32_t base;              // Record ID of the first instance of the fleet
+    uint32_t created;           // Instances created by the replay
+} BENCH_FLEET;
+
+// Replay callback: the fleet is created in one go, so the record ID gives the instance
+static HSM *BENCH_Instance(void *ctx, const HSM_RECORD *record)
+{
+    BENCH_FLEET *fleet = (BENCH_FLEET *)ctx;
+    uint32_t idx;
+    if (record->type == HSM_RECORD_CREATE)
+    {
+        if (0 == fleet->created++)
+        {
+            fleet->base = record->instance;
+        }
+        for (idx = 0; idx < sizeof(apstStates) / sizeof(apstStates[0]); idx++)
+        {
+            if (apstStates[idx]->recId == (uint32_t)record->param)
+            {
+                HSM_Create(&fleet->aHsm[record->instance - fleet->base], "Camera", apstStates[idx]);
+            }
+        }
+    }
+    return &fleet->aHsm[record->instance - fleet->base];
+}
+
+static double BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double BENCH_Traffic(HSM *aHsm, uint32_t uInstances, uint32_t uEvents)
+{
+    uint32_t seed = 1;
+    uint32_t idx;
+    double start = BENCH_Now();
+    for (idx = 0; idx < uEvents; idx++)
+    {
+        seed = seed * 1103515245 + 12345;
+        HSM_Run(&aHsm[(seed >> 8) % uInstances], BENCH_EVT_PWR + (seed >> 16) % 3, 0);
+    }
+    return BENCH_Now() - start;
+}
+
+int main(int argc, char *argv[])
+{
+    int arg = 1;
+    uint8_t changed = 0;
+    uint32_t uInstances;
+    uint32_t uEvents;
+    const char *path;
+    HSM *aHsm;
+    BENCH_FLEET fleet;
+    HSM_REPLAY_STATS stats;
+    uint32_t idx;
+    double plain;
+    double recorded;
+
+    if (argc > arg && 0 == strcmp(argv[arg], "-c"))
+    {
+        changed = 1;
+        arg++;
+    }
+    uInstances = (argc > arg) ? atoi(argv[arg]) : 1000;
+    uEvents = (argc > arg + 1) ? atoi(argv[arg + 1]) : 2000000;
+    path = (argc > arg + 2) ? argv[arg + 2] : "replay.bin";
+    aHsm = calloc(uInstances, sizeof(HSM));
+    HSM_STATE_Create(&BENCH_StateOff, "Off", BENCH_StateOffHndlr, NULL);
+    HSM_STATE_Create(&BENCH_StateOn, "On", BENCH_StateOnHndlr, NULL);
+    HSM_STATE_Create(&BENCH_StateOnShoot, "OnShoot", BENCH_StateOnShootHndlr, &BENCH_StateOn);
+    HSM_STATE_Create(&BENCH_StateOnDisp, "OnDisp", BENCH_StateOnDispHndlr, &BENCH_StateOn);
+
+    // 1) Same traffic without and with recording
+    for (idx = 0; idx < uInstances; idx++)
+    {
+        HSM_Create(&aHsm[idx], "Camera", &BENCH_StateOff);
+    }
+    plain = BENCH_Traffic(aHsm, uInstances, uEvents);
+    if (!HSM_RECORD_Start(path))
+    {
+        printf("Cannot open %s\n", path);
+        return 1;
+    }
+    for (idx = 0; idx < uInstances; idx++)
+    {
+        HSM_Create(&aHsm[idx], "Camera", &BENCH_StateOff);
+    }
+    recorded = BENCH_Traffic(aHsm, uInstances, uEvents);
+    HSM_RECORD_Stop();
+
+    // 2) Replay on a fresh fleet
+    bChanged = changed;
+    memset(aHsm, 0, uInstances * sizeof(HSM));
+    fleet.aHsm = aHsm;
+    fleet.base = 0;
+    fleet.created = 0;
+    if (!HSM_REPLAY_File(path, BENCH_Instance, &fleet, 0, &stats))
+    {
+        printf("Cannot replay %s\n", path);
+        return 1;
+    }
+    remove(path);
+    printf("instances:%u events:%u log:%llu records\n", uInstances, uEvents, (unsigned long long)stats.records);
+    printf("run     %6.1f ns/event\n", plain / uEvents);
+    printf("record  %6.1f ns/event\n", recorded / uEvents);
+    printf("replay  %6.1f ns/event  %.2f Mevents/s  mismatches:%llu\n", (double)stats.elapsed / stats.runs,
+           stats.runs * 1e3 / stats.elapsed, (unsigned long long)stats.mismatches);
+    free(aHsm);
+    return (stats.mismatches && !bChanged) ? 1 : 0;
+}
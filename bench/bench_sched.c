@@ -0,0 +1,215 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Events per second of the HSM_SCHED active object scheduler with 1/2/4/8/N worker threads.  Each
+// of the actors starts with one token that hops around a ring of actors; every hop is one event
+// that runs a small amount of handler work.  A token that finds the next mailbox full is handed
+// to the main thread, which posts it again, so every run does the same work.  The handler also
+// checks that no two workers ever run the same HSM at once.  More workers than CPUs only add
+// contention, so only compare the runs up to the number of online CPUs.
+// Usage: sched [actors] [hops] [work]
+#include "hsm_sched.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_EVT_TOKEN     (HSME_START)
+
+typedef struct BENCH_NODE_T
+{
+    HSM parent;
+    HSM_ACTOR actor;
+    atomic_uint running;        // Set while a worker runs the handler
+    uint64_t events;            // Events handled by this node
+    uint32_t index;
+} BENCH_NODE;
+
+static HSM_STATE BENCH_StateRun;
+static BENCH_NODE *pstNodes;
+static uint32_t uNodes = 10000;
+static uint32_t uHops = 200;
+static uint32_t uWork = 100;
+static atomic_uint uFinished;
+static atomic_uint uRetries;
+static atomic_uint uOverlaps;
+
+// Tokens waiting to be posted again by the main thread, at most one per actor
+typedef struct BENCH_RETRY_T
+{
+    uint32_t target;
+    uintptr_t hops;
+} BENCH_RETRY;
+static pthread_mutex_t stRetryLock = PTHREAD_MUTEX_INITIALIZER;
+static BENCH_RETRY *pstRetry;
+static uint32_t uRetryCount;
+
+static HSM_EVENT BENCH_StateRunHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    BENCH_NODE *node = (BENCH_NODE *)This;
+    uintptr_t hops = (uintptr_t)param;
+    uint32_t x = node->index + 1;
+    uint32_t idx;
+    if (event == BENCH_EVT_TOKEN)
+    {
+        if (atomic_exchange(&node->running, 1))
+        {
+            atomic_fetch_add(&uOverlaps, 1);
+        }
+        // Simulated handler work
+        for (idx = 0; idx < uWork; idx++)
+        {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+        }
+        node->events += 1 + (x == 0);
+        atomic_store(&node->running, 0);
+        if (0 == hops)
+        {
+            atomic_fetch_add(&uFinished, 1);
+        }
+        else if (!HSM_ACTOR_Post(&pstNodes[(node->index + 1) % uNodes].actor, BENCH_EVT_TOKEN, (void *)(hops - 1)))
+        {
+            // Waiting here could block the worker that must empty the mailbox
+            pthread_mutex_lock(&stRetryLock);
+            pstRetry[uRetryCount].target = (node->index + 1) % uNodes;
+            pstRetry[uRetryCount].hops = hops - 1;
+            uRetryCount++;
+            pthread_mutex_unlock(&stRetryLock);
+            atomic_fetch_add(&uRetries, 1);
+        }
+        return 0;
+    }
+    return event;
+}
+
+static double BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Posts the tokens that found a full mailbox again, keeping those that still do not fit
+static void BENCH_Retry(void)
+{
+    uint32_t idx;
+    uint32_t keep = 0;
+    pthread_mutex_lock(&stRetryLock);
+    for (idx = 0; idx < uRetryCount; idx++)
+    {
+        if (!HSM_ACTOR_Post(&pstNodes[pstRetry[idx].target].actor, BENCH_EVT_TOKEN, (void *)pstRetry[idx].hops))
+        {
+            pstRetry[keep++] = pstRetry[idx];
+        }
+    }
+    uRetryCount = keep;
+    pthread_mutex_unlock(&stRetryLock);
+}
+
+static void BENCH_Measure(uint16_t workers)
+{
+    HSM_SCHED *sched = malloc(sizeof(HSM_SCHED));
+    uint64_t events = 0;
+    uint32_t idx;
+    double start;
+    double elapsed;
+
+    atomic_store(&uFinished, 0);
+    atomic_store(&uRetries, 0);
+    atomic_store(&uOverlaps, 0);
+    if (!HSM_SCHED_Create(sched, workers))
+    {
+        exit(1);
+    }
+    for (idx = 0; idx < uNodes; idx++)
+    {
+        pstNodes[idx].index = idx;
+        pstNodes[idx].events = 0;
+        atomic_init(&pstNodes[idx].running, 0);
+        HSM_Create(&pstNodes[idx].parent, "Node", &BENCH_StateRun);
+        HSM_ACTOR_Create(&pstNodes[idx].actor, sched, &pstNodes[idx].parent);
+    }
+    start = BENCH_Now();
+    for (idx = 0; idx < uNodes; idx++)
+    {
+        HSM_ACTOR_Post(&pstNodes[idx].actor, BENCH_EVT_TOKEN, (void *)(uintptr_t)uHops);
+    }
+    while (atomic_load(&uFinished) < uNodes)
+    {
+        BENCH_Retry();
+        usleep(100);
+    }
+    elapsed = BENCH_Now() - start;
+    HSM_SCHED_Destroy(sched);
+    free(sched);
+
+    for (idx = 0; idx < uNodes; idx++)
+    {
+        events += pstNodes[idx].events;
+    }
+    printf("workers:%-3u %8.2f Mevents/s  events:%llu  retries:%u  overlaps:%u\n", workers, events * 1e3 / elapsed,
+           (unsigned long long)events, atomic_load(&uRetries), atomic_load(&uOverlaps));
+    if (atomic_load(&uOverlaps))
+    {
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t aWorkers[] = { 1, 2, 4, 8, 0 };
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint8_t idx;
+
+    if (argc > 1)
+    {
+        uNodes = atoi(argv[1]);
+    }
+    if (argc > 2)
+    {
+        uHops = atoi(argv[2]);
+    }
+    if (argc > 3)
+    {
+        uWork = atoi(argv[3]);
+    }
+    pstNodes = calloc(uNodes, sizeof(BENCH_NODE));
+    pstRetry = calloc(uNodes, sizeof(BENCH_RETRY));
+    HSM_STATE_Create(&BENCH_StateRun, "Run", BENCH_StateRunHndlr, NULL);
+
+    aWorkers[4] = (cpus > HSM_SCHED_MAX_WORKERS) ? HSM_SCHED_MAX_WORKERS : (uint16_t)cpus;
+    for (idx = 0; idx < 5; idx++)
+    {
+        // The last entry is the number of online CPUs, skip it if it was already measured
+        if (idx == 4 && (aWorkers[4] == 1 || aWorkers[4] == 2 || aWorkers[4] == 4 || aWorkers[4] == 8))
+        {
+            break;
+        }
+        BENCH_Measure(aWorkers[idx]);
+    }
+    free(pstNodes);
+    free(pstRetry);
+    return 0;
+}
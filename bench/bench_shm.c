@@ -0,0 +1,340 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Events with 64 byte payloads posted to an HSM instance in another process: a Unix domain socket carrying the
+// serialized payload, compared with the shared memory transport building the payload in place.  A forked server
+// runs the events, and replies to a ping so the client can measure the round trip.
+//   Throughput: the client posts the events as fast as the server runs them, then pings and waits for the reply
+//   Latency: the client pings and waits for the reply, one at a time
+// Both processes sleep when they have nothing to run.  With several cores, spin polls of the segment before
+// sleeping trade CPU for latency.
+// Usage: shm [events] [pings] [spin]
+#include "hsm_shm.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_EVT_DATA      (HSME_START)
+#define BENCH_EVT_PING      (HSME_START + 1)
+#define BENCH_EVT_PONG      (HSME_START + 2)
+#define BENCH_EVT_STOP      (HSME_START + 3)
+
+typedef struct BENCH_MSG_T
+{
+    uint32_t seq;
+    uint8_t data[60];
+} BENCH_MSG;
+
+// Header of a message on the socket, followed by the payload
+typedef struct BENCH_HDR_T
+{
+    HSM_EVENT event;
+    uint32_t len;
+} BENCH_HDR;
+
+// One side of the connection between client and server
+typedef struct BENCH_LINK_T
+{
+    HSM parent;
+    uint8_t shm;                // 1 - shared memory, 0 - socket
+    HSM_SHM tx;                 // Channel to the peer
+    HSM_SHM rx;                 // Segment receiving from the peer
+    HSM *rxHsm[1];
+    int fd;                     // Socket to the peer
+    uint32_t len;               // Bytes received on the socket not run yet
+    uint8_t buf[65536];
+    uint32_t spin;              // Polls of the segment before sleeping
+    uint64_t sum;               // Sum of the sequence numbers of the data received
+    uint32_t count;             // Data received
+    uint32_t pongs;             // Replies received
+    uint32_t pong;              // Sequence number of the last reply
+    uint8_t stop;
+} BENCH_LINK;
+
+static HSM_STATE BENCH_StateServer;
+static HSM_STATE BENCH_StateClient;
+
+static uint64_t BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Builds the payload in the shared memory arena, or serializes it for the socket
+static void BENCH_Send(BENCH_LINK *This, HSM_EVENT event, uint32_t seq)
+{
+    BENCH_MSG *msg;
+    uint8_t frame[sizeof(BENCH_HDR) + sizeof(BENCH_MSG)];
+    if (This->shm)
+    {
+        // The server runs on the same core, so let it drain the channel
+        while (((void *)0) == (msg = HSM_SHM_Alloc(&This->tx, sizeof(BENCH_MSG))))
+        {
+            sched_yield();
+        }
+        msg->seq = seq;
+        memset(msg->data, (uint8_t)seq, sizeof(msg->data));
+        while (!HSM_SHM_Post(&This->tx, 0, event, msg))
+        {
+            sched_yield();
+        }
+        return;
+    }
+    ((BENCH_HDR *)frame)->event = event;
+    ((BENCH_HDR *)frame)->len = sizeof(BENCH_MSG);
+    msg = (BENCH_MSG *)&frame[sizeof(BENCH_HDR)];
+    msg->seq = seq;
+    memset(msg->data, (uint8_t)seq, sizeof(msg->data));
+    if (write(This->fd, frame, sizeof(frame)) != sizeof(frame))
+    {
+        exit(1);
+    }
+}
+
+// Runs the events received, sleeping until there is one
+static void BENCH_Recv(BENCH_LINK *This)
+{
+    uint32_t poll;
+    uint32_t pos = 0;
+    BENCH_HDR *hdr;
+    ssize_t len;
+    if (This->shm)
+    {
+        for (poll = 0; !HSM_SHM_Dispatch(&This->rx); poll++)
+        {
+            if (poll >= This->spin)
+            {
+                HSM_SHM_Wait(&This->rx, 100);
+            }
+        }
+        return;
+    }
+    len = read(This->fd, &This->buf[This->len], sizeof(This->buf) - This->len);
+    if (len <= 0)
+    {
+        exit(1);
+    }
+    This->len += len;
+    while (This->len - pos >= sizeof(BENCH_HDR))
+    {
+        hdr = (BENCH_HDR *)&This->buf[pos];
+        if (This->len - pos < sizeof(BENCH_HDR) + hdr->len)
+        {
+            break;
+        }
+        HSM_Run((HSM *)This, hdr->event, &This->buf[pos + sizeof(BENCH_HDR)]);
+        pos += sizeof(BENCH_HDR) + hdr->len;
+    }
+    // Keep the partial message
+    memmove(This->buf, &This->buf[pos], This->len - pos);
+    This->len -= pos;
+}
+
+static HSM_EVENT BENCH_StateServerHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    BENCH_LINK *link = (BENCH_LINK *)This;
+    if (event == BENCH_EVT_DATA)
+    {
+        link->sum += ((BENCH_MSG *)param)->seq;
+        link->count++;
+        return 0;
+    }
+    if (event == BENCH_EVT_PING)
+    {
+        BENCH_Send(link, BENCH_EVT_PONG, ((BENCH_MSG *)param)->seq);
+        return 0;
+    }
+    if (event == BENCH_EVT_STOP)
+    {
+        // Reply with a checksum of the data received
+        BENCH_Send(link, BENCH_EVT_PONG, (uint32_t)(link->sum ^ link->count));
+        link->stop = 1;
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_StateClientHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    BENCH_LINK *link = (BENCH_LINK *)This;
+    if (event == BENCH_EVT_PONG)
+    {
+        link->pong = ((BENCH_MSG *)param)->seq;
+        link->pongs++;
+        return 0;
+    }
+    return event;
+}
+
+static void BENCH_Wait(BENCH_LINK *This, uint32_t pongs)
+{
+    while (This->pongs < pongs)
+    {
+        BENCH_Recv(This);
+    }
+}
+
+static int BENCH_Cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void BENCH_Serve(BENCH_LINK *This, const char *rxName, const char *txName, int ready)
+{
+    HSM_Create((HSM *)This, "Server", &BENCH_StateServer);
+    if (This->shm)
+    {
+        This->rxHsm[0] = (HSM *)This;
+        if (!HSM_SHM_Create(&This->rx, rxName, This->rxHsm, 1) || !HSM_SHM_Open(&This->tx, txName))
+        {
+            exit(1);
+        }
+    }
+    if (write(ready, "", 1) != 1)
+    {
+        exit(1);
+    }
+    while (!This->stop)
+    {
+        BENCH_Recv(This);
+    }
+    if (This->shm)
+    {
+        HSM_SHM_Close(&This->tx);
+        HSM_SHM_Close(&This->rx);
+    }
+    exit(0);
+}
+
+static int BENCH_Run(const char *label, uint8_t shm, uint32_t events, uint32_t pings, uint32_t spin, uint32_t *lat)
+{
+    static BENCH_LINK stClient;
+    static BENCH_LINK stServer;
+    char cliName[64];
+    char srvName[64];
+    int fds[2];
+    int ready[2];
+    char byte;
+    pid_t pid;
+    uint64_t start;
+    uint64_t sum = 0;
+    uint32_t idx;
+    double elapsed;
+    snprintf(cliName, sizeof(cliName), "/hsm_bench_%d_c", (int)getpid());
+    snprintf(srvName, sizeof(srvName), "/hsm_bench_%d_s", (int)getpid());
+    memset(&stClient, 0, sizeof(stClient));
+    memset(&stServer, 0, sizeof(stServer));
+    stClient.shm = stServer.shm = shm;
+    stClient.spin = stServer.spin = spin;
+    HSM_Create((HSM *)&stClient, "Client", &BENCH_StateClient);
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0 || pipe(ready) < 0)
+    {
+        return 1;
+    }
+    if (shm)
+    {
+        stClient.rxHsm[0] = (HSM *)&stClient;
+        if (!HSM_SHM_Create(&stClient.rx, cliName, stClient.rxHsm, 1))
+        {
+            return 1;
+        }
+    }
+    // The server must not flush the client's output again
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0)
+    {
+        close(fds[0]);
+        stServer.fd = fds[1];
+        BENCH_Serve(&stServer, srvName, cliName, ready[1]);
+    }
+    close(fds[1]);
+    stClient.fd = fds[0];
+    if (read(ready[0], &byte, 1) != 1 || (shm && !HSM_SHM_Open(&stClient.tx, srvName)))
+    {
+        return 1;
+    }
+
+    // Throughput
+    start = BENCH_Now();
+    for (idx = 0; idx < events; idx++)
+    {
+        BENCH_Send(&stClient, BENCH_EVT_DATA, idx);
+        sum += idx;
+    }
+    BENCH_Send(&stClient, BENCH_EVT_PING, 0);
+    BENCH_Wait(&stClient, 1);
+    elapsed = (double)(BENCH_Now() - start);
+
+    // Latency
+    for (idx = 0; idx < pings; idx++)
+    {
+        start = BENCH_Now();
+        BENCH_Send(&stClient, BENCH_EVT_PING, idx);
+        BENCH_Wait(&stClient, idx + 2);
+        lat[idx] = (uint32_t)(BENCH_Now() - start);
+    }
+    BENCH_Send(&stClient, BENCH_EVT_STOP, 0);
+    BENCH_Wait(&stClient, pings + 2);
+    waitpid(pid, ((void *)0), 0);
+    if (shm)
+    {
+        HSM_SHM_Close(&stClient.tx);
+        HSM_SHM_Close(&stClient.rx);
+    }
+    close(fds[0]);
+    close(ready[0]);
+    close(ready[1]);
+    qsort(lat, pings, sizeof(uint32_t), BENCH_Cmp);
+    printf("%-7s %8.0f events/s  %6.1f ns/event  rtt p50 %6.1f us  p99 %6.1f us\n", label, events / (elapsed / 1e9),
+           elapsed / events, lat[pings / 2] / 1e3, lat[(uint64_t)pings * 99 / 100] / 1e3);
+    if (stClient.pong != (uint32_t)(sum ^ events))
+    {
+        printf("Checksum mismatch: %x expected %x\n", stClient.pong, (uint32_t)(sum ^ events));
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t events = (argc > 1) ? atoi(argv[1]) : 1000000;
+    uint32_t pings = (argc > 2) ? atoi(argv[2]) : 20000;
+    uint32_t spin = (argc > 3) ? atoi(argv[3]) : 0;
+    uint32_t *lat = malloc(pings * sizeof(uint32_t));
+    int err;
+    HSM_STATE_Create(&BENCH_StateServer, "Server", BENCH_StateServerHndlr, NULL);
+    HSM_STATE_Create(&BENCH_StateClient, "Client", BENCH_StateClientHndlr, NULL);
+    printf("events:%u pings:%u payload:%u bytes spin:%u\n", events, pings, (unsigned)sizeof(BENCH_MSG), spin);
+    err = BENCH_Run("socket", 0, events, pings, spin, lat);
+    err |= BENCH_Run("shm", 1, events, pings, spin, lat);
+    free(lat);
+    return err;
+}
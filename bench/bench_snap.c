@@ -0,0 +1,188 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Rebuilding a fleet of instances after a restart: replaying the event history of each instance through
+// HSM_Create()/HSM_Run() compared with HSM_SNAP_RestoreFile() of a memory mapped snapshot.  The restored
+// instances are checked against the replayed ones.
+// Usage: snap [instances] [events per instance] [snapshot file]
+#include "hsm_snap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_EVT_PWR       (HSME_START)
+#define BENCH_EVT_MODE      (HSME_START + 1)
+#define BENCH_EVT_SHOOT     (HSME_START + 2)
+
+enum { BENCH_OFF, BENCH_ON, BENCH_ON_SHOOT, BENCH_ON_DISP, BENCH_STATES };
+
+typedef struct BENCH_CAMERA_T
+{
+    HSM parent;
+    uint32_t shots;             // User data saved in the snapshot
+    uint32_t powerCycles;
+} BENCH_CAMERA;
+
+static HSM_STATE astChart[BENCH_STATES];
+static HSM_CHART stChart;
+
+static HSM_EVENT BENCH_StateOffHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_PWR)
+    {
+        ((BENCH_CAMERA *)This)->powerCycles++;
+        HSM_Tran(This, HSM_CHART_STATE(&stChart, BENCH_ON), 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_StateOnHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_INIT)
+    {
+        HSM_Tran(This, HSM_CHART_STATE(&stChart, BENCH_ON_SHOOT), 0, NULL);
+        return 0;
+    }
+    if (event == BENCH_EVT_PWR)
+    {
+        HSM_Tran(This, HSM_CHART_STATE(&stChart, BENCH_OFF), 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_StateOnShootHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_SHOOT)
+    {
+        ((BENCH_CAMERA *)This)->shots++;
+        return 0;
+    }
+    if (event == BENCH_EVT_MODE)
+    {
+        HSM_Tran(This, HSM_CHART_STATE(&stChart, BENCH_ON_DISP), 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_StateOnDispHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_MODE)
+    {
+        HSM_Tran(This, HSM_CHART_STATE(&stChart, BENCH_ON_SHOOT), 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static const HSM_CHART_DEF astDefs[BENCH_STATES] =
+{
+    [BENCH_OFF]      = { "Off",     BENCH_StateOffHndlr,     HSM_CHART_NO_PARENT },
+    [BENCH_ON]       = { "On",      BENCH_StateOnHndlr,      HSM_CHART_NO_PARENT },
+    [BENCH_ON_SHOOT] = { "OnShoot", BENCH_StateOnShootHndlr, BENCH_ON },
+    [BENCH_ON_DISP]  = { "OnDisp",  BENCH_StateOnDispHndlr,  BENCH_ON },
+};
+
+static double BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t uInstances = (argc > 1) ? atoi(argv[1]) : 500000;
+    uint32_t uEvents = (argc > 2) ? atoi(argv[2]) : 32;
+    const char *path = (argc > 3) ? argv[3] : "snap.bin";
+    BENCH_CAMERA *aCamera = calloc(uInstances, sizeof(BENCH_CAMERA));
+    BENCH_CAMERA *aRestored = calloc(uInstances, sizeof(BENCH_CAMERA));
+    HSM_SNAP stSnap;
+    uint32_t idx;
+    uint32_t evt;
+    uint32_t seed = 1;
+    uint8_t result;
+    double start;
+    double replay;
+    double save;
+    double restore;
+
+    if (HSM_CHART_Freeze(&stChart, astDefs, BENCH_STATES, astChart) != HSM_CHART_OK)
+    {
+        return 1;
+    }
+    // 1) Replay a pseudo random history of each instance
+    start = BENCH_Now();
+    for (idx = 0; idx < uInstances; idx++)
+    {
+        HSM_Create((HSM *)&aCamera[idx], "Camera", HSM_CHART_STATE(&stChart, BENCH_OFF));
+        for (evt = 0; evt < uEvents; evt++)
+        {
+            seed = seed * 1103515245 + 12345;
+            HSM_Run((HSM *)&aCamera[idx], BENCH_EVT_PWR + (seed >> 16) % 3, 0);
+        }
+    }
+    replay = BENCH_Now() - start;
+
+    // 2) Save and restore through the snapshot file
+    HSM_SNAP_Create(&stSnap, &stChart, "Camera", aCamera, sizeof(BENCH_CAMERA), uInstances,
+                    sizeof(HSM), sizeof(BENCH_CAMERA) - sizeof(HSM));
+    start = BENCH_Now();
+    result = HSM_SNAP_SaveFile(&stSnap, path);
+    save = BENCH_Now() - start;
+    if (result != HSM_SNAP_OK)
+    {
+        printf("Save failed %u\n", result);
+        return 1;
+    }
+    stSnap.instances = (uint8_t *)aRestored;
+    start = BENCH_Now();
+    result = HSM_SNAP_RestoreFile(&stSnap, path);
+    restore = BENCH_Now() - start;
+    remove(path);
+    if (result != HSM_SNAP_OK)
+    {
+        printf("Restore failed %u\n", result);
+        return 1;
+    }
+
+    for (idx = 0; idx < uInstances; idx++)
+    {
+        if (aRestored[idx].parent.curState != aCamera[idx].parent.curState ||
+            aRestored[idx].shots != aCamera[idx].shots || aRestored[idx].powerCycles != aCamera[idx].powerCycles)
+        {
+            printf("Instance %u mismatch\n", idx);
+            return 1;
+        }
+    }
+    printf("instances:%u events:%u snapshot:%llu bytes\n", uInstances, uEvents,
+           (unsigned long long)HSM_SNAP_Size(&stSnap));
+    printf("replay  %8.2f ms\n", replay / 1e6);
+    printf("save    %8.2f ms\n", save / 1e6);
+    printf("restore %8.2f ms  speedup %.1fx\n", restore / 1e6, replay / restore);
+    free(aCamera);
+    free(aRestored);
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Cost of driving timeouts of many HSM instances: the usual timer list that decrements a countdown per
+// instance and calls HSM_Run() on expiry every tick, compared with HSM_TIMER_Advance() on the timing wheel.
+// Each instance blinks between ON and OFF, arming a one-shot timeout of 100 to 1099 ticks on HSME_ENTRY.
+// The timeout of the wheel is owned by the state and is disarmed by HSM_Tran() on HSME_EXIT.
+// Usage: timer [instances] [ticks]
+#include "hsm_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_EVT_TIMEOUT   (HSME_START)
+
+typedef struct BENCH_LED_T
+{
+    HSM parent;
+    HSM_TIMER timer;            // Timeout on the wheel
+    uint32_t remaining;         // Timeout of the timer list, 0 if stopped
+    uint32_t period;
+} BENCH_LED;
+
+static HSM_STATE BENCH_StateOn;
+static HSM_STATE BENCH_StateOff;
+static HSM_TIMER_WHEEL stWheel;
+static uint8_t bUseWheel;
+static uint64_t ulTimeouts;
+
+static void BENCH_Arm(HSM *This, HSM_STATE *owner)
+{
+    BENCH_LED *led = (BENCH_LED *)This;
+    if (bUseWheel)
+    {
+        HSM_TIMER_Arm(&led->timer, &stWheel, owner, led->period, 0);
+    }
+    else
+    {
+        led->remaining = led->period;
+    }
+}
+
+static HSM_EVENT BENCH_StateOnHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_ENTRY)
+    {
+        BENCH_Arm(This, &BENCH_StateOn);
+        return 0;
+    }
+    if (event == BENCH_EVT_TIMEOUT)
+    {
+        ulTimeouts++;
+        HSM_Tran(This, &BENCH_StateOff, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static HSM_EVENT BENCH_StateOffHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == HSME_ENTRY)
+    {
+        BENCH_Arm(This, &BENCH_StateOff);
+        return 0;
+    }
+    if (event == BENCH_EVT_TIMEOUT)
+    {
+        ulTimeouts++;
+        HSM_Tran(This, &BENCH_StateOn, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static double BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void BENCH_Create(BENCH_LED *aLed, uint32_t instances)
+{
+    uint32_t idx;
+    HSM_TIMER_WHEEL_Create(&stWheel, HSM_TIMER_VIRTUAL);
+    for (idx = 0; idx < instances; idx++)
+    {
+        aLed[idx].period = 100 + (idx * 7919) % 1000;
+        HSM_TIMER_Create(&aLed[idx].timer, (HSM *)&aLed[idx], BENCH_EVT_TIMEOUT, NULL);
+        HSM_Create((HSM *)&aLed[idx], "LED", &BENCH_StateOff);
+    }
+    ulTimeouts = 0;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t uInstances = (argc > 1) ? atoi(argv[1]) : 10000;
+    uint32_t uTicks = (argc > 2) ? atoi(argv[2]) : 20000;
+    BENCH_LED *aLed = malloc(uInstances * sizeof(BENCH_LED));
+    uint64_t ulListTimeouts;
+    uint32_t tick;
+    uint32_t idx;
+    double start;
+    double list;
+    double wheel;
+
+    HSM_STATE_Create(&BENCH_StateOn, "On", BENCH_StateOnHndlr, NULL);
+    HSM_STATE_Create(&BENCH_StateOff, "Off", BENCH_StateOffHndlr, NULL);
+
+    // 1) Timer list: O(instances) per tick
+    bUseWheel = 0;
+    BENCH_Create(aLed, uInstances);
+    start = BENCH_Now();
+    for (tick = 0; tick < uTicks; tick++)
+    {
+        for (idx = 0; idx < uInstances; idx++)
+        {
+            if (aLed[idx].remaining && 0 == --aLed[idx].remaining)
+            {
+                HSM_Run((HSM *)&aLed[idx], BENCH_EVT_TIMEOUT, NULL);
+            }
+        }
+    }
+    list = BENCH_Now() - start;
+    ulListTimeouts = ulTimeouts;
+
+    // 2) Timing wheel on the virtual clock: O(1) per tick and per timeout
+    bUseWheel = 1;
+    BENCH_Create(aLed, uInstances);
+    start = BENCH_Now();
+    HSM_TIMER_Advance(&stWheel, uTicks);
+    wheel = BENCH_Now() - start;
+
+    printf("instances:%u ticks:%u timeouts:%llu\n", uInstances, uTicks, (unsigned long long)ulTimeouts);
+    printf("list  %9.1f ns/tick\n", list / uTicks);
+    printf("wheel %9.1f ns/tick  speedup %.1fx\n", wheel / uTicks, list / wheel);
+    free(aLed);
+    if (ulTimeouts != ulListTimeouts)
+    {
+        printf("Timeout mismatch: list %llu\n", (unsigned long long)ulListTimeouts);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Cost of tracing HSM_Run() and HSM_Tran() with HSM_SHOW_ALL: each event toggles between the leaves of two
+// branches of 3 states, which writes 9 debug messages.  Build with -DHSM_FEATURE_TRACE=0 to print them with
+// HSM_DEBUGC1/2/3 (to /dev/null), or with -DHSM_FEATURE_TRACE=1 to write binary records.  The records are written
+// in chunks that fit the ring, and each chunk is then formatted with HSM_TRACE_Print() (to /dev/null) as a
+// flusher would, so the cost on the running instance and the deferred cost are timed apart.
+// Usage: trace_printf|trace_ring [events]
+#include "hsm.h"
+#if HSM_FEATURE_TRACE
+#include "hsm_trace.h"
+#endif // HSM_FEATURE_TRACE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_EVT_TOGGLE    (HSME_START)
+#define BENCH_DEPTH         3
+#define BENCH_MESSAGES      9
+#define BENCH_CHUNK         (HSM_TRACE_DEPTH / BENCH_MESSAGES)
+
+static HSM_STATE astBranchA[BENCH_DEPTH];
+static HSM_STATE astBranchB[BENCH_DEPTH];
+#if HSM_FEATURE_TRACE
+static HSM_TRACE_RING stRing;
+#endif // HSM_FEATURE_TRACE
+
+static HSM_EVENT BENCH_StateHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    return event;
+}
+
+static HSM_EVENT BENCH_StateLeafHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_TOGGLE)
+    {
+        HSM_Tran(This, (This->curState == &astBranchA[BENCH_DEPTH - 1]) ? &astBranchB[BENCH_DEPTH - 1] :
+                       &astBranchA[BENCH_DEPTH - 1], 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static double BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double BENCH_Run(HSM *This, uint32_t events)
+{
+    uint32_t iter;
+    double start = BENCH_Now();
+    for (iter = 0; iter < events; iter++)
+    {
+        HSM_Run(This, BENCH_EVT_TOGGLE, 0);
+    }
+    return (BENCH_Now() - start) / events;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t uEvents = (argc > 1) ? atoi(argv[1]) : 1000000;
+    HSM stHsm;
+    uint8_t idx;
+    double off;
+    double all;
+#if HSM_FEATURE_TRACE
+    FILE *null = fopen("/dev/null", "w");
+    double format = 0;
+    double start;
+    uint32_t done;
+    uint32_t chunk;
+#else
+    int out;
+#endif // HSM_FEATURE_TRACE
+
+    for (idx = 0; idx < BENCH_DEPTH; idx++)
+    {
+        HSM_FN handler = (idx == BENCH_DEPTH - 1) ? BENCH_StateLeafHndlr : BENCH_StateHndlr;
+        HSM_STATE_Create(&astBranchA[idx], "A", handler, idx ? &astBranchA[idx - 1] : NULL);
+        HSM_STATE_Create(&astBranchB[idx], "B", handler, idx ? &astBranchB[idx - 1] : NULL);
+    }
+    HSM_Create(&stHsm, "Bench", &astBranchA[BENCH_DEPTH - 1]);
+    off = BENCH_Run(&stHsm, uEvents);
+
+    HSM_SET_DEBUG(&stHsm, HSM_SHOW_ALL);
+#if HSM_FEATURE_TRACE
+    HSM_TRACE_Attach(&stRing, "bench");
+    all = 0;
+    for (done = 0; done < uEvents; done += chunk)
+    {
+        chunk = (uEvents - done < BENCH_CHUNK) ? uEvents - done : BENCH_CHUNK;
+        all += BENCH_Run(&stHsm, chunk) * chunk;
+        start = BENCH_Now();
+        HSM_TRACE_DrainAll(HSM_TRACE_Print, null);
+        format += BENCH_Now() - start;
+    }
+    all /= uEvents;
+    fclose(null);
+#else
+    // The messages go to /dev/null, the results to the original stdout
+    fflush(stdout);
+    out = dup(1);
+    dup2(open("/dev/null", O_WRONLY), 1);
+    all = BENCH_Run(&stHsm, uEvents);
+    fflush(stdout);
+    dup2(out, 1);
+#endif // HSM_FEATURE_TRACE
+    HSM_SET_DEBUG(&stHsm, 0);
+
+    printf("trace:%d  debug off %6.1f ns/event  HSM_SHOW_ALL %7.1f ns/event  %5.1f ns/message", HSM_FEATURE_TRACE,
+           off, all, (all - off) / BENCH_MESSAGES);
+#if HSM_FEATURE_TRACE
+    // Formatting is deferred to the flusher
+    printf("  format %5.1f ns/message  dropped:%llu", format / uEvents / BENCH_MESSAGES,
+           (unsigned long long)HSM_TRACE_Dropped(&stRing));
+#endif // HSM_FEATURE_TRACE
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,93 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Benchmark of HSM_Tran() between two leaf states whose lowest common parent is ROOT.
+// Each transition exits "depth" states and enters "depth" states.  Build with
+// -DHSM_FEATURE_TRAN_CACHE=0 or 1 to compare the uncached and cached transitions.
+#include "hsm.h"
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_EVT_TOGGLE    (HSME_START)
+#define BENCH_ITERATIONS    2000000
+
+static HSM_STATE astBranchA[HSM_MAX_DEPTH];
+static HSM_STATE astBranchB[HSM_MAX_DEPTH];
+static HSM_STATE *pLeafA;
+static HSM_STATE *pLeafB;
+
+static HSM_EVENT BENCH_StateHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    return event;
+}
+
+static HSM_EVENT BENCH_StateLeafHndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    if (event == BENCH_EVT_TOGGLE)
+    {
+        HSM_Tran(This, (This->curState == pLeafA) ? pLeafB : pLeafA, 0, NULL);
+        return 0;
+    }
+    return event;
+}
+
+static void BENCH_Build(uint8_t depth)
+{
+    uint8_t idx;
+    for (idx = 0; idx < depth; idx++)
+    {
+        HSM_FN handler = (idx == depth - 1) ? BENCH_StateLeafHndlr : BENCH_StateHndlr;
+        HSM_STATE_Create(&astBranchA[idx], "A", handler, idx ? &astBranchA[idx - 1] : NULL);
+        HSM_STATE_Create(&astBranchB[idx], "B", handler, idx ? &astBranchB[idx - 1] : NULL);
+    }
+    pLeafA = &astBranchA[depth - 1];
+    pLeafB = &astBranchB[depth - 1];
+}
+
+static double BENCH_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(void)
+{
+    HSM hsm;
+    uint8_t depth;
+    uint32_t idx;
+    double start;
+
+    for (depth = 1; depth < HSM_MAX_DEPTH; depth++)
+    {
+        BENCH_Build(depth);
+        HSM_Create(&hsm, "Bench", pLeafA);
+        start = BENCH_Now();
+        for (idx = 0; idx < BENCH_ITERATIONS; idx++)
+        {
+            HSM_Run(&hsm, BENCH_EVT_TOGGLE, 0);
+        }
+        printf("%-8s depth:%d  %6.1f ns/transition\n", HSM_FEATURE_TRAN_CACHE ? "cached" : "uncached",
+               depth, (BENCH_Now() - start) / BENCH_ITERATIONS);
+    }
+    return 0;
+}
@@ -24,12 +24,46 @@ SOFTWARE.
 */
 
 #include "hsm.h"
+#if HSM_FEATURE_TIMER
+#include "hsm_timer.h"
+#endif // HSM_FEATURE_TIMER
+#if HSM_FEATURE_RECORD
+#include "hsm_record.h"
+#endif // HSM_FEATURE_RECORD
+#if HSM_FEATURE_PUBSUB
+#include "hsm_pubsub.h"
+#endif // HSM_FEATURE_PUBSUB
+#if HSM_FEATURE_ARENA
+#include "hsm_arena.h"
+#endif // HSM_FEATURE_ARENA
+#if HSM_FEATURE_TRACE
+#include "hsm_trace.h"
+// The interactions of hsm.c are recorded by HSM_TRACE() instead of printed.  Handlers keep their own HSM_DEBUGC1/2/3
+#undef HSM_DEBUGC1
+#undef HSM_DEBUGC2
+#undef HSM_DEBUGC3
+#define HSM_DEBUGC1(...)
+#define HSM_DEBUGC2(...)
+#define HSM_DEBUGC3(...)
+#else
+#define HSM_TRACE(show, kind, state, event, aux)
+#endif // HSM_FEATURE_TRACE
+#if HSM_FEATURE_STATS && !defined(HSM_STATS_CLOCK)
+#include <time.h>
+#endif // HSM_FEATURE_STATS && !defined(HSM_STATS_CLOCK)
 
 #if HSM_FEATURE_DEBUG_NESTED_CALL
-uint8_t gucHsmNestLevel;
+HSM_THREAD_LOCAL uint8_t gucHsmNestLevel;
 const char * const apucHsmNestIndent[] = { "", "", "\t", "\t\t", "\t\t\t", "\t\t\t\t"};
 #endif // HSM_FEATURE_DEBUG_NESTED_CALL
 
+#if HSM_FEATURE_HNDLR_STATE
+// Tells the handler which state it is called for
+#define HSM_HNDLR_STATE(state) { This->hndlrState = (state); }
+#else
+#define HSM_HNDLR_STATE(state)
+#endif // HSM_FEATURE_HNDLR_STATE
+
 HSM_EVENT HSM_RootHandler(HSM *This, HSM_EVENT event, void *param)
 {
 #ifdef HSM_DEBUG_EVT2STR
@@ -47,9 +81,170 @@ HSM_STATE const HSM_ROOT =
     .parent = ((void *)0),
     .handler = HSM_RootHandler,
     .name = ":ROOT:",
-    .level = 0
+    .level = 0,
+#if HSM_FEATURE_REGIONS
+    .region = HSM_NO_REGION,
+#endif // HSM_FEATURE_REGIONS
+#if HSM_FEATURE_HISTORY
+    .history = HSM_NO_HISTORY,
+#endif // HSM_FEATURE_HISTORY
+#if HSM_FEATURE_ACTIVE_SET
+    // Always active, tested by walking up the parents
+    .active = HSM_NO_ACTIVE,
+#endif // HSM_FEATURE_ACTIVE_SET
 };
 
+#if HSM_FEATURE_REGIONS
+// Region states indexed by region, their parent is the composite state
+static HSM_STATE *apstHsmRegion[HSM_MAX_REGIONS];
+static uint8_t ucHsmRegions;
+#endif // HSM_FEATURE_REGIONS
+
+#if HSM_FEATURE_STATS
+#ifndef HSM_STATS_CLOCK
+static HSM_TICKS HSM_StatsClockDefault(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (HSM_TICKS)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#define HSM_STATS_CLOCK HSM_StatsClockDefault
+#endif // HSM_STATS_CLOCK
+
+static void HSM_StatsLatency(uint32_t *histogram, HSM_TICKS latency)
+{
+    uint8_t bucket = 0;
+    latency >>= HSM_STATS_BUCKET_SHIFT;
+    while (latency && bucket < HSM_STATS_BUCKETS - 1)
+    {
+        latency >>= 1;
+        bucket++;
+    }
+    HSM_STATS_ADD(histogram[bucket], 1);
+}
+
+static uint32_t HSM_StatsRead(uint32_t *counter, uint8_t reset)
+{
+    return reset ? __atomic_exchange_n(counter, 0, __ATOMIC_RELAXED) : __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+void HSM_STATE_GetStats(HSM_STATE *This, HSM_STATE_STATS *stats, uint8_t reset)
+{
+    uint8_t idx;
+    stats->handled = HSM_StatsRead(&This->stats.handled, reset);
+    stats->passed = HSM_StatsRead(&This->stats.passed, reset);
+    stats->entries = HSM_StatsRead(&This->stats.entries, reset);
+    stats->exits = HSM_StatsRead(&This->stats.exits, reset);
+    stats->dwell = reset ? __atomic_exchange_n(&This->stats.dwell, 0, __ATOMIC_RELAXED)
+                         : __atomic_load_n(&This->stats.dwell, __ATOMIC_RELAXED);
+    for (idx = 0; idx < HSM_STATS_BUCKETS; idx++)
+    {
+        stats->latency[idx] = HSM_StatsRead(&This->stats.latency[idx], reset);
+    }
+}
+
+void HSM_GetStats(HSM *This, HSM_STATS *stats, uint8_t reset)
+{
+    uint8_t idx;
+    stats->events = HSM_StatsRead(&This->stats.events, reset);
+    stats->dropped = HSM_StatsRead(&This->stats.dropped, reset);
+    stats->transitions = HSM_StatsRead(&This->stats.transitions, reset);
+    for (idx = 0; idx < HSM_STATS_BUCKETS; idx++)
+    {
+        stats->latency[idx] = HSM_StatsRead(&This->stats.latency[idx], reset);
+    }
+}
+#endif // HSM_FEATURE_STATS
+
+// Fills list_exit[] (innermost first) and list_entry[] (innermost first) with the states exited and entered when
+// transitioning from src to dst.  Returns the counts through cnt_exit and cnt_entry
+static void HSM_TranPath(HSM_STATE *src, HSM_STATE *dst, HSM_STATE **list_exit, uint8_t *cnt_exit, HSM_STATE **list_entry, uint8_t *cnt_entry)
+{
+    uint8_t nExit = 0;
+    uint8_t nEntry = 0;
+    // 1a) Equalize the levels
+    while (src->level != dst->level)
+    {
+        if (src->level > dst->level)
+        {
+            // source is deeper
+            list_exit[nExit++] = src;
+            src = src->parent;
+        }
+        else
+        {
+            // destination is deeper
+            list_entry[nEntry++] = dst;
+            dst = dst->parent;
+        }
+    }
+    // 1b) find the common parent
+    while (src != dst)
+    {
+        list_exit[nExit++] = src;
+        src = src->parent;
+        list_entry[nEntry++] = dst;
+        dst = dst->parent;
+    }
+    *cnt_exit = nExit;
+    *cnt_entry = nEntry;
+}
+
+#if HSM_FEATURE_TRAN_CACHE
+typedef struct HSM_TRAN_PATH_T
+{
+    HSM_STATE *src;                         // source state, NULL if slot is empty
+    HSM_STATE *dst;                         // target state
+    uint8_t cntExit;                        // number of states exited
+    uint8_t cntEntry;                       // number of states entered
+    HSM_STATE *list[2 * HSM_MAX_DEPTH];     // exit list followed by the entry list, both innermost first
+} HSM_TRAN_PATH;
+
+static HSM_TRAN_PATH astHsmTranCache[HSM_TRAN_CACHE_SIZE];
+
+static HSM_TRAN_PATH *HSM_TranCacheSlot(HSM_STATE *src, HSM_STATE *dst)
+{
+    // Direct mapped: Mix the state addresses, discarding the low bits which are the same due to alignment
+    uintptr_t hash = ((uintptr_t)src >> 3) * 31 + ((uintptr_t)dst >> 3);
+    return &astHsmTranCache[(hash ^ (hash >> 7)) & (HSM_TRAN_CACHE_SIZE - 1)];
+}
+
+uint8_t HSM_TranCacheLoad(HSM_STATE *src, HSM_STATE *dst)
+{
+    HSM_TRAN_PATH *path = HSM_TranCacheSlot(src, dst);
+    uint8_t isFree = (path->src == ((void *)0)) || (path->src == src && path->dst == dst);
+    HSM_STATE *list_exit[HSM_MAX_DEPTH];
+    HSM_STATE *list_entry[HSM_MAX_DEPTH];
+    uint8_t cnt_exit;
+    uint8_t cnt_entry;
+    uint8_t idx;
+
+    HSM_TranPath(src, dst, list_exit, &cnt_exit, list_entry, &cnt_entry);
+    for (idx = 0; idx < cnt_exit; idx++)
+    {
+        path->list[idx] = list_exit[idx];
+    }
+    for (idx = 0; idx < cnt_entry; idx++)
+    {
+        path->list[cnt_exit + idx] = list_entry[idx];
+    }
+    path->cntExit = cnt_exit;
+    path->cntEntry = cnt_entry;
+    path->dst = dst;
+    path->src = src;
+    return isFree;
+}
+
+void HSM_TranCacheFlush(void)
+{
+    uint16_t idx;
+    for (idx = 0; idx < HSM_TRAN_CACHE_SIZE; idx++)
+    {
+        astHsmTranCache[idx].src = ((void *)0);
+    }
+}
+#endif // HSM_FEATURE_TRAN_CACHE
+
 void HSM_STATE_Create(HSM_STATE *This, const char *name, HSM_FN handler, HSM_STATE *parent)
 {
     if (((void *)0) == parent)
@@ -66,10 +261,237 @@ void HSM_STATE_Create(HSM_STATE *This, const char *name, HSM_FN handler, HSM_STA
         // assert(0, "Please increase HSM_MAX_DEPTH");
         while(1);
     }
+#if HSM_FEATURE_RECORD
+    This->recId = HSM_RECORD_StateId(name);
+#endif // HSM_FEATURE_RECORD
+#if HSM_FEATURE_REGIONS
+    // Children of a state in a region are in the same region
+    This->region = parent->region;
+    This->regionFirst = 0;
+    This->regionCount = 0;
+#endif // HSM_FEATURE_REGIONS
+#if HSM_FEATURE_HISTORY
+    This->history = HSM_NO_HISTORY;
+    This->historyDeep = 0;
+#endif // HSM_FEATURE_HISTORY
+#if HSM_FEATURE_PUBSUB
+    This->subscribe = ((void *)0);
+    This->subscribeCount = 0;
+#endif // HSM_FEATURE_PUBSUB
+#if HSM_FEATURE_ACTIVE_SET
+    // Each call takes a new bit, so a state must be created only once
+    static uint16_t uHsmActiveStates;
+    if (uHsmActiveStates >= HSM_MAX_STATES)
+    {
+        HSM_DEBUG("Please increase HSM_MAX_STATES > %d", HSM_MAX_STATES);
+        // assert(0, "Please increase HSM_MAX_STATES");
+        while(1);
+    }
+    This->active = uHsmActiveStates++;
+#endif // HSM_FEATURE_ACTIVE_SET
+#if HSM_FEATURE_EVENT_FILTER
+    // No events declared, so the handler receives all events
+    This->isFiltered = 0;
+#endif // HSM_FEATURE_EVENT_FILTER
+#if HSM_FEATURE_STATS
+    HSM_STATE_STATS discard;
+    HSM_STATE_GetStats(This, &discard, 1);
+#endif // HSM_FEATURE_STATS
+#if HSM_FEATURE_TRAN_CACHE
+    // The hierarchy has changed, so any cached path may be stale
+    HSM_TranCacheFlush();
+#endif // HSM_FEATURE_TRAN_CACHE
 }
 
-void HSM_Create(HSM *This, const char *name, HSM_STATE *initState)
+#if HSM_FEATURE_REGIONS
+void HSM_STATE_CreateRegion(HSM_STATE *This, const char *name, HSM_FN handler, HSM_STATE *parent)
 {
+    if (((void *)0) == parent || HSM_NO_REGION != parent->region)
+    {
+        HSM_DEBUG("Region %s must be created in a state outside any region", name);
+        // assert(0, "Nested regions are not supported");
+        while(1);
+    }
+    if (ucHsmRegions >= HSM_MAX_REGIONS)
+    {
+        HSM_DEBUG("Please increase HSM_MAX_REGIONS > %d", HSM_MAX_REGIONS);
+        // assert(0, "Please increase HSM_MAX_REGIONS");
+        while(1);
+    }
+    if (parent->regionCount && parent->regionFirst + parent->regionCount != ucHsmRegions)
+    {
+        HSM_DEBUG("Region %s must be created right after the other regions of %s", name, parent->name);
+        // assert(0, "Regions of a state must be created one after the other");
+        while(1);
+    }
+    HSM_STATE_Create(This, name, handler, parent);
+    This->region = ucHsmRegions;
+    if (0 == parent->regionCount)
+    {
+        parent->regionFirst = ucHsmRegions;
+    }
+    parent->regionCount++;
+    apstHsmRegion[ucHsmRegions++] = This;
+}
+#endif // HSM_FEATURE_REGIONS
+
+#if HSM_FEATURE_ACTIVE_SET
+// Updates the bit of a state in the active set, states from the static initializer have none
+#define HSM_ACTIVE_SET(hsm, state) \
+    if (HSM_NO_ACTIVE != (state)->active) { (hsm)->active[(state)->active / 32] |= 1UL << ((state)->active % 32); }
+#define HSM_ACTIVE_CLR(hsm, state) \
+    if (HSM_NO_ACTIVE != (state)->active) { (hsm)->active[(state)->active / 32] &= ~(1UL << ((state)->active % 32)); }
+#endif // HSM_FEATURE_ACTIVE_SET
+
+#if HSM_FEATURE_HISTORY
+void HSM_STATE_SetHistory(HSM_STATE *This, uint8_t deep)
+{
+    static uint8_t ucHsmHistories;
+    if (HSM_NO_HISTORY == This->history)
+    {
+        if (ucHsmHistories >= HSM_MAX_HISTORY)
+        {
+            HSM_DEBUG("Please increase HSM_MAX_HISTORY > %d", HSM_MAX_HISTORY);
+            // assert(0, "Please increase HSM_MAX_HISTORY");
+            while(1);
+        }
+        This->history = ucHsmHistories++;
+    }
+    This->historyDeep = deep;
+}
+#endif // HSM_FEATURE_HISTORY
+
+#if HSM_FEATURE_EVENT_FILTER
+void HSM_STATE_SetEvents(HSM_STATE *This, const HSM_EVENT *events, uint8_t count)
+{
+    uint8_t idx;
+    for (idx = 0; idx < HSM_EVENT_FILTER_SIZE / 32; idx++)
+    {
+        This->events[idx] = 0;
+    }
+    for (idx = 0; idx < count; idx++)
+    {
+        if (events[idx] < HSM_EVENT_FILTER_SIZE)
+        {
+            This->events[events[idx] / 32] |= 1UL << (events[idx] % 32);
+        }
+    }
+    This->isFiltered = 1;
+}
+#endif // HSM_FEATURE_EVENT_FILTER
+
+// Exits a state, leaf is the innermost active state being exited
+static void HSM_ExitState(HSM *This, HSM_STATE *state, HSM_STATE *leaf, void *param)
+{
+    HSM_DEBUGC3("  %s[%s](EXIT)", This->name, state->name);
+    HSM_TRACE(HSM_SHOW_INTACT, HSM_TRACE_EXIT, state, HSME_EXIT, 0);
+    HSM_HNDLR_STATE(state);
+    state->handler(This, HSME_EXIT, param);
+#if HSM_FEATURE_ACTIVE_SET
+    HSM_ACTIVE_CLR(This, state);
+#endif // HSM_FEATURE_ACTIVE_SET
+#if HSM_FEATURE_HISTORY
+    // Remember the substate of a parent state with history
+    if (HSM_NO_HISTORY != state->parent->history)
+    {
+        This->history[state->parent->history] = state->parent->historyDeep ? leaf : state;
+    }
+#else
+    (void)leaf;
+#endif // HSM_FEATURE_HISTORY
+#if HSM_FEATURE_TIMER
+    // Cancel the timers armed by the state
+    if (This->timers)
+    {
+        HSM_TIMER_CancelState(This, state);
+    }
+#endif // HSM_FEATURE_TIMER
+#if HSM_FEATURE_PUBSUB
+    // Stop the events the state subscribed to
+    if (This->bus && state->subscribeCount)
+    {
+        HSM_BUS_ExitState(This, state);
+    }
+#endif // HSM_FEATURE_PUBSUB
+#if HSM_FEATURE_STATS
+    HSM_STATS_ADD(state->stats.exits, 1);
+    HSM_STATS_ADD(state->stats.dwell, This->tranTime - This->entered[state->level]);
+#endif // HSM_FEATURE_STATS
+}
+
+static void HSM_EnterState(HSM *This, HSM_STATE *state, void *param)
+{
+    HSM_DEBUGC3("  %s[%s](ENTRY)", This->name, state->name);
+    HSM_TRACE(HSM_SHOW_INTACT, HSM_TRACE_ENTRY, state, HSME_ENTRY, 0);
+#if HSM_FEATURE_STATS
+    HSM_STATS_ADD(state->stats.entries, 1);
+    This->entered[state->level] = This->tranTime;
+#endif // HSM_FEATURE_STATS
+    HSM_HNDLR_STATE(state);
+    state->handler(This, HSME_ENTRY, param);
+#if HSM_FEATURE_ACTIVE_SET
+    HSM_ACTIVE_SET(This, state);
+#endif // HSM_FEATURE_ACTIVE_SET
+#if HSM_FEATURE_PUBSUB
+    // Start the events the state subscribed to
+    if (This->bus && state->subscribeCount)
+    {
+        HSM_BUS_EnterState(This, state);
+    }
+#endif // HSM_FEATURE_PUBSUB
+}
+
+#if HSM_FEATURE_REGIONS
+// Exits the active states of the regions of a composite state, except the region being exited by the transition
+static void HSM_ExitRegions(HSM *This, HSM_STATE *composite, uint8_t skip, void *param)
+{
+    HSM_STATE *state;
+    uint8_t region;
+    for (region = composite->regionFirst + composite->regionCount; region-- > composite->regionFirst; )
+    {
+        if (region != skip)
+        {
+            This->region = region;
+            for (state = This->regions[region]; state != composite; state = state->parent)
+            {
+                HSM_ExitState(This, state, This->regions[region], param);
+            }
+        }
+    }
+}
+
+// Enters a region, which becomes its own active state
+static void HSM_EnterRegion(HSM *This, uint8_t region, void *param)
+{
+    This->region = region;
+    This->regions[region] = apstHsmRegion[region];
+    HSM_EnterState(This, apstHsmRegion[region], param);
+}
+
+// Sends HSME_INIT to the regions in the mask that are still in their region state
+static void HSM_InitRegions(HSM *This, uint32_t mask, void *param)
+{
+    uint8_t region;
+    for (region = 0; mask; region++, mask >>= 1)
+    {
+        if ((mask & 1) && This->regions[region] == apstHsmRegion[region])
+        {
+            This->region = region;
+            HSM_DEBUGC3("  %s[%s](INIT)", This->name, apstHsmRegion[region]->name);
+            HSM_TRACE(HSM_SHOW_INTACT, HSM_TRACE_INIT, apstHsmRegion[region], HSME_INIT, 0);
+            HSM_HNDLR_STATE(apstHsmRegion[region]);
+            apstHsmRegion[region]->handler(This, HSME_INIT, param);
+        }
+    }
+}
+#endif // HSM_FEATURE_REGIONS
+
+// Initializes the instance in a state without sending any event
+static void HSM_Init(HSM *This, const char *name, HSM_STATE *state)
+{
+#if HSM_FEATURE_REGIONS || HSM_FEATURE_HISTORY
+    uint8_t idx;
+#endif // HSM_FEATURE_REGIONS || HSM_FEATURE_HISTORY
     // Setup debug
 #if HSM_FEATURE_DEBUG_ENABLE
     This->name = name;
@@ -80,13 +502,135 @@ void HSM_Create(HSM *This, const char *name, HSM_STATE *initState)
     // Supress warning for unused variable if HSM_FEATURE_DEBUG_ENABLE is not defined
     (void)name;
 
+#if HSM_FEATURE_QUEUE
+    // Empty the event queue
+    This->qHead = 0;
+    This->qCount = 0;
+    This->qBusy = 0;
+#endif // HSM_FEATURE_QUEUE
+#if HSM_FEATURE_DEFER
+    This->deferHead = ((void *)0);
+    This->deferTail = &This->deferHead;
+    This->deferCount = 0;
+    This->deferRecall = 0;
+#endif // HSM_FEATURE_DEFER
+#if HSM_FEATURE_SAFETY_CHECK
+    This->hsmTran = 0;
+#endif // HSM_FEATURE_SAFETY_CHECK
+#if HSM_FEATURE_TIMER
+    This->timers = ((void *)0);
+#endif // HSM_FEATURE_TIMER
+#if HSM_FEATURE_PUBSUB
+    // HSM_BUS_Join() subscribes the active states
+    This->bus = ((void *)0);
+    This->subs = ((void *)0);
+    This->subCount = 0;
+#endif // HSM_FEATURE_PUBSUB
+#if HSM_FEATURE_ARENA
+    // HSM_ARENA_Attach() sets the arena
+    This->arena = ((void *)0);
+#endif // HSM_FEATURE_ARENA
+#if HSM_FEATURE_HISTORY
+    // No state has been exited yet
+    for (idx = 0; idx < HSM_MAX_HISTORY; idx++)
+    {
+        This->history[idx] = ((void *)0);
+    }
+#endif // HSM_FEATURE_HISTORY
+#if HSM_FEATURE_STATS
+    HSM_STATS discard;
+    HSM_STATE *active;
+    HSM_TICKS now = HSM_STATS_CLOCK();
+    HSM_GetStats(This, &discard, 1);
+    This->tranTime = now;
+    // The state and its parents become active now
+    for (active = state; active->level; active = active->parent)
+    {
+        This->entered[active->level] = now;
+    }
+#endif // HSM_FEATURE_STATS
+
     // Initialize state
-    This->curState = initState;
+    This->curState = state;
+#if HSM_FEATURE_REGIONS
+    // The regions of a composite state start in their region state
+    This->region = HSM_NO_REGION;
+    for (idx = state->regionFirst; idx < state->regionFirst + state->regionCount; idx++)
+    {
+        This->regions[idx] = apstHsmRegion[idx];
+    }
+#endif // HSM_FEATURE_REGIONS
+#if HSM_FEATURE_ACTIVE_SET
+    // The state, its parents and the region states of a composite state are active
+    HSM_STATE *member;
+    uint16_t word;
+    for (word = 0; word < HSM_MAX_STATES / 32; word++)
+    {
+        This->active[word] = 0;
+    }
+    for (member = state; member; member = member->parent)
+    {
+        HSM_ACTIVE_SET(This, member);
+    }
+#if HSM_FEATURE_REGIONS
+    for (idx = state->regionFirst; idx < state->regionFirst + state->regionCount; idx++)
+    {
+        HSM_ACTIVE_SET(This, apstHsmRegion[idx]);
+    }
+#endif // HSM_FEATURE_REGIONS
+#endif // HSM_FEATURE_ACTIVE_SET
+}
+
+void HSM_Restore(HSM *This, const char *name, HSM_STATE *state)
+{
+    HSM_Init(This, name, state);
+#if HSM_FEATURE_RECORD
+    This->recId = HSM_RECORD_NewInstance();
+    HSM_RECORD_End(This, HSM_RECORD_Begin(This, HSM_RECORD_RESTORE, HSME_NULL, 0));
+#endif // HSM_FEATURE_RECORD
+}
+
+void HSM_Create(HSM *This, const char *name, HSM_STATE *initState)
+{
+    HSM_Init(This, name, initState);
+#if HSM_FEATURE_TRAN_CACHE
+    // States set up with HSM_STATE_INIT() never call HSM_STATE_Create(), so the cache may hold paths of another chart
+    HSM_TranCacheFlush();
+#endif // HSM_FEATURE_TRAN_CACHE
+#if HSM_FEATURE_RECORD
+    This->recId = HSM_RECORD_NewInstance();
+    uint64_t record = HSM_RECORD_Begin(This, HSM_RECORD_CREATE, HSME_NULL, (void *)(uintptr_t)initState->recId);
+#endif // HSM_FEATURE_RECORD
+#if HSM_FEATURE_STATS
+    HSM_STATS_ADD(initState->stats.entries, 1);
+#endif // HSM_FEATURE_STATS
     // Invoke ENTRY and INIT event
     HSM_DEBUGC1("  %s[%s](ENTRY)", This->name, initState->name);
+    HSM_TRACE(HSM_SHOW_RUN, HSM_TRACE_ENTRY, initState, HSME_ENTRY, 0);
+    HSM_HNDLR_STATE(initState);
     This->curState->handler(This, HSME_ENTRY, 0);
     HSM_DEBUGC1("  %s[%s](INIT)", This->name, initState->name);
+    HSM_TRACE(HSM_SHOW_RUN, HSM_TRACE_INIT, initState, HSME_INIT, 0);
+    HSM_HNDLR_STATE(initState);
     This->curState->handler(This, HSME_INIT, 0);
+#if HSM_FEATURE_REGIONS
+    // Enter and initialize the regions of a composite initial state
+    if (This->curState == initState && initState->regionCount)
+    {
+        uint8_t idx;
+        uint32_t init = 0;
+        for (idx = initState->regionFirst; idx < initState->regionFirst + initState->regionCount; idx++)
+        {
+            HSM_EnterRegion(This, idx, 0);
+            init |= 1UL << idx;
+        }
+        HSM_InitRegions(This, init, 0);
+        This->region = HSM_NO_REGION;
+    }
+#endif // HSM_FEATURE_REGIONS
+#if HSM_FEATURE_RECORD
+    HSM_RECORD_End(This, record);
+#endif // HSM_FEATURE_RECORD
 }
 
 HSM_STATE *HSM_GetState(HSM *This)
@@ -98,6 +642,13 @@ HSM_STATE *HSM_GetState(HSM *This)
 uint8_t HSM_IsInState(HSM *This, HSM_STATE *state)
 {
     HSM_STATE *curState;
+#if HSM_FEATURE_ACTIVE_SET
+    // Test the bit of the state, only states without a bit are searched
+    if (HSM_NO_ACTIVE != state->active)
+    {
+        return (This->active[state->active / 32] >> (state->active % 32)) & 1;
+    }
+#endif // HSM_FEATURE_ACTIVE_SET
     // Traverse the parents to find the matching state.
     for (curState = This->curState; curState; curState = curState->parent)
     {
@@ -107,10 +658,118 @@ uint8_t HSM_IsInState(HSM *This, HSM_STATE *state)
             return 1;
         }
     }
+#if HSM_FEATURE_REGIONS
+    // Traverse the active states of the regions of the current state
+    if (HSM_NO_REGION != state->region && apstHsmRegion[state->region]->parent == This->curState)
+    {
+        for (curState = This->regions[state->region]; curState != This->curState; curState = curState->parent)
+        {
+            if (state == curState)
+            {
+                return 1;
+            }
+        }
+    }
+#endif // HSM_FEATURE_REGIONS
     // This HSM is not in state or parent state
     return 0;
 }
 
+#if HSM_FEATURE_ACTIVE_SET
+void HSM_STATE_SET_Create(HSM_STATE_SET *This, HSM_STATE * const *states, uint8_t count)
+{
+    uint16_t word;
+    uint8_t idx;
+    for (word = 0; word < HSM_MAX_STATES / 32; word++)
+    {
+        This->bits[word] = 0;
+    }
+    for (idx = 0; idx < count; idx++)
+    {
+        if (HSM_NO_ACTIVE == states[idx]->active)
+        {
+            HSM_DEBUG("State %s of HSM_STATE_SET must be created with HSM_STATE_Create()", states[idx]->name);
+            // assert(0, "State of HSM_STATE_SET has no bit");
+            while(1);
+        }
+        This->bits[states[idx]->active / 32] |= 1UL << (states[idx]->active % 32);
+    }
+}
+
+uint8_t HSM_IsInAnyState(HSM *This, const HSM_STATE_SET *set)
+{
+    uint16_t word;
+    for (word = 0; word < HSM_MAX_STATES / 32; word++)
+    {
+        if (This->active[word] & set->bits[word])
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif // HSM_FEATURE_ACTIVE_SET
+
+// Runs the state handler unless the state filters out the event, returns the event passed to the parent state
+static HSM_EVENT HSM_RunState(HSM *This, HSM_STATE *state, HSM_EVENT event, void *param)
+{
+#if HSM_FEATURE_EVENT_FILTER
+    // Skip the handler if the state declared that it does not handle the event
+    if (state->isFiltered && event < HSM_EVENT_FILTER_SIZE &&
+        !(state->events[event / 32] & (1UL << (event % 32))))
+    {
+        return event;
+    }
+#endif // HSM_FEATURE_EVENT_FILTER
+#if HSM_FEATURE_STATS
+    HSM_TICKS hndlrStart = HSM_STATS_CLOCK();
+#endif // HSM_FEATURE_STATS
+    HSM_HNDLR_STATE(state);
+    event = state->handler(This, event, param);
+#if HSM_FEATURE_STATS
+    if (0 == state->level)
+    {
+        // HSM_ROOT is const and only counts towards the instance
+        HSM_STATS_ADD(This->stats.dropped, 1);
+    }
+    else
+    {
+        HSM_STATS_ADD(*(event ? &state->stats.passed : &state->stats.handled), 1);
+        HSM_StatsLatency(state->stats.latency, HSM_STATS_CLOCK() - hndlrStart);
+    }
+#endif // HSM_FEATURE_STATS
+    return event;
+}
+
+#if HSM_FEATURE_REGIONS
+// Runs the event in each region of the composite state, returns HSME_NULL if any region consumed the event
+static HSM_EVENT HSM_RunRegions(HSM *This, HSM_STATE *composite, HSM_EVENT event, void *param)
+{
+    HSM_STATE *state;
+    HSM_EVENT unhandled = event;
+    HSM_EVENT passed;
+    uint8_t outer = This->region;
+    uint8_t region;
+    // Stop once a region transitions out of the composite state
+    for (region = composite->regionFirst;
+         region < composite->regionFirst + composite->regionCount && This->curState == composite; region++)
+    {
+        This->region = region;
+        passed = event;
+        for (state = This->regions[region]; passed && state != composite; state = state->parent)
+        {
+            passed = HSM_RunState(This, state, passed, param);
+        }
+        if (!passed)
+        {
+            unhandled = HSME_NULL;
+        }
+    }
+    This->region = outer;
+    return (This->curState == composite) ? unhandled : HSME_NULL;
+}
+#endif // HSM_FEATURE_REGIONS
+
 void HSM_Run(HSM *This, HSM_EVENT event, void *param)
 {
 #if HSM_FEATURE_DEBUG_ENABLE && HSM_FEATURE_DEBUG_NESTED_CALL
@@ -126,9 +785,35 @@ void HSM_Run(HSM *This, HSM_EVENT event, void *param)
 #else
     HSM_DEBUGC1("Run %s[%s](evt:%lx, param:%08lx)", This->name, state->name, (unsigned long)event, (unsigned long)param);
 #endif // HSM_DEBUG_EVT2STR
+    HSM_TRACE(HSM_SHOW_RUN, HSM_TRACE_RUN, state, event, param);
+#if HSM_FEATURE_ARENA
+    // The cycle ends when the outermost run returns
+    if (This->arena)
+    {
+        This->arena->depth++;
+    }
+#endif // HSM_FEATURE_ARENA
+#if HSM_FEATURE_RECORD
+    uint64_t record = HSM_RECORD_Begin(This, HSM_RECORD_RUN, event, param);
+#endif // HSM_FEATURE_RECORD
+#if HSM_FEATURE_STATS
+    HSM_TICKS runStart = HSM_STATS_CLOCK();
+    HSM_STATS_ADD(This->stats.events, 1);
+#endif // HSM_FEATURE_STATS
     while (event)
     {
-        event = state->handler(This, event, param);
+#if HSM_FEATURE_REGIONS
+        // The regions of a composite state see the event before the composite state
+        if (state->regionCount)
+        {
+            event = HSM_RunRegions(This, state, event, param);
+            if (HSME_NULL == event)
+            {
+                break;
+            }
+        }
+#endif // HSM_FEATURE_REGIONS
+        event = HSM_RunState(This, state, event, param);
         state = state->parent;
         if (event)
         {
@@ -137,8 +822,21 @@ void HSM_Run(HSM *This, HSM_EVENT event, void *param)
 #else
             HSM_DEBUGC1("  evt:%lx unhandled, passing to %s[%s]", (unsigned long)event, This->name, state->name);
 #endif // HSM_DEBUG_EVT2STR
+            HSM_TRACE(HSM_SHOW_RUN, HSM_TRACE_PASS, state, event, 0);
         }
     }
+#if HSM_FEATURE_STATS
+    HSM_StatsLatency(This->stats.latency, HSM_STATS_CLOCK() - runStart);
+#endif // HSM_FEATURE_STATS
+#if HSM_FEATURE_RECORD
+    HSM_RECORD_End(This, record);
+#endif // HSM_FEATURE_RECORD
+#if HSM_FEATURE_ARENA
+    if (This->arena)
+    {
+        HSM_ARENA_End(This);
+    }
+#endif // HSM_FEATURE_ARENA
 #if HSM_FEATURE_DEBUG_ENABLE
     // Restore debug back to the configured debug
     This->hsmDebug = This->hsmDebugCfg;
@@ -152,61 +850,382 @@ void HSM_Run(HSM *This, HSM_EVENT event, void *param)
 #endif // HSM_FEATURE_DEBUG_ENABLE
 }
 
-void HSM_Tran(HSM *This, HSM_STATE *nextState, void *param, void (*method)(HSM *This, void *param))
+#if HSM_FEATURE_QUEUE
+uint8_t HSM_Post(HSM *This, HSM_EVENT event, void *param)
+{
+    uint8_t idx;
+    if (This->qCount >= HSM_QUEUE_DEPTH)
+    {
+#if HSM_QUEUE_OVERFLOW == HSM_QUEUE_DROP_OLDEST
+        HSM_DEBUG("\tEvent:%lx dropped, %s queue is full", (unsigned long)This->queue[This->qHead].event, This->name);
+        This->qHead = (This->qHead + 1) % HSM_QUEUE_DEPTH;
+        This->qCount--;
+#if HSM_FEATURE_ARENA
+        if (This->arena)
+        {
+            This->arena->queued--;
+        }
+#endif // HSM_FEATURE_ARENA
+#elif HSM_QUEUE_OVERFLOW == HSM_QUEUE_HALT
+        HSM_DEBUG("Please increase HSM_QUEUE_DEPTH > %d", HSM_QUEUE_DEPTH);
+        // assert(0, "Please increase HSM_QUEUE_DEPTH");
+        while(1);
+#else
+        HSM_DEBUG("\tEvent:%lx dropped, %s queue is full", (unsigned long)event, This->name);
+        return 0;
+#endif // HSM_QUEUE_OVERFLOW
+    }
+    idx = (This->qHead + This->qCount) % HSM_QUEUE_DEPTH;
+    This->queue[idx].event = event;
+    This->queue[idx].param = param;
+    This->qCount++;
+#if HSM_FEATURE_ARENA
+    // The arena keeps the params until the event is dispatched
+    if (This->arena)
+    {
+        This->arena->queued++;
+    }
+#endif // HSM_FEATURE_ARENA
+    return 1;
+}
+
+#if HSM_FEATURE_DEFER
+static HSM_DEFER_EVT astHsmDeferPool[HSM_DEFER_POOL_SIZE];
+static HSM_DEFER_EVT *pstHsmDeferFree;
+static uint16_t uHsmDeferNext;      // Pool events never used yet, so the pool needs no initialization
+static uint16_t uHsmDeferUsed;
+static uint16_t uHsmDeferHighWater;
+static uint32_t uHsmDeferDropped;
+
+uint8_t HSM_Defer(HSM *This, HSM_EVENT event, void *param)
+{
+    HSM_DEFER_EVT *evt;
+#if HSM_FEATURE_SAFETY_CHECK && HSM_FEATURE_ARENA
+    // [optional] Check for a param of the arena, which is released at the end of the cycle
+    if (This->arena && (uint8_t *)param >= This->arena->base &&
+        (uint8_t *)param < This->arena->base + This->arena->stats.size)
+    {
+        HSM_DEBUG("!!!!Illegal param %p of HSM_Defer for %s, promote it with HSM_ParamPromote()!!!!", param, This->name);
+        return 0;
+    }
+#endif // HSM_FEATURE_SAFETY_CHECK && HSM_FEATURE_ARENA
+    HSM_DEFER_LOCK();
+    if (pstHsmDeferFree)
+    {
+        evt = pstHsmDeferFree;
+        pstHsmDeferFree = evt->next;
+    }
+    else if (uHsmDeferNext < HSM_DEFER_POOL_SIZE)
+    {
+        evt = &astHsmDeferPool[uHsmDeferNext++];
+    }
+    else
+    {
+        uHsmDeferDropped++;
+        HSM_DEFER_UNLOCK();
+        HSM_DEBUG("\tEvent:%lx dropped, Please increase HSM_DEFER_POOL_SIZE > %d", (unsigned long)event, HSM_DEFER_POOL_SIZE);
+        return 0;
+    }
+    if (++uHsmDeferUsed > uHsmDeferHighWater)
+    {
+        uHsmDeferHighWater = uHsmDeferUsed;
+    }
+    HSM_DEFER_UNLOCK();
+    evt->event = event;
+    evt->param = param;
+    evt->next = ((void *)0);
+    *This->deferTail = evt;
+    This->deferTail = &evt->next;
+    This->deferCount++;
+    return 1;
+}
+
+// Posts the deferred events being recalled while there is room in the event queue
+static void HSM_DeferPost(HSM *This)
+{
+    HSM_DEFER_EVT *evt;
+    while (This->deferRecall && This->qCount < HSM_QUEUE_DEPTH)
+    {
+        evt = This->deferHead;
+        This->deferHead = evt->next;
+        This->deferCount--;
+        This->deferRecall--;
+        HSM_Post(This, evt->event, evt->param);
+        HSM_DEFER_LOCK();
+        evt->next = pstHsmDeferFree;
+        pstHsmDeferFree = evt;
+        uHsmDeferUsed--;
+        HSM_DEFER_UNLOCK();
+    }
+    if (((void *)0) == This->deferHead)
+    {
+        This->deferTail = &This->deferHead;
+    }
+}
+
+uint16_t HSM_Recall(HSM *This)
+{
+    uint16_t cnt = This->deferCount;
+    This->deferRecall = cnt;
+    HSM_DeferPost(This);
+    return cnt;
+}
+
+// Returns the deferred events of the instance to the pool
+static void HSM_DeferDrop(HSM *This)
+{
+    HSM_DEFER_EVT *evt;
+    HSM_DEFER_LOCK();
+    while (This->deferHead)
+    {
+        evt = This->deferHead;
+        This->deferHead = evt->next;
+        evt->next = pstHsmDeferFree;
+        pstHsmDeferFree = evt;
+        uHsmDeferUsed--;
+    }
+    HSM_DEFER_UNLOCK();
+    This->deferTail = &This->deferHead;
+    This->deferCount = 0;
+    This->deferRecall = 0;
+}
+
+void HSM_GetDeferStats(HSM_DEFER_STATS *stats, uint8_t reset)
+{
+    HSM_DEFER_LOCK();
+    stats->size = HSM_DEFER_POOL_SIZE;
+    stats->used = uHsmDeferUsed;
+    stats->highWater = uHsmDeferHighWater;
+    stats->dropped = uHsmDeferDropped;
+    if (reset)
+    {
+        uHsmDeferHighWater = uHsmDeferUsed;
+        uHsmDeferDropped = 0;
+    }
+    HSM_DEFER_UNLOCK();
+}
+#endif // HSM_FEATURE_DEFER
+
+uint32_t HSM_Dispatch(HSM *This)
+{
+    uint32_t cnt = 0;
+    HSM_QEVT qevt;
+    // Run-to-completion: Events posted from a handler are drained by the outermost call
+    if (This->qBusy)
+    {
+        return 0;
+    }
+    This->qBusy = 1;
+#if HSM_FEATURE_ARENA
+    // The params of the queued events are kept until the queue is drained
+    if (This->arena)
+    {
+        This->arena->depth++;
+    }
+#endif // HSM_FEATURE_ARENA
+    while (This->qCount)
+    {
+        qevt = This->queue[This->qHead];
+        This->qHead = (This->qHead + 1) % HSM_QUEUE_DEPTH;
+        This->qCount--;
+#if HSM_FEATURE_ARENA
+        if (This->arena)
+        {
+            This->arena->queued--;
+        }
+#endif // HSM_FEATURE_ARENA
+#if HSM_FEATURE_DEFER
+        // Refill the queue with the deferred events still being recalled
+        if (This->deferRecall)
+        {
+            HSM_DeferPost(This);
+        }
+#endif // HSM_FEATURE_DEFER
+        HSM_Run(This, qevt.event, qevt.param);
+        cnt++;
+    }
+    This->qBusy = 0;
+#if HSM_FEATURE_ARENA
+    if (This->arena)
+    {
+        HSM_ARENA_End(This);
+    }
+#endif // HSM_FEATURE_ARENA
+    return cnt;
+}
+#endif // HSM_FEATURE_QUEUE
+
+void HSM_Destroy(HSM *This, void *param)
 {
+    HSM_STATE *state;
+    HSM_DEBUGC2("Destroy %s[%s]", This->name, This->curState->name);
+    HSM_TRACE(HSM_SHOW_TRAN, HSM_TRACE_TRAN, This->curState, HSME_NULL, &HSM_ROOT);
+#if HSM_FEATURE_STATS
+    // Time the dwell of the states exited
+    This->tranTime = HSM_STATS_CLOCK();
+#endif // HSM_FEATURE_STATS
+#if HSM_FEATURE_SAFETY_CHECK
+    // HSM_Tran() is illegal in the HSME_EXIT handlers
+    This->hsmTran = 1;
+#endif // HSM_FEATURE_SAFETY_CHECK
+    // Exit the current state and its parents, innermost first
+    for (state = This->curState; state->parent; state = state->parent)
+    {
+#if HSM_FEATURE_REGIONS
+        if (state->regionCount)
+        {
+            HSM_ExitRegions(This, state, HSM_NO_REGION, param);
+            This->region = HSM_NO_REGION;
+        }
+#endif // HSM_FEATURE_REGIONS
+        HSM_ExitState(This, state, This->curState, param);
+    }
+    This->curState = state;
+#if HSM_FEATURE_SAFETY_CHECK
+    This->hsmTran = 0;
+#endif // HSM_FEATURE_SAFETY_CHECK
+#if HSM_FEATURE_TIMER
+    // Disarm the timers armed without owner state
+    if (This->timers)
+    {
+        HSM_TIMER_CancelAll(This);
+    }
+#endif // HSM_FEATURE_TIMER
+#if HSM_FEATURE_PUBSUB
+    if (This->bus)
+    {
+        HSM_BUS_Leave(This);
+    }
+#endif // HSM_FEATURE_PUBSUB
+#if HSM_FEATURE_DEFER
+    HSM_DeferDrop(This);
+#endif // HSM_FEATURE_DEFER
+#if HSM_FEATURE_QUEUE
+    // Discard the events not dispatched
+#if HSM_FEATURE_ARENA
+    if (This->arena)
+    {
+        This->arena->queued -= This->qCount;
+    }
+#endif // HSM_FEATURE_ARENA
+    This->qHead = 0;
+    This->qCount = 0;
+#endif // HSM_FEATURE_QUEUE
+}
+
+// Transitions along the precomputed list of states to exit and enter, or along the path found from the current state
+static void HSM_TranRun(HSM *This, HSM_STATE *nextState, HSM_STATE * const *list, uint8_t listExit, uint8_t listEntry,
+                        void *param, void (*method)(HSM *This, void *param))
+{
+    // Transition from the current state, or from the active state of the region being run
+    HSM_STATE *from = This->curState;
+#if HSM_FEATURE_REGIONS
+    uint8_t outer = This->region;
+    uint32_t init = 0;
+    HSM_STATE *composite = ((void *)0);
+    if (HSM_NO_REGION != outer)
+    {
+        from = This->regions[outer];
+    }
+#endif // HSM_FEATURE_REGIONS
 #if HSM_FEATURE_SAFETY_CHECK
     // [optional] Check for illegal call to HSM_Tran in HSME_ENTRY or HSME_EXIT
     if (This->hsmTran)
     {
         HSM_DEBUG("!!!!Illegal call of HSM_Tran[%s -> %s] in HSME_ENTRY or HSME_EXIT Handler!!!!",
-            This->curState->name, nextState->name);
+            from->name, nextState->name);
+        return;
+    }
+#if HSM_FEATURE_REGIONS
+    // [optional] Check for illegal transition between the regions of a composite state
+    if (HSM_NO_REGION != outer && HSM_NO_REGION != nextState->region && outer != nextState->region &&
+        apstHsmRegion[outer]->parent == apstHsmRegion[nextState->region]->parent)
+    {
+        HSM_DEBUG("!!!!Illegal call of HSM_Tran[%s -> %s] between regions of %s!!!!",
+            from->name, nextState->name, This->curState->name);
         return;
     }
+#endif // HSM_FEATURE_REGIONS
     // Guard HSM_Tran() from certain recursive calls
     This->hsmTran = 1;
 #endif // HSM_FEATURE_SAFETY_CHECK
 
-    HSM_STATE *list_exit[HSM_MAX_DEPTH];
-    HSM_STATE *list_entry[HSM_MAX_DEPTH];
-    uint8_t cnt_exit = 0;
-    uint8_t cnt_entry = 0;
+    HSM_STATE *path_exit[HSM_MAX_DEPTH];
+    HSM_STATE *path_entry[HSM_MAX_DEPTH];
+    HSM_STATE * const *list_exit = path_exit;
+    HSM_STATE * const *list_entry = path_entry;
+    uint8_t cnt_exit;
+    uint8_t cnt_entry;
     uint8_t idx;
+    HSM_STATE *src;
+    HSM_STATE *dst;
     // This performs the state transition with calls of exit, entry and init
     // Bulk of the work handles the exit and entry event during transitions
-    HSM_DEBUGC2("Tran %s[%s -> %s]", This->name, This->curState->name, nextState->name);
+    HSM_DEBUGC2("Tran %s[%s -> %s]", This->name, from->name, nextState->name);
+    HSM_TRACE(HSM_SHOW_TRAN, HSM_TRACE_TRAN, from, HSME_NULL, nextState);
     // 1) Find the lowest common parent state
-    HSM_STATE *src = This->curState;
-    HSM_STATE *dst = nextState;
-    // 1a) Equalize the levels
-    while (src->level != dst->level)
+    if (list)
     {
-        if (src->level > dst->level)
+        // 1**) The path was precomputed, with the initial substates of the next state
+        cnt_exit = listExit;
+        cnt_entry = listEntry;
+        list_exit = list;
+        list_entry = &list[listExit];
+    }
+    else
+    {
+#if HSM_FEATURE_TRAN_CACHE
+        // 1*) Replay the cached path if available
+        HSM_TRAN_PATH *path = HSM_TranCacheSlot(from, nextState);
+#if HSM_TRAN_CACHE_LAZY
+        // Only fill empty slots, so a path is never evicted while a nested HSM_Tran() is replaying it
+        if (path->src == ((void *)0))
         {
-            // source is deeper
-            list_exit[cnt_exit++] = src;
-            src = src->parent;
+            HSM_TranCacheLoad(from, nextState);
+        }
+#endif // HSM_TRAN_CACHE_LAZY
+        if (path->src == from && path->dst == nextState)
+        {
+            cnt_exit = path->cntExit;
+            cnt_entry = path->cntEntry;
+            list_exit = path->list;
+            list_entry = &path->list[cnt_exit];
         }
         else
+#endif // HSM_FEATURE_TRAN_CACHE
         {
-            // destination is deeper
-            list_entry[cnt_entry++] = dst;
-            dst = dst->parent;
+            HSM_TranPath(from, nextState, path_exit, &cnt_exit, path_entry, &cnt_entry);
         }
     }
-    // 1b) find the common parent
-    while (src != dst)
+#if HSM_FEATURE_STATS
+    This->tranTime = HSM_STATS_CLOCK();
+    HSM_STATS_ADD(This->stats.transitions, 1);
+#endif // HSM_FEATURE_STATS
+#if HSM_FEATURE_REGIONS
+    // 2a) A transition from a composite state into one of its regions first exits the active states of that region
+    if (from->regionCount && HSM_NO_REGION != nextState->region && apstHsmRegion[nextState->region]->parent == from)
     {
-        list_exit[cnt_exit++] = src;
-        src = src->parent;
-        list_entry[cnt_entry++] = dst;
-        dst = dst->parent;
+        This->region = nextState->region;
+        for (src = This->regions[nextState->region]; src != from; src = src->parent)
+        {
+            HSM_ExitState(This, src, This->regions[nextState->region], param);
+        }
+        This->region = outer;
     }
+#endif // HSM_FEATURE_REGIONS
     // 2) Process all the exit events
     for (idx = 0; idx < cnt_exit; idx++)
     {
         src = list_exit[idx];
-        HSM_DEBUGC3("  %s[%s](EXIT)", This->name, src->name);
-        src->handler(This, HSME_EXIT, param);
+#if HSM_FEATURE_REGIONS
+        // The other regions are exited before their composite state
+        if (src->regionCount)
+        {
+            HSM_ExitRegions(This, src, from->region, param);
+            This->region = outer;
+        }
+#endif // HSM_FEATURE_REGIONS
+        HSM_ExitState(This, src, from, param);
     }
     // 3) Call the transitional method hook
     if (method)
@@ -217,17 +1236,106 @@ void HSM_Tran(HSM *This, HSM_STATE *nextState, void *param, void (*method)(HSM *
     for (idx = 0; idx < cnt_entry; idx++)
     {
         dst = list_entry[cnt_entry - idx - 1];
-        HSM_DEBUGC3("  %s[%s](ENTRY)", This->name, dst->name);
-        dst->handler(This, HSME_ENTRY, param);
+        HSM_EnterState(This, dst, param);
+#if HSM_FEATURE_REGIONS
+        if (dst->regionCount)
+        {
+            composite = dst;
+        }
+#endif // HSM_FEATURE_REGIONS
+    }
+#if HSM_FEATURE_REGIONS
+    // 4a) Enter the regions of an entered composite state, besides the region of the target state
+    if (composite)
+    {
+        for (idx = composite->regionFirst; idx < composite->regionFirst + composite->regionCount; idx++)
+        {
+            if (idx != nextState->region)
+            {
+                HSM_EnterRegion(This, idx, param);
+                init |= 1UL << idx;
+            }
+        }
+    }
+    // 4b) Enter again the region left by a transition to its own composite state
+    else if (nextState->regionCount && from->region != HSM_NO_REGION && apstHsmRegion[from->region]->parent == nextState)
+    {
+        HSM_EnterRegion(This, from->region, param);
+        init |= 1UL << from->region;
+    }
+    This->region = nextState->region;
+    // 5) Now we can set the destination state.  The composite state is the current state while its regions are active
+    if (HSM_NO_REGION != nextState->region)
+    {
+        This->regions[nextState->region] = nextState;
+        This->curState = apstHsmRegion[nextState->region]->parent;
+    }
+    else
+#endif // HSM_FEATURE_REGIONS
+    {
+        // 5) Now we can set the destination state
+        This->curState = nextState;
     }
-    // 5) Now we can set the destination state
-    This->curState = nextState;
 #if HSM_FEATURE_SAFETY_CHECK
     This->hsmTran = 0;
 #endif // HSM_FEATURE_SAFETY_CHECK
 #if HSM_FEATURE_INIT
     // 6) Invoke INIT signal, NOTE: Only HSME_INIT can recursively call HSM_Tran()
-    HSM_DEBUGC3("  %s[%s](INIT)", This->name, nextState->name);
-    This->curState->handler(This, HSME_INIT, param);
+    if (((void *)0) == list)
+    {
+        HSM_DEBUGC3("  %s[%s](INIT)", This->name, nextState->name);
+        HSM_TRACE(HSM_SHOW_INTACT, HSM_TRACE_INIT, nextState, HSME_INIT, 0);
+        HSM_HNDLR_STATE(nextState);
+        nextState->handler(This, HSME_INIT, param);
+    }
+#if HSM_FEATURE_REGIONS
+    HSM_InitRegions(This, init, param);
+#endif // HSM_FEATURE_REGIONS
 #endif // HSM_FEATURE_INIT
+#if HSM_FEATURE_REGIONS
+    This->region = outer;
+#endif // HSM_FEATURE_REGIONS
+#if HSM_FEATURE_DEFER
+    // 7) Give the deferred events another chance in the new state
+    if (This->deferHead)
+    {
+        HSM_Recall(This);
+    }
+#endif // HSM_FEATURE_DEFER
+}
+
+void HSM_Tran(HSM *This, HSM_STATE *nextState, void *param, void (*method)(HSM *This, void *param))
+{
+    HSM_TranRun(This, nextState, ((void *)0), 0, 0, param, method);
+}
+
+void HSM_TranDirect(HSM *This, HSM_STATE *nextState, HSM_STATE * const *list, uint8_t cntExit, uint8_t cntEntry,
+                    void *param, void (*method)(HSM *This, void *param))
+{
+    HSM_TranRun(This, nextState, list, cntExit, cntEntry, param, method);
+}
+
+#if HSM_FEATURE_HISTORY
+void HSM_TranHistory(HSM *This, HSM_STATE *state, void *param, void (*method)(HSM *This, void *param))
+{
+    HSM_STATE *nextState = ((void *)0);
+    if (HSM_NO_HISTORY != state->history)
+    {
+        nextState = This->history[state->history];
+    }
+    else
+    {
+        HSM_DEBUG("!!!!%s[%s] has no history!!!!", This->name, state->name);
+    }
+    // Default to the state itself, so its HSME_INIT picks the substate
+    HSM_Tran(This, nextState ? nextState : state, param, method);
+}
+
+void HSM_ClearHistory(HSM *This, HSM_STATE *state)
+{
+    if (HSM_NO_HISTORY != state->history)
+    {
+        This->history[state->history] = ((void *)0);
+    }
 }
+#endif // HSM_FEATURE_HISTORY
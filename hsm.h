@@ -33,8 +33,10 @@ extern "C" {
 #include <stdint.h>
 
 //----HSM OPTIONAL FEATURES SECTION[BEGIN]----
-// Enable for HSM debugging
+// Enable for HSM debugging.  Can be set from the makefile
+#ifndef HSM_FEATURE_DEBUG_ENABLE
 #define HSM_FEATURE_DEBUG_ENABLE            1
+#endif
     // If HSM_FEATURE_DEBUG_ENABLE is defined, then select DEBUG OUT type
     //#define HSM_FEATURE_DEBUG_EMBEDDED
     // If HSM_FEATURE_DEBUG_ENABLE is defined, you can define HSM_DEBUG_EVT2STR for custom "event to string" function
@@ -46,18 +48,289 @@ extern "C" {
     extern const char *HSM_Evt2Str(uint32_t event);
     // If HSM_FEATURE_DEBUG_ENABLE is defined, you can define HSM_FEATURE_DEBUG_COLOR to enable color print for color-aware terminals
     #define HSM_FEATURE_DEBUG_COLOR         1
-    // If HSM_FEATURE_DEBUG_ENABLE is defined, debug messages are indented for each nested HSM_Run() call in a single threaded system
+    // If HSM_FEATURE_DEBUG_ENABLE is defined, debug messages are indented for each nested HSM_Run() call.  The nesting
+    // level is kept per thread with HSM_FEATURE_SCHED
     #define HSM_FEATURE_DEBUG_NESTED_CALL   1
     // Sets the newline for host (i.e. linux - "\n", windows - "\r\n")
     #define HSM_NEWLINE                     "\n"
-// Enable safety checks.  Can be disabled after validating all states
+// Enable safety checks.  Can be disabled after validating all states.  Can be set from the makefile
+#ifndef HSM_FEATURE_SAFETY_CHECK
 #define HSM_FEATURE_SAFETY_CHECK            1
-// Enable HSME_INIT Handling.  Can be disabled if no states handles HSME_INIT
+#endif
+// Enable HSME_INIT Handling.  Can be disabled if no states handles HSME_INIT.  Can be set from the makefile
+#ifndef HSM_FEATURE_INIT
 #define HSM_FEATURE_INIT                    1
+#endif
+// Enable caching of the HSM_Tran() exit/entry path for each (source, target) pair.  Can be set from the makefile
+#ifndef HSM_FEATURE_TRAN_CACHE
+#define HSM_FEATURE_TRAN_CACHE              0
+#endif
+    // If HSM_FEATURE_TRAN_CACHE is enabled, set the number of cached paths (must be a power of 2)
+    #ifndef HSM_TRAN_CACHE_SIZE
+    #define HSM_TRAN_CACHE_SIZE             64
+    #endif
+    // If HSM_FEATURE_TRAN_CACHE is enabled, fill the cache on first use of a transition.  Disable for multi-threaded
+    // systems and preload the paths with HSM_TranCacheLoad() once the instances are created
+    #ifndef HSM_TRAN_CACHE_LAZY
+    #define HSM_TRAN_CACHE_LAZY             1
+    #endif
+// Enable the per-instance event queue for HSM_Post() and HSM_Dispatch().  Can be set from the makefile
+#ifndef HSM_FEATURE_QUEUE
+#define HSM_FEATURE_QUEUE                   0
+#endif
+    // If HSM_FEATURE_QUEUE is enabled, set the number of events that can be queued per HSM instance, up to 255
+    #ifndef HSM_QUEUE_DEPTH
+    #define HSM_QUEUE_DEPTH                 8
+    #endif
+    // If HSM_FEATURE_QUEUE is enabled, select the policy when HSM_Post() finds the queue full
+    #define HSM_QUEUE_DROP_NEWEST           0   // Discard the posted event
+    #define HSM_QUEUE_DROP_OLDEST           1   // Discard the oldest queued event to make room
+    #define HSM_QUEUE_HALT                  2   // Treat as a fatal design error, similar to exceeding HSM_MAX_DEPTH
+    #ifndef HSM_QUEUE_OVERFLOW
+    #define HSM_QUEUE_OVERFLOW              HSM_QUEUE_DROP_NEWEST
+    #endif
+// Enable UML event deferral with HSM_Defer(), recalled into the event queue after HSM_Tran() (requires
+// HSM_FEATURE_QUEUE).  Can be set from the makefile
+#ifndef HSM_FEATURE_DEFER
+#define HSM_FEATURE_DEFER                   0
+#endif
+    // If HSM_FEATURE_DEFER is enabled, set the number of deferred events in the pool shared by all HSM instances
+    #ifndef HSM_DEFER_POOL_SIZE
+    #define HSM_DEFER_POOL_SIZE             32
+    #endif
+    // If HSM_FEATURE_DEFER is enabled, define the lock of the pool for HSM instances running on several threads.
+    // For example: "-DHSM_DEFER_LOCK()=pthread_mutex_lock(&lock)" "-DHSM_DEFER_UNLOCK()=pthread_mutex_unlock(&lock)"
+    #ifndef HSM_DEFER_LOCK
+    #define HSM_DEFER_LOCK()
+    #define HSM_DEFER_UNLOCK()
+    #define HSM_DEFER_NO_LOCK               1
+    #endif
+// Enable the lock-free multi-producer mailbox in hsm_mbox.h (requires C11 atomics).  Can be set from the makefile
+#ifndef HSM_FEATURE_MBOX
+#define HSM_FEATURE_MBOX                    0
+#endif
+    // If HSM_FEATURE_MBOX is enabled, set the number of events per mailbox (must be a power of 2)
+    #ifndef HSM_MBOX_DEPTH
+    #define HSM_MBOX_DEPTH                  64
+    #endif
+    // If HSM_FEATURE_MBOX is enabled, set the cache line size used to keep producers and consumer apart
+    #ifndef HSM_CACHE_LINE
+    #define HSM_CACHE_LINE                  64
+    #endif
+// Enable the active object scheduler in hsm_sched.h (requires HSM_FEATURE_MBOX and pthreads).  Can be set from the makefile
+#ifndef HSM_FEATURE_SCHED
+#define HSM_FEATURE_SCHED                   0
+#endif
+    // If HSM_FEATURE_SCHED is enabled, set the maximum number of worker threads
+    #ifndef HSM_SCHED_MAX_WORKERS
+    #define HSM_SCHED_MAX_WORKERS           64
+    #endif
+    // If HSM_FEATURE_SCHED is enabled, set the number of events an instance runs before yielding its worker
+    #ifndef HSM_SCHED_BATCH
+    #define HSM_SCHED_BATCH                 32
+    #endif
+// Enable per-state event filters so HSM_Run() skips states that do not handle the event.  Can be set from the makefile
+#ifndef HSM_FEATURE_EVENT_FILTER
+#define HSM_FEATURE_EVENT_FILTER            0
+#endif
+    // If HSM_FEATURE_EVENT_FILTER is enabled, set the number of events (starting from HSME_NULL) covered by the filter.
+    // Events at or above this value are always passed to the state handler (must be a multiple of 32)
+    #ifndef HSM_EVENT_FILTER_SIZE
+    #define HSM_EVENT_FILTER_SIZE           64
+    #endif
+// Enable per-state and per-instance runtime statistics.  Can be set from the makefile
+#ifndef HSM_FEATURE_STATS
+#define HSM_FEATURE_STATS                   0
+#endif
+    // If HSM_FEATURE_STATS is enabled, you can define HSM_STATS_CLOCK for a custom free running timestamp
+    // (e.g. a cycle counter).  Otherwise CLOCK_MONOTONIC in ns is used.  For example:
+    //     Supply your own function of type "HSM_TICKS HSM_StatsClock(void)" and then define in a makefile
+    //     (e.g. for gcc: "-DHSM_STATS_CLOCK=HSM_StatsClock")
+    // If HSM_FEATURE_STATS is enabled, set the number of buckets of the handler latency histogram.  Bucket n
+    // counts latencies below (2^n << HSM_STATS_BUCKET_SHIFT) ticks, the last bucket counts the rest
+    #ifndef HSM_STATS_BUCKETS
+    #define HSM_STATS_BUCKETS               8
+    #endif
+    #ifndef HSM_STATS_BUCKET_SHIFT
+    #define HSM_STATS_BUCKET_SHIFT          5
+    #endif
+    // If HSM_FEATURE_STATS is enabled, counters are updated atomically so they can be read from another thread.
+    // Define as "((x) += (n))" for single threaded systems or compilers without the __atomic builtins
+    #ifndef HSM_STATS_ADD
+    #define HSM_STATS_ADD(x, n)             __atomic_fetch_add(&(x), (n), __ATOMIC_RELAXED)
+    #endif
+// Enable the batch runtime in hsm_batch.h for many instances sharing one chart.  Can be set from the makefile
+#ifndef HSM_FEATURE_BATCH
+#define HSM_FEATURE_BATCH                   0
+#endif
+    // If HSM_FEATURE_BATCH is enabled, set the type of the per-instance state index (limits the states per chart)
+    #ifndef HSM_BATCH_IDX
+    #define HSM_BATCH_IDX                   uint8_t
+    #endif
+    #ifndef HSM_BATCH_MAX_STATES
+    #define HSM_BATCH_MAX_STATES            256
+    #endif
+    // If HSM_FEATURE_BATCH is enabled, set the number of instances sorted by state at a time (uses 4 bytes of stack each).
+    // Sorting costs more than it saves on the charts measured by bench/batch, so 0 runs the instances in order
+    #ifndef HSM_BATCH_BLOCK
+    #define HSM_BATCH_BLOCK                 0
+    #endif
+// Enable frozen charts in hsm_chart.h, built and validated from a table of state definitions.  Can be set from the makefile
+#ifndef HSM_FEATURE_CHART
+#define HSM_FEATURE_CHART                   0
+#endif
+// Enable binary snapshot and restore of HSM instances in hsm_snap.h (requires HSM_FEATURE_CHART).  Can be set from the makefile
+#ifndef HSM_FEATURE_SNAPSHOT
+#define HSM_FEATURE_SNAPSHOT                0
+#endif
+// Enable recording of each HSM_Run() into a binary log for replay, see hsm_record.h.  Costs nothing when disabled.
+// Can be set from the makefile
+#ifndef HSM_FEATURE_RECORD
+#define HSM_FEATURE_RECORD                  0
+#endif
+    // If HSM_FEATURE_RECORD is enabled, set the size of the buffer written to the log file when full
+    #ifndef HSM_RECORD_BUFFER
+    #define HSM_RECORD_BUFFER               65536
+    #endif
+    // If HSM_FEATURE_RECORD is enabled, you can define HSM_RECORD_PAYLOAD to record the data pointed by param,
+    // up to HSM_RECORD_PAYLOAD_MAX bytes.  Otherwise only the value of param is recorded.  For example:
+    //     Supply your own function of type
+    //         "uint16_t HSM_RecordPayload(HSM *This, HSM_EVENT event, void *param, void *buf, uint16_t max)"
+    //     returning the number of bytes copied to buf, and then define in a makefile
+    //     (e.g. for gcc: "-DHSM_RECORD_PAYLOAD=HSM_RecordPayload")
+    #ifndef HSM_RECORD_PAYLOAD_MAX
+    #define HSM_RECORD_PAYLOAD_MAX          256
+    #endif
+    // If HSM_FEATURE_RECORD is enabled, you can define HSM_RECORD_CLOCK for a custom free running clock in ns to time
+    // the records.  Otherwise CLOCK_MONOTONIC is used.  HSM_REPLAY_File() always paces the replay on CLOCK_MONOTONIC
+    // If HSM_FEATURE_RECORD is enabled, define the lock of the log for HSM instances running on several threads
+    #ifndef HSM_RECORD_LOCK
+    #define HSM_RECORD_LOCK()
+    #define HSM_RECORD_UNLOCK()
+    #define HSM_RECORD_NO_LOCK              1
+    #endif
+// Enable the timing wheel timer service in hsm_timer.h.  Can be set from the makefile
+#ifndef HSM_FEATURE_TIMER
+#define HSM_FEATURE_TIMER                   0
+#endif
+    // If HSM_FEATURE_TIMER is enabled, set the number of slots per wheel as a power of 2, and the number of wheels.
+    // Timers up to 2^(HSM_TIMER_WHEEL_BITS * HSM_TIMER_WHEEL_LEVELS) ticks away are placed directly
+    #ifndef HSM_TIMER_WHEEL_BITS
+    #define HSM_TIMER_WHEEL_BITS            6
+    #endif
+    #ifndef HSM_TIMER_WHEEL_LEVELS
+    #define HSM_TIMER_WHEEL_LEVELS          4
+    #endif
+    // If HSM_FEATURE_TIMER is enabled, you can define HSM_TIMER_CLOCK for a custom free running clock in ns.
+    // Otherwise CLOCK_MONOTONIC is used.  For example:
+    //     Supply your own function of type "uint64_t HSM_TimerClock(void)" and then define in a makefile
+    //     (e.g. for gcc: "-DHSM_TIMER_CLOCK=HSM_TimerClock")
+// Enable orthogonal regions created with HSM_STATE_CreateRegion().  Can be set from the makefile
+#ifndef HSM_FEATURE_REGIONS
+#define HSM_FEATURE_REGIONS                 0
+#endif
+    // If HSM_FEATURE_REGIONS is enabled, set the total number of regions of all states, up to 32
+    #ifndef HSM_MAX_REGIONS
+    #define HSM_MAX_REGIONS                 8
+    #endif
+// Enable HSM_GET_HNDLR_STATE() so one handler function can serve several states, e.g. for language bindings.
+// Can be set from the makefile
+#ifndef HSM_FEATURE_HNDLR_STATE
+#define HSM_FEATURE_HNDLR_STATE             0
+#endif
+// Enable shallow and deep history of the states set with HSM_STATE_SetHistory().  Can be set from the makefile
+#ifndef HSM_FEATURE_HISTORY
+#define HSM_FEATURE_HISTORY                 0
+#endif
+    // If HSM_FEATURE_HISTORY is enabled, set the number of states with history, which each cost a pointer per HSM instance
+    #ifndef HSM_MAX_HISTORY
+    #define HSM_MAX_HISTORY                 8
+    #endif
+// Enable the publish/subscribe event bus in hsm_pubsub.h.  Can be set from the makefile
+#ifndef HSM_FEATURE_PUBSUB
+#define HSM_FEATURE_PUBSUB                  0
+#endif
+    // If HSM_FEATURE_PUBSUB is enabled, set the number of events (starting from HSME_NULL) that can be published
+    #ifndef HSM_PUBSUB_EVENTS
+    #define HSM_PUBSUB_EVENTS               64
+    #endif
+// Enable the set of active states of each HSM instance, so HSM_IsInState() and HSM_IsInAnyState() are bit tests
+// instead of walks up the parents.  Can be set from the makefile
+#ifndef HSM_FEATURE_ACTIVE_SET
+#define HSM_FEATURE_ACTIVE_SET              0
+#endif
+    // If HSM_FEATURE_ACTIVE_SET is enabled, set the number of states created with HSM_STATE_Create(), as a multiple
+    // of 32.  Each HSM instance uses a bit per state
+    #ifndef HSM_MAX_STATES
+    #define HSM_MAX_STATES                  64
+    #endif
+// Enable the binary trace in hsm_trace.h, which records the interactions printed by HSM_DEBUGC1/2/3 into a ring
+// buffer per thread and formats them later.  Can be set from the makefile
+#ifndef HSM_FEATURE_TRACE
+#define HSM_FEATURE_TRACE                   0
+#endif
+    // If HSM_FEATURE_TRACE is enabled, set the number of records of each ring buffer (must be a power of 2)
+    #ifndef HSM_TRACE_DEPTH
+    #define HSM_TRACE_DEPTH                 4096
+    #endif
+    // If HSM_FEATURE_TRACE is enabled, you can define HSM_TRACE_CLOCK for a custom free running clock in ns.
+    // Otherwise CLOCK_MONOTONIC is used
+// Enable the instance pool in hsm_pool.h for HSM instances created and destroyed at run time.  Can be set from the makefile
+#ifndef HSM_FEATURE_POOL
+#define HSM_FEATURE_POOL                    0
+#endif
+    // If HSM_FEATURE_POOL is enabled, set the alignment of the instances and slabs, normally the cache line size
+    #ifndef HSM_POOL_ALIGN
+    #define HSM_POOL_ALIGN                  64
+    #endif
+    // If HSM_FEATURE_POOL is enabled, set the size of the slabs allocated when a pool is empty
+    #ifndef HSM_POOL_SLAB_SIZE
+    #define HSM_POOL_SLAB_SIZE              16384
+    #endif
+    // If HSM_FEATURE_POOL is enabled, you can define HSM_POOL_SLAB_ALLOC(size) and HSM_POOL_SLAB_FREE(ptr) for the
+    // memory of the slabs.  Otherwise aligned_alloc() and free() are used.  Define HSM_POOL_SLAB_ALLOC(size) as
+    // ((void *)0) to only use the memory given to HSM_POOL_AddSlab().  Without HSM_POOL_SLAB_FREE(ptr), the slabs of
+    // a custom HSM_POOL_SLAB_ALLOC(size) are never freed
+    // If HSM_FEATURE_POOL is enabled, define the lock of the pools for HSM instances allocated on several threads.
+    // For example: "-DHSM_POOL_LOCK()=pthread_mutex_lock(&lock)" "-DHSM_POOL_UNLOCK()=pthread_mutex_unlock(&lock)"
+    #ifndef HSM_POOL_LOCK
+    #define HSM_POOL_LOCK()
+    #define HSM_POOL_UNLOCK()
+    #endif
+// Enable the shared memory transport in hsm_shm.h, posting events and payloads to HSM instances of another process
+// on the same host (requires C11 atomics and Linux).  Can be set from the makefile
+#ifndef HSM_FEATURE_SHM
+#define HSM_FEATURE_SHM                     0
+#endif
+    // If HSM_FEATURE_SHM is enabled, set the number of producer processes per segment, each with its own channel
+    #ifndef HSM_SHM_CHANNELS
+    #define HSM_SHM_CHANNELS                8
+    #endif
+    // If HSM_FEATURE_SHM is enabled, set the number of events per channel (must be a power of 2)
+    #ifndef HSM_SHM_DEPTH
+    #define HSM_SHM_DEPTH                   256
+    #endif
+    // If HSM_FEATURE_SHM is enabled, set the bytes of the payload arena per channel (must be a power of 2)
+    #ifndef HSM_SHM_ARENA
+    #define HSM_SHM_ARENA                   65536
+    #endif
+// Enable the bump arena in hsm_arena.h for the params of the events, reset when the run-to-completion cycle of
+// HSM_Run() or HSM_Dispatch() ends.  Can be set from the makefile
+#ifndef HSM_FEATURE_ARENA
+#define HSM_FEATURE_ARENA                   0
+#endif
+    // If HSM_FEATURE_ARENA is enabled, set the alignment of the params (must be a power of 2)
+    #ifndef HSM_ARENA_ALIGN
+    #define HSM_ARENA_ALIGN                 8
+    #endif
+    // If HSM_FEATURE_ARENA is enabled, you can define HSM_ARENA_MALLOC(size) and HSM_ARENA_FREE(ptr) for the params
+    // that do not fit in the arena and the promoted params.  Otherwise malloc() and free() are used
 //----HSM OPTIONAL FEATURES SECTION[END]----
 
-// Set the maximum nested levels
+// Set the maximum nested levels.  Can be set from the makefile
+#ifndef HSM_MAX_DEPTH
 #define HSM_MAX_DEPTH 5
+#endif
 
 //----State definitions----
 #define HSME_NULL   0
@@ -65,6 +338,71 @@ extern "C" {
 #define HSME_INIT   ((HSM_EVENT)(-3))
 #define HSME_ENTRY  ((HSM_EVENT)(-2))
 #define HSME_EXIT   ((HSM_EVENT)(-1))
+#if HSM_FEATURE_TRAN_CACHE
+#if HSM_TRAN_CACHE_SIZE & (HSM_TRAN_CACHE_SIZE - 1)
+#error "HSM_TRAN_CACHE_SIZE must be a power of 2"
+#endif // HSM_TRAN_CACHE_SIZE
+#endif // HSM_FEATURE_TRAN_CACHE
+#if HSM_FEATURE_EVENT_FILTER
+#if HSM_EVENT_FILTER_SIZE % 32
+#error "HSM_EVENT_FILTER_SIZE must be a multiple of 32"
+#endif // HSM_EVENT_FILTER_SIZE
+#endif // HSM_FEATURE_EVENT_FILTER
+#if HSM_FEATURE_REGIONS
+#if HSM_MAX_REGIONS > 32
+#error "HSM_MAX_REGIONS must not exceed 32"
+#endif // HSM_MAX_REGIONS
+#if HSM_FEATURE_BATCH
+#error "HSM_FEATURE_REGIONS can not be used with HSM_FEATURE_BATCH, whose instances share one HSM context"
+#endif // HSM_FEATURE_BATCH
+#define HSM_NO_REGION 0xFF
+#endif // HSM_FEATURE_REGIONS
+#if HSM_FEATURE_HISTORY
+#if HSM_FEATURE_BATCH
+#error "HSM_FEATURE_HISTORY can not be used with HSM_FEATURE_BATCH, whose instances share one HSM context"
+#endif // HSM_FEATURE_BATCH
+#define HSM_NO_HISTORY 0xFF
+#define HSM_HISTORY_SHALLOW 0
+#define HSM_HISTORY_DEEP 1
+#endif // HSM_FEATURE_HISTORY
+#if HSM_FEATURE_ACTIVE_SET
+#if HSM_MAX_STATES % 32 || HSM_MAX_STATES >= 0xFFFF
+#error "HSM_MAX_STATES must be a multiple of 32 below 65535"
+#endif // HSM_MAX_STATES
+#if HSM_FEATURE_BATCH
+#error "HSM_FEATURE_ACTIVE_SET can not be used with HSM_FEATURE_BATCH, whose instances share one HSM context"
+#endif // HSM_FEATURE_BATCH
+#define HSM_NO_ACTIVE 0xFFFF
+#endif // HSM_FEATURE_ACTIVE_SET
+#if HSM_FEATURE_BATCH
+// The timers and subscriptions are tracked on the HSM instance
+#if HSM_FEATURE_TIMER
+#error "HSM_FEATURE_TIMER can not be used with HSM_FEATURE_BATCH, whose instances share one HSM context"
+#endif // HSM_FEATURE_TIMER
+#if HSM_FEATURE_PUBSUB
+#error "HSM_FEATURE_PUBSUB can not be used with HSM_FEATURE_BATCH, whose instances share one HSM context"
+#endif // HSM_FEATURE_PUBSUB
+#endif // HSM_FEATURE_BATCH
+#if HSM_FEATURE_SCHED
+// The workers run the instances on several threads, so the state shared by all instances must be locked
+#if HSM_FEATURE_DEFER && HSM_DEFER_NO_LOCK
+#error "HSM_FEATURE_DEFER with HSM_FEATURE_SCHED requires HSM_DEFER_LOCK() and HSM_DEFER_UNLOCK() for the shared pool"
+#endif // HSM_FEATURE_DEFER && HSM_DEFER_NO_LOCK
+#if HSM_FEATURE_RECORD && HSM_RECORD_NO_LOCK
+#error "HSM_FEATURE_RECORD with HSM_FEATURE_SCHED requires HSM_RECORD_LOCK() and HSM_RECORD_UNLOCK() for the shared log"
+#endif // HSM_FEATURE_RECORD && HSM_RECORD_NO_LOCK
+#if HSM_FEATURE_TRAN_CACHE && HSM_TRAN_CACHE_LAZY
+#error "HSM_FEATURE_TRAN_CACHE with HSM_FEATURE_SCHED requires HSM_TRAN_CACHE_LAZY 0 and paths preloaded with HSM_TranCacheLoad()"
+#endif // HSM_FEATURE_TRAN_CACHE && HSM_TRAN_CACHE_LAZY
+// The nesting level of the debug messages is kept per worker
+#ifdef __cplusplus
+#define HSM_THREAD_LOCAL thread_local
+#else
+#define HSM_THREAD_LOCAL _Thread_local
+#endif // __cplusplus
+#else
+#define HSM_THREAD_LOCAL
+#endif // HSM_FEATURE_SCHED
 
 //----Debug Macros----
 #if HSM_FEATURE_DEBUG_ENABLE
@@ -147,17 +485,148 @@ typedef struct HSM_T HSM;
 
 typedef HSM_EVENT (* HSM_FN)(HSM *This, HSM_EVENT event, void *param);
 
+#if HSM_FEATURE_STATS
+typedef uint64_t HSM_TICKS;
+
+typedef struct HSM_STATE_STATS_T
+{
+    uint32_t handled;           // Events consumed by the state handler
+    uint32_t passed;            // Events returned by the state handler to the parent state
+    uint32_t entries;           // HSME_ENTRY events
+    uint32_t exits;             // HSME_EXIT events
+    HSM_TICKS dwell;            // Accumulated time in the state, updated on HSME_EXIT
+    uint32_t latency[HSM_STATS_BUCKETS]; // Histogram of the state handler latency
+} HSM_STATE_STATS;
+
+typedef struct HSM_STATS_T
+{
+    uint32_t events;            // Calls of HSM_Run()
+    uint32_t dropped;           // Events not handled by any state
+    uint32_t transitions;       // Calls of HSM_Tran()
+    uint32_t latency[HSM_STATS_BUCKETS]; // Histogram of the HSM_Run() latency
+} HSM_STATS;
+#endif // HSM_FEATURE_STATS
+
 struct HSM_STATE_T
 {
     HSM_STATE *parent;          // parent state
     HSM_FN handler;             // associated event handler for state
     const char *name;           // name of state
     uint8_t level;              // depth level of the state
+#if HSM_FEATURE_EVENT_FILTER
+    uint8_t isFiltered;         // Set if the state declared its events with HSM_STATE_SetEvents()
+    uint32_t events[HSM_EVENT_FILTER_SIZE / 32]; // Bitmap of events handled by the state
+#endif // HSM_FEATURE_EVENT_FILTER
+#if HSM_FEATURE_STATS
+    HSM_STATE_STATS stats;      // Statistics of all HSM instances in this state
+#endif // HSM_FEATURE_STATS
+#if HSM_FEATURE_RECORD
+    uint32_t recId;             // Hash of the name, identifies the state in the record log across builds
+#endif // HSM_FEATURE_RECORD
+#if HSM_FEATURE_REGIONS
+    uint8_t region;             // Region of the state, HSM_NO_REGION if outside any region
+    uint8_t regionFirst;        // First region of a composite state with orthogonal regions
+    uint8_t regionCount;        // Number of orthogonal regions of the state
+#endif // HSM_FEATURE_REGIONS
+#if HSM_FEATURE_HISTORY
+    uint8_t history;            // Index of the history of the state in HSM, HSM_NO_HISTORY if none
+    uint8_t historyDeep;        // Set if the history is the innermost state rather than the direct substate
+#endif // HSM_FEATURE_HISTORY
+#if HSM_FEATURE_PUBSUB
+    const HSM_EVENT *subscribe; // Events published to the HSM instances while in the state
+    uint8_t subscribeCount;     // Number of events in subscribe
+#endif // HSM_FEATURE_PUBSUB
+#if HSM_FEATURE_ACTIVE_SET
+    uint16_t active;            // Bit of the state in the active set of HSM instances, HSM_NO_ACTIVE if none
+#endif // HSM_FEATURE_ACTIVE_SET
 };
 
+// Static initializer of an HSM_STATE, equivalent to HSM_STATE_Create() e.g. for the charts generated by hsmgen.py.
+// Top level states have the parent (HSM_STATE *)&HSM_ROOT at level 1, and id is HSM_RECORD_StateId(name)
+#if HSM_FEATURE_REGIONS
+#define HSM_STATE_INIT_REGION       .region = HSM_NO_REGION,
+#else
+#define HSM_STATE_INIT_REGION
+#endif // HSM_FEATURE_REGIONS
+#if HSM_FEATURE_HISTORY
+#define HSM_STATE_INIT_HISTORY      .history = HSM_NO_HISTORY,
+#else
+#define HSM_STATE_INIT_HISTORY
+#endif // HSM_FEATURE_HISTORY
+#if HSM_FEATURE_ACTIVE_SET
+#define HSM_STATE_INIT_ACTIVE       .active = HSM_NO_ACTIVE,
+#else
+#define HSM_STATE_INIT_ACTIVE
+#endif // HSM_FEATURE_ACTIVE_SET
+#if HSM_FEATURE_RECORD
+#define HSM_STATE_INIT_RECORD(id)   .recId = (id),
+#else
+#define HSM_STATE_INIT_RECORD(id)
+#endif // HSM_FEATURE_RECORD
+#define HSM_STATE_INIT(stName, stHandler, stParent, stLevel, stId) \
+    { .parent = (stParent), .handler = (stHandler), .name = (stName), .level = (stLevel), \
+      HSM_STATE_INIT_REGION HSM_STATE_INIT_HISTORY HSM_STATE_INIT_ACTIVE HSM_STATE_INIT_RECORD(stId) }
+
+#if HSM_FEATURE_ACTIVE_SET
+// Set of states tested at once by HSM_IsInAnyState()
+typedef struct HSM_STATE_SET_T
+{
+    uint32_t bits[HSM_MAX_STATES / 32]; // Bits of the states in the set
+} HSM_STATE_SET;
+#endif // HSM_FEATURE_ACTIVE_SET
+
+#if HSM_FEATURE_QUEUE
+#if HSM_QUEUE_DEPTH < 1 || HSM_QUEUE_DEPTH > 255
+#error "HSM_QUEUE_DEPTH must be from 1 to 255"
+#endif // HSM_QUEUE_DEPTH
+#if HSM_FEATURE_BATCH
+#error "HSM_FEATURE_QUEUE can not be used with HSM_FEATURE_BATCH, whose instances share one HSM context"
+#endif // HSM_FEATURE_BATCH
+typedef struct HSM_QEVT_T
+{
+    HSM_EVENT event;            // Queued event
+    void *param;                // Parameter associated with the queued event
+} HSM_QEVT;
+#endif // HSM_FEATURE_QUEUE
+
+#if HSM_FEATURE_DEFER
+#if !HSM_FEATURE_QUEUE
+#error "HSM_FEATURE_DEFER requires HSM_FEATURE_QUEUE"
+#endif // !HSM_FEATURE_QUEUE
+#if HSM_FEATURE_BATCH
+#error "HSM_FEATURE_DEFER can not be used with HSM_FEATURE_BATCH, whose instances share one HSM context"
+#endif // HSM_FEATURE_BATCH
+typedef struct HSM_DEFER_EVT_T
+{
+    struct HSM_DEFER_EVT_T *next; // Next deferred event of the HSM instance, or next free event of the pool
+    HSM_EVENT event;            // Deferred event
+    void *param;                // Parameter associated with the deferred event
+} HSM_DEFER_EVT;
+
+typedef struct HSM_DEFER_STATS_T
+{
+    uint16_t size;              // Number of events in the pool
+    uint16_t used;              // Events currently deferred
+    uint16_t highWater;         // Most events deferred at once
+    uint32_t dropped;           // Events not deferred because the pool was empty
+} HSM_DEFER_STATS;
+#endif // HSM_FEATURE_DEFER
+
 struct HSM_T
 {
     HSM_STATE *curState;        // Current HSM State
+#if HSM_FEATURE_QUEUE
+    HSM_QEVT queue[HSM_QUEUE_DEPTH]; // Ring buffer of posted events
+    uint8_t qHead;              // Index of the oldest queued event
+    uint8_t qCount;             // Number of queued events
+    uint8_t qBusy;              // Set while HSM_Dispatch() is draining the queue
+#endif // HSM_FEATURE_QUEUE
+#if HSM_FEATURE_DEFER
+    HSM_DEFER_EVT *deferHead;   // Oldest deferred event
+    HSM_DEFER_EVT **deferTail;  // Link to append the next deferred event
+    uint16_t deferCount;        // Number of deferred events
+    uint16_t deferRecall;       // Number of deferred events waiting for room in the event queue to be recalled
+#endif // HSM_FEATURE_DEFER
 #if HSM_FEATURE_DEBUG_ENABLE
     const char *name;           // Name of HSM Machine
     const char *prefix;         // Prefix for debugging (e.g. grep)
@@ -167,11 +636,44 @@ struct HSM_T
 #if HSM_FEATURE_SAFETY_CHECK
     uint8_t hsmTran;            // HSM Transition Flag
 #endif // HSM_FEATURE_SAFETY_CHECK
+#if HSM_FEATURE_RECORD
+    uint32_t recId;             // Identifies the instance in the record log, in order of creation
+#endif // HSM_FEATURE_RECORD
+#if HSM_FEATURE_TIMER
+    struct HSM_TIMER_T *timers; // Armed timers, those owned by a state are cancelled on HSME_EXIT of that state
+#endif // HSM_FEATURE_TIMER
+#if HSM_FEATURE_REGIONS
+    HSM_STATE *regions[HSM_MAX_REGIONS]; // Active state of each region while curState is their composite state
+    uint8_t region;             // Region being run, HSM_NO_REGION outside the regions
+#endif // HSM_FEATURE_REGIONS
+#if HSM_FEATURE_HNDLR_STATE
+    HSM_STATE *hndlrState;      // State of the handler being called
+#endif // HSM_FEATURE_HNDLR_STATE
+#if HSM_FEATURE_HISTORY
+    HSM_STATE *history[HSM_MAX_HISTORY]; // Substate last exited of each state with history, NULL if none
+#endif // HSM_FEATURE_HISTORY
+#if HSM_FEATURE_PUBSUB
+    struct HSM_BUS_T *bus;      // Bus the instance joined, NULL if none
+    struct HSM_SUB_T *subs;     // Subscriptions of the instance, one per event subscribed by its active states
+    uint8_t subCount;           // Number of subscriptions in subs
+#endif // HSM_FEATURE_PUBSUB
+#if HSM_FEATURE_ACTIVE_SET
+    uint32_t active[HSM_MAX_STATES / 32]; // Bits of the active states, updated on HSME_ENTRY and HSME_EXIT
+#endif // HSM_FEATURE_ACTIVE_SET
+#if HSM_FEATURE_ARENA
+    struct HSM_ARENA_T *arena;  // Arena of the params of the cycle, NULL if none
+#endif // HSM_FEATURE_ARENA
+#if HSM_FEATURE_STATS
+    HSM_STATS stats;            // Statistics of this HSM instance
+    HSM_TICKS entered[HSM_MAX_DEPTH]; // Time each active state was entered, indexed by level
+    HSM_TICKS tranTime;         // Time of the transition in progress
+#endif // HSM_FEATURE_STATS
 };
 
 //---- External Globals----
+extern HSM_STATE const HSM_ROOT;
 #if HSM_FEATURE_DEBUG_NESTED_CALL
-extern uint8_t gucHsmNestLevel;
+extern HSM_THREAD_LOCAL uint8_t gucHsmNestLevel;
 extern const char * const apucHsmNestIndent[];
 #endif // HSM_FEATURE_DEBUG_NESTED_CALL
 
@@ -184,18 +686,69 @@ extern const char * const apucHsmNestIndent[];
 // parent: Parent state.  If NULL, then internal ROOT handler is used as catch-all
 void HSM_STATE_Create(HSM_STATE *This, const char *name, HSM_FN handler, HSM_STATE *parent);
 
+#if HSM_FEATURE_REGIONS
+// Func: void HSM_STATE_CreateRegion(HSM_STATE *This, const char *name, HSM_FN handler, HSM_STATE *parent)
+// Desc: Create an orthogonal region of a composite state.  While the composite state is active, every region has
+//       its own active state and receives each event before the composite state.  The regions of a state must be
+//       created one after the other, and regions cannot be nested.  Like HSM_Create(), the HSME_INIT handler of the
+//       region state calls HSM_Tran() to the initial state of the region
+// This: Pointer to HSM_STATE object
+// name: Name of region (for debugging)
+// handler: Region Event Handler
+// parent: Composite state, outside of any region
+void HSM_STATE_CreateRegion(HSM_STATE *This, const char *name, HSM_FN handler, HSM_STATE *parent);
+#endif // HSM_FEATURE_REGIONS
+
+#if HSM_FEATURE_HISTORY
+// Func: void HSM_STATE_SetHistory(HSM_STATE *This, uint8_t deep)
+// Desc: Record the history of a composite state in each HSM instance, for HSM_TranHistory()
+// This: Pointer to HSM_STATE object, already created with HSM_STATE_Create()
+// deep: HSM_HISTORY_SHALLOW - remember the direct substate, whose HSME_INIT runs on return
+//       HSM_HISTORY_DEEP - remember the innermost state
+void HSM_STATE_SetHistory(HSM_STATE *This, uint8_t deep);
+#endif // HSM_FEATURE_HISTORY
+
+#if HSM_FEATURE_EVENT_FILTER
+// Func: void HSM_STATE_SetEvents(HSM_STATE *This, const HSM_EVENT *events, uint8_t count)
+// Desc: Declare the events handled by a state.  HSM_Run() then only calls the state handler for these events
+//       and events at or above HSM_EVENT_FILTER_SIZE.  States that declare nothing receive all events
+// This: Pointer to HSM_STATE object, already created with HSM_STATE_Create()
+// events: Array of events handled by the state handler
+// count: Number of events in the array
+void HSM_STATE_SetEvents(HSM_STATE *This, const HSM_EVENT *events, uint8_t count);
+#endif // HSM_FEATURE_EVENT_FILTER
+
 // Func: void HSM_Create(HSM *This, const char *name, HSM_STATE *initState)
 // Desc: Create the HSM instance.  Required for each instance
 // name: Name of state machine (for debugging)
 // initState: Initial state of statemachine
 void HSM_Create(HSM *This, const char *name, HSM_STATE *initState);
 
+// Func: void HSM_Restore(HSM *This, const char *name, HSM_STATE *state)
+// Desc: Create the HSM instance directly in a state without invoking HSME_ENTRY and HSME_INIT, e.g. to restore
+//       an instance saved before a restart
+// name: Name of state machine (for debugging)
+// state: State the statemachine is restored to
+void HSM_Restore(HSM *This, const char *name, HSM_STATE *state);
+
+// Func: void HSM_Destroy(HSM *This, void *param)
+// Desc: Destroy the HSM instance, sending HSME_EXIT to the current state and its parents innermost first.  The
+//       instance is left in the root state, and its timers, subscriptions, deferred and queued events are dropped
+// This: Pointer to HSM instance
+// param: Optional Parameter associated with HSME_EXIT event
+void HSM_Destroy(HSM *This, void *param);
+
 // Func: HSM_STATE *HSM_GetState(HSM *This)
 // Desc: Get the current HSM STATE
 // This: Pointer to HSM instance
 // return|HSM_STATE *: Pointer to HSM STATE
 HSM_STATE *HSM_GetState(HSM *This);
 
+#if HSM_FEATURE_HNDLR_STATE
+// Use this macro in a state handler to get the state it is called for
+#define HSM_GET_HNDLR_STATE(hsm) ((hsm)->hndlrState)
+#endif // HSM_FEATURE_HNDLR_STATE
+
 // Func: uint8_t HSM_IsInState(HSM *This, HSM_STATE *state)
 // Desc: Tests whether HSM is in state or parent state
 // This: Pointer to HSM instance
@@ -203,6 +756,22 @@ HSM_STATE *HSM_GetState(HSM *This);
 // return|uint8_t: 1 - HSM instance is in state or parent state, 0 - otherwise
 uint8_t HSM_IsInState(HSM *This, HSM_STATE *state);
 
+#if HSM_FEATURE_ACTIVE_SET
+// Func: void HSM_STATE_SET_Create(HSM_STATE_SET *This, HSM_STATE * const *states, uint8_t count)
+// Desc: Create a set of states for HSM_IsInAnyState().  The states must be created with HSM_STATE_Create()
+// This: Pointer to HSM_STATE_SET object
+// states: Array of states in the set
+// count: Number of states in the array
+void HSM_STATE_SET_Create(HSM_STATE_SET *This, HSM_STATE * const *states, uint8_t count);
+
+// Func: uint8_t HSM_IsInAnyState(HSM *This, const HSM_STATE_SET *set)
+// Desc: Tests whether HSM is in any state of the set or in a parent state, in time independent of the set size
+// This: Pointer to HSM instance
+// set: Pointer to HSM_STATE_SET to test
+// return|uint8_t: 1 - HSM instance is in a state of the set, 0 - otherwise
+uint8_t HSM_IsInAnyState(HSM *This, const HSM_STATE_SET *set);
+#endif // HSM_FEATURE_ACTIVE_SET
+
 // Func: void HSM_Run(HSM *This, HSM_EVENT event, void *param)
 // Desc: Run the HSM with event
 // This: Pointer to HSM instance
@@ -218,6 +787,108 @@ void HSM_Run(HSM *This, HSM_EVENT event, void *param);
 // method: Optional function hook between the HSME_ENTRY and HSME_EXIT event handling
 void HSM_Tran(HSM *This, HSM_STATE *nextState, void *param, void (*method)(HSM *This, void *param));
 
+// Func: void HSM_TranDirect(HSM *This, HSM_STATE *nextState, HSM_STATE * const *list, uint8_t cntExit, uint8_t cntEntry, void *param, void (*method)(HSM *This, void *param))
+// Desc: Transition to another HSM STATE along a precomputed path, e.g. generated by hsmgen.py.  The path must be
+//       the one HSM_Tran() would take from the current state, followed by the initial substates of nextState
+//       since HSME_INIT is not invoked
+// This: Pointer to HSM instance
+// nextState: Pointer to next HSM STATE, the innermost state entered
+// list: States to exit innermost first, followed by the states to enter innermost first
+// cntExit: Number of states to exit
+// cntEntry: Number of states to enter
+// param: Optional Parameter associated with HSME_ENTRY and HSME_EXIT event
+// method: Optional function hook between the HSME_ENTRY and HSME_EXIT event handling
+void HSM_TranDirect(HSM *This, HSM_STATE *nextState, HSM_STATE * const *list, uint8_t cntExit, uint8_t cntEntry,
+                    void *param, void (*method)(HSM *This, void *param));
+
+#if HSM_FEATURE_HISTORY
+// Func: void HSM_TranHistory(HSM *This, HSM_STATE *state, void *param, void (*method)(HSM *This, void *param))
+// Desc: Transition to the history of a state, i.e. directly back to the substate active when the state was
+//       last exited.  Transitions to the state itself if it was not exited yet
+// This: Pointer to HSM instance
+// state: Pointer to HSM STATE with history
+// param: Optional Parameter associated with HSME_ENTRY and HSME_EXIT event
+// method: Optional function hook between the HSME_ENTRY and HSME_EXIT event handling
+void HSM_TranHistory(HSM *This, HSM_STATE *state, void *param, void (*method)(HSM *This, void *param));
+
+// Func: void HSM_ClearHistory(HSM *This, HSM_STATE *state)
+// Desc: Forget the history of a state, so the next HSM_TranHistory() goes to the state itself
+// This: Pointer to HSM instance
+// state: Pointer to HSM STATE with history
+void HSM_ClearHistory(HSM *This, HSM_STATE *state);
+#endif // HSM_FEATURE_HISTORY
+
+#if HSM_FEATURE_QUEUE
+// Func: uint8_t HSM_Post(HSM *This, HSM_EVENT event, void *param)
+// Desc: Queue an event for the HSM without running it.  Safe to call from a state handler
+// This: Pointer to HSM instance
+// event: HSM_EVENT to be processed by HSM_Dispatch()
+// param: Parameter associated with HSM_EVENT
+// return|uint8_t: 1 - event is queued, 0 - queue is full and event is dropped (see HSM_QUEUE_OVERFLOW)
+uint8_t HSM_Post(HSM *This, HSM_EVENT event, void *param);
+
+// Func: uint32_t HSM_Dispatch(HSM *This)
+// Desc: Run all queued events to completion in order, including events posted while dispatching.
+//       A nested call from a state handler returns immediately, leaving the events to the outer call
+// This: Pointer to HSM instance
+// return|uint32_t: Number of events dispatched
+uint32_t HSM_Dispatch(HSM *This);
+#endif // HSM_FEATURE_QUEUE
+
+#if HSM_FEATURE_DEFER
+// Func: uint8_t HSM_Defer(HSM *This, HSM_EVENT event, void *param)
+// Desc: Defer an event from a state handler.  Deferred events are recalled in order after the next HSM_Tran().
+//       With HSM_FEATURE_ARENA, a param allocated with HSM_ParamAlloc() must be promoted with HSM_ParamPromote()
+// This: Pointer to HSM instance
+// event: HSM_EVENT to be recalled
+// param: Parameter associated with HSM_EVENT
+// return|uint8_t: 1 - event is deferred, 0 - pool is empty and event is dropped
+uint8_t HSM_Defer(HSM *This, HSM_EVENT event, void *param);
+
+// Func: uint16_t HSM_Recall(HSM *This)
+// Desc: Recall the deferred events to the event queue, in the order they were deferred.  Called by HSM_Tran() once
+//       the transition completes.  Events that do not fit in the queue are posted by HSM_Dispatch() as room is made,
+//       and events deferred again meanwhile wait for the next recall
+// This: Pointer to HSM instance
+// return|uint16_t: Number of events recalled
+uint16_t HSM_Recall(HSM *This);
+
+// Func: void HSM_GetDeferStats(HSM_DEFER_STATS *stats, uint8_t reset)
+// Desc: Snapshot the usage of the deferred event pool
+// stats: Pointer to the snapshot
+// reset: 1 - Restart the high-water mark from the current usage and clear the dropped count, 0 - leave them
+void HSM_GetDeferStats(HSM_DEFER_STATS *stats, uint8_t reset);
+#endif // HSM_FEATURE_DEFER
+
+#if HSM_FEATURE_STATS
+// Func: void HSM_STATE_GetStats(HSM_STATE *This, HSM_STATE_STATS *stats, uint8_t reset)
+// Desc: Snapshot the statistics of a state.  Safe to call from another thread, each counter is read atomically
+// This: Pointer to HSM_STATE object
+// stats: Pointer to the snapshot
+// reset: 1 - Clear each counter as it is read, 0 - leave the counters running
+void HSM_STATE_GetStats(HSM_STATE *This, HSM_STATE_STATS *stats, uint8_t reset);
+
+// Func: void HSM_GetStats(HSM *This, HSM_STATS *stats, uint8_t reset)
+// Desc: Snapshot the statistics of an HSM instance.  Safe to call from another thread, each counter is read atomically
+// This: Pointer to HSM instance
+// stats: Pointer to the snapshot
+// reset: 1 - Clear each counter as it is read, 0 - leave the counters running
+void HSM_GetStats(HSM *This, HSM_STATS *stats, uint8_t reset);
+#endif // HSM_FEATURE_STATS
+
+#if HSM_FEATURE_TRAN_CACHE
+// Func: uint8_t HSM_TranCacheLoad(HSM_STATE *src, HSM_STATE *dst)
+// Desc: Precompute and cache the exit/entry path used by HSM_Tran() from src to dst
+// src: Pointer to source HSM_STATE
+// dst: Pointer to target HSM_STATE
+// return|uint8_t: 1 - path is cached, 0 - path evicted another cached path
+uint8_t HSM_TranCacheLoad(HSM_STATE *src, HSM_STATE *dst);
+
+// Func: void HSM_TranCacheFlush(void)
+// Desc: Invalidate all cached transition paths.  Called by HSM_STATE_Create() and HSM_Create() when the hierarchy may change
+void HSM_TranCacheFlush(void);
+#endif // HSM_FEATURE_TRAN_CACHE
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,303 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef __HSM_HPP__
+#define __HSM_HPP__
+
+// Header-only C++17 front-end for charts that are fully known at compile time.  States are types whose
+// parent is a template parameter, so HSM_Run()'s parent walk and HSM_Tran()'s exit/entry lists are
+// resolved by the compiler and the handlers can be inlined.  The event semantics follow hsm.c:
+//   1) Run() passes the event returned by a handler to the parent state until it is consumed or dropped by the root
+//   2) Tran() sends HSME_EXIT up to the lowest common parent, calls the method hook, sends HSME_ENTRY down to
+//      the next state, sets the state and then sends HSME_INIT
+// For example:
+//     struct Off : hsm::State<> {};
+//     struct On : hsm::State<> {};
+//     struct OnShoot : hsm::State<On> {};
+//     struct Camera : hsm::Machine<Camera, Off, On, OnShoot>
+//     {
+//         HSM_EVENT Handle(Off, HSM_EVENT event, void *param) { if (event == HSME_PWR) { Tran<On>(); return 0; } return event; }
+//         ...
+//     };
+//     Camera camera;
+//     camera.Create<Off>();
+//     camera.Run(HSME_PWR);
+// A state without a Handle() overload in the machine passes all events to its parent.  The machine may also
+// provide Handle(hsm::Root, ...) to catch unhandled events, which are otherwise dropped.
+
+#include "hsm.h"
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace hsm
+{
+
+// Top of every state hierarchy
+struct Root
+{
+};
+
+// Base of every state type.  Parent is the enclosing state type, or Root for a top level state
+template <class Parent = Root>
+struct State
+{
+    using parent = Parent;
+};
+
+namespace detail
+{
+    template <class S>
+    struct Tag
+    {
+        using type = S;
+    };
+
+    // Depth level of the state, as HSM_STATE::level
+    template <class S>
+    struct Level
+    {
+        static constexpr unsigned value = 1 + Level<typename S::parent>::value;
+    };
+    template <>
+    struct Level<Root>
+    {
+        static constexpr unsigned value = 0;
+    };
+
+    // Ancestor of S, n levels up
+    template <class S, unsigned N>
+    struct Up
+    {
+        using type = typename Up<typename S::parent, N - 1>::type;
+    };
+    template <class S>
+    struct Up<S, 0>
+    {
+        using type = S;
+    };
+
+    // Lowest common parent found the same way as HSM_Tran(): equalize the levels, then walk up together
+    template <class A, class B, bool = std::is_same<A, B>::value>
+    struct Common
+    {
+        using type = typename Common<typename A::parent, typename B::parent>::type;
+    };
+    template <class A, class B>
+    struct Common<A, B, true>
+    {
+        using type = A;
+    };
+    template <class A, class B>
+    struct Lca
+    {
+        static constexpr unsigned levelA = Level<A>::value;
+        static constexpr unsigned levelB = Level<B>::value;
+        using type = typename Common<typename Up<A, (levelA > levelB) ? levelA - levelB : 0>::type,
+                                     typename Up<B, (levelB > levelA) ? levelB - levelA : 0>::type>::type;
+    };
+
+    // Tests whether S is A or a child of A
+    template <class A, class S>
+    struct IsWithin
+    {
+        static constexpr bool value = std::is_same<A, S>::value || IsWithin<A, typename S::parent>::value;
+    };
+    template <class A>
+    struct IsWithin<A, Root>
+    {
+        static constexpr bool value = std::is_same<A, Root>::value;
+    };
+
+    // Index of S in the list of states
+    template <class S, class... States>
+    struct IndexOf;
+    template <class S, class... States>
+    struct IndexOf<S, S, States...>
+    {
+        static constexpr std::size_t value = 0;
+    };
+    template <class S, class T, class... States>
+    struct IndexOf<S, T, States...>
+    {
+        static constexpr std::size_t value = 1 + IndexOf<S, States...>::value;
+    };
+
+    // Tests whether the machine D has a Handle() overload for state S
+    template <class D, class S, class = void>
+    struct HasHandler : std::false_type
+    {
+    };
+    template <class D, class S>
+    struct HasHandler<D, S, std::void_t<decltype(std::declval<D &>().Handle(S{}, HSM_EVENT{}, (void *)0))>>
+        : std::true_type
+    {
+    };
+} // namespace detail
+
+// Base of a state machine.  Derived implements the handlers as public "HSM_EVENT Handle(StateType, HSM_EVENT, void *)"
+// overloads, and States lists every state type of the chart
+template <class Derived, class... States>
+class Machine
+{
+public:
+    // Set the initial state and send it HSME_ENTRY and HSME_INIT, as HSM_Create()
+    template <class Init>
+    void Create(void)
+    {
+        curState = detail::IndexOf<Init, States...>::value;
+#if HSM_FEATURE_SAFETY_CHECK
+        hsmTran = false;
+#endif // HSM_FEATURE_SAFETY_CHECK
+        Call<Init>(HSME_ENTRY, nullptr);
+        Call<Init>(HSME_INIT, nullptr);
+    }
+
+    // Index of the current state in the States list, as HSM_GetState()
+    std::size_t GetState(void) const
+    {
+        return curState;
+    }
+
+    // Tests whether the machine is in state S or a child of S, as HSM_IsInState()
+    template <class S>
+    bool IsInState(void) const
+    {
+        return ((curState == detail::IndexOf<States, States...>::value && detail::IsWithin<S, States>::value) || ...);
+    }
+
+    // Run the machine with event, as HSM_Run()
+    void Run(HSM_EVENT event, void *param = nullptr)
+    {
+        Visit([&](auto tag) { this->template RunFrom<typename decltype(tag)::type>(event, param); });
+    }
+
+    // Transition to state Next, as HSM_Tran().  method is an optional callable taking (Derived &, void *)
+    template <class Next, class Method = std::nullptr_t>
+    void Tran(void *param = nullptr, Method &&method = nullptr)
+    {
+        static_assert((std::is_same<Next, States>::value || ...), "Next state is not in the machine's States");
+#if HSM_FEATURE_SAFETY_CHECK
+        // Check for illegal call to Tran() in HSME_ENTRY or HSME_EXIT
+        if (hsmTran)
+        {
+            return;
+        }
+        hsmTran = true;
+#endif // HSM_FEATURE_SAFETY_CHECK
+        Visit([&](auto tag) {
+            using Src = typename decltype(tag)::type;
+            using Top = typename detail::Lca<Src, Next>::type;
+            this->template Exit<Src, Top>(param);
+            if constexpr (!std::is_same<std::decay_t<Method>, std::nullptr_t>::value)
+            {
+                method(static_cast<Derived &>(*this), param);
+            }
+            this->template Entry<Top, Next>(param);
+        });
+        curState = detail::IndexOf<Next, States...>::value;
+#if HSM_FEATURE_SAFETY_CHECK
+        hsmTran = false;
+#endif // HSM_FEATURE_SAFETY_CHECK
+#if HSM_FEATURE_INIT
+        Call<Next>(HSME_INIT, param);
+#endif // HSM_FEATURE_INIT
+    }
+
+private:
+    // Invoke f with the tag of the current state, compiled to a switch on curState
+    template <class F>
+    void Visit(F &&f)
+    {
+        VisitIndex(f, std::index_sequence_for<States...>{});
+    }
+
+    template <class F, std::size_t... I>
+    void VisitIndex(F &f, std::index_sequence<I...>)
+    {
+        (void)((curState == I ? (f(detail::Tag<States>{}), true) : false) || ...);
+    }
+
+    template <class S>
+    HSM_EVENT Call(HSM_EVENT event, void *param)
+    {
+        if constexpr (detail::HasHandler<Derived, S>::value)
+        {
+            return static_cast<Derived *>(this)->Handle(S{}, event, param);
+        }
+        else if constexpr (std::is_same<S, Root>::value)
+        {
+            // Unhandled event is dropped, as HSM_RootHandler()
+            return HSME_NULL;
+        }
+        else
+        {
+            return event;
+        }
+    }
+
+    template <class S>
+    void RunFrom(HSM_EVENT event, void *param)
+    {
+        event = Call<S>(event, param);
+        if constexpr (!std::is_same<S, Root>::value)
+        {
+            if (event)
+            {
+                RunFrom<typename S::parent>(event, param);
+            }
+        }
+    }
+
+    // Send HSME_EXIT from S up to, but excluding, Top
+    template <class S, class Top>
+    void Exit(void *param)
+    {
+        if constexpr (!std::is_same<S, Top>::value)
+        {
+            Call<S>(HSME_EXIT, param);
+            Exit<typename S::parent, Top>(param);
+        }
+    }
+
+    // Send HSME_ENTRY from below Top down to S
+    template <class Top, class S>
+    void Entry(void *param)
+    {
+        if constexpr (!std::is_same<S, Top>::value)
+        {
+            Entry<Top, typename S::parent>(param);
+            Call<S>(HSME_ENTRY, param);
+        }
+    }
+
+    std::size_t curState = 0;   // Index of the current state in States
+#if HSM_FEATURE_SAFETY_CHECK
+    bool hsmTran = false;       // Transition flag
+#endif // HSM_FEATURE_SAFETY_CHECK
+};
+
+} // namespace hsm
+
+#endif // __HSM_HPP__
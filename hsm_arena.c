@@ -0,0 +1,157 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string.h>
+#include "hsm_arena.h"
+
+#if HSM_FEATURE_ARENA
+// A param is allocated by bumping an offset, and all the params of a cycle are released at once by resetting the
+// offset, so allocating and freeing a param costs a few instructions instead of a malloc() and a free().  The
+// runs and dispatches in progress are counted, so the params posted by handlers stay valid until the outermost
+// call returns, and so are the events queued on the instances sharing the arena
+
+#ifndef HSM_ARENA_MALLOC
+#include <stdlib.h>
+#define HSM_ARENA_MALLOC(size)      malloc(size)
+#define HSM_ARENA_FREE(ptr)         free(ptr)
+#endif // HSM_ARENA_MALLOC
+
+#if HSM_ARENA_ALIGN & (HSM_ARENA_ALIGN - 1)
+#error "HSM_ARENA_ALIGN must be a power of 2"
+#endif // HSM_ARENA_ALIGN
+
+#define HSM_ARENA_ROUND(x)          (((x) + HSM_ARENA_ALIGN - 1) & ~(uintptr_t)(HSM_ARENA_ALIGN - 1))
+// The header of a param allocated outside of the arena keeps the param aligned
+#define HSM_ARENA_HEADER            HSM_ARENA_ROUND(sizeof(HSM_ARENA_BLOCK))
+
+void HSM_ARENA_Create(HSM_ARENA *This, void *mem, uint32_t size)
+{
+    uintptr_t skip = HSM_ARENA_ROUND((uintptr_t)mem) - (uintptr_t)mem;
+    This->base = (uint8_t *)mem + skip;
+    This->next = 0;
+    This->depth = 0;
+    This->queued = 0;
+    This->overflow = ((void *)0);
+    memset(&This->stats, 0, sizeof(This->stats));
+    This->stats.size = (size > skip) ? size - skip : 0;
+}
+
+void HSM_ARENA_Attach(HSM_ARENA *This, HSM *hsm)
+{
+    hsm->arena = This;
+#if HSM_FEATURE_QUEUE
+    This->queued += hsm->qCount;
+#endif // HSM_FEATURE_QUEUE
+}
+
+void *HSM_ParamAlloc(HSM *This, uint32_t size)
+{
+    HSM_ARENA *arena = This->arena;
+    HSM_ARENA_BLOCK *block;
+    uint32_t next;
+    if (((void *)0) == arena)
+    {
+        HSM_DEBUG("!!!!Illegal call of HSM_ParamAlloc for %s, no arena is attached!!!!", This->name);
+        return ((void *)0);
+    }
+    next = arena->next + HSM_ARENA_ROUND(size);
+    arena->stats.allocs++;
+    if (next <= arena->stats.size && next >= arena->next)
+    {
+        void *param = &arena->base[arena->next];
+        arena->next = next;
+        return param;
+    }
+    // Full, allocate outside of the arena until the reset
+    block = HSM_ARENA_MALLOC(HSM_ARENA_HEADER + size);
+    if (((void *)0) == block)
+    {
+        return ((void *)0);
+    }
+    arena->stats.overflows++;
+    block->next = arena->overflow;
+    arena->overflow = block;
+    return (uint8_t *)block + HSM_ARENA_HEADER;
+}
+
+void *HSM_ParamPromote(HSM *This, void *param, uint32_t size)
+{
+    void *copy = HSM_ARENA_MALLOC(size);
+    if (copy)
+    {
+        memcpy(copy, param, size);
+        if (This->arena)
+        {
+            This->arena->stats.promoted++;
+        }
+    }
+    return copy;
+}
+
+void HSM_ParamFree(void *param)
+{
+    HSM_ARENA_FREE(param);
+}
+
+void HSM_ARENA_End(HSM *hsm)
+{
+    HSM_ARENA *arena = hsm->arena;
+    HSM_ARENA_BLOCK *block;
+    if (--arena->depth)
+    {
+        return;
+    }
+    // Keep the params of the events posted to any instance of the arena but not dispatched yet.  The params of the
+    // deferred events are promoted, so they do not hold up the reset
+    if (arena->queued)
+    {
+        return;
+    }
+    if (arena->next > arena->stats.highWater)
+    {
+        arena->stats.highWater = arena->next;
+    }
+    arena->next = 0;
+    while (arena->overflow)
+    {
+        block = arena->overflow;
+        arena->overflow = block->next;
+        HSM_ARENA_FREE(block);
+    }
+    arena->stats.cycles++;
+}
+
+void HSM_ARENA_GetStats(HSM_ARENA *This, HSM_ARENA_STATS *stats, uint8_t reset)
+{
+    *stats = This->stats;
+    stats->used = This->next;
+    if (reset)
+    {
+        This->stats.highWater = This->next;
+        This->stats.overflows = 0;
+        This->stats.promoted = 0;
+    }
+}
+#endif // HSM_FEATURE_ARENA
@@ -0,0 +1,126 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __HSM_ARENA_H__
+#define __HSM_ARENA_H__
+
+#include "hsm.h"
+
+#if HSM_FEATURE_ARENA
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----Structure declaration----
+typedef struct HSM_ARENA_T HSM_ARENA;
+
+// Header of a param allocated outside of the arena because it was full
+typedef struct HSM_ARENA_BLOCK_T
+{
+    struct HSM_ARENA_BLOCK_T *next; // Next param allocated outside of the arena in the cycle
+} HSM_ARENA_BLOCK;
+
+typedef struct HSM_ARENA_STATS_T
+{
+    uint32_t size;              // Bytes of the arena
+    uint32_t used;              // Bytes allocated in the cycle in progress
+    uint32_t highWater;         // Most bytes allocated in a cycle
+    uint32_t overflows;         // Number of params allocated outside of the arena because it was full
+    uint32_t promoted;          // Number of params promoted with HSM_ParamPromote()
+    uint64_t allocs;            // Number of params allocated
+    uint64_t cycles;            // Number of cycles ended with a reset of the arena
+} HSM_ARENA_STATS;
+
+struct HSM_ARENA_T
+{
+    uint8_t *base;              // Memory of the arena, aligned to HSM_ARENA_ALIGN
+    uint32_t next;              // Offset of the next param
+    uint32_t depth;             // Runs and dispatches in progress on the instances of the arena
+    uint32_t queued;            // Events queued on the instances of the arena, whose params must outlive the cycle
+    HSM_ARENA_BLOCK *overflow;  // Params allocated outside of the arena in the cycle, freed on reset
+    HSM_ARENA_STATS stats;
+};
+
+//----Function Declarations----
+// Func: void HSM_ARENA_Create(HSM_ARENA *This, void *mem, uint32_t size)
+// Desc: Create an arena for the params of the events run by one thread.  The params allocated with
+//       HSM_ParamAlloc() are all released at once when the outermost HSM_Run() or HSM_Dispatch() of an instance of
+//       the arena returns, and no events are queued on any instance of the arena.  The params of deferred events
+//       must be promoted with HSM_ParamPromote()
+// This: Pointer to HSM_ARENA object
+// mem: Memory of the arena, kept by the arena
+// size: Size of the memory, e.g. the params of the events of a cycle
+void HSM_ARENA_Create(HSM_ARENA *This, void *mem, uint32_t size);
+
+// Func: void HSM_ARENA_Attach(HSM_ARENA *This, HSM *hsm)
+// Desc: Use the arena for the params of an HSM instance.  Call after HSM_Create() or HSM_Restore(), which reset
+//       the instance.  Instances sharing an arena must run on the same thread, and the arena is only reset once all
+//       their queues are drained
+// This: Pointer to HSM_ARENA object
+// hsm: Pointer to HSM instance
+void HSM_ARENA_Attach(HSM_ARENA *This, HSM *hsm);
+
+// Func: void *HSM_ParamAlloc(HSM *This, uint32_t size)
+// Desc: Allocate the param of an event for the HSM instance from its arena, e.g. before HSM_Run() or HSM_Post()
+//       or in a handler.  Params that do not fit in the arena are allocated with HSM_ARENA_MALLOC() until the reset
+// This: Pointer to HSM instance with an arena
+// size: Size of the param
+// return|void *: Pointer to the param, valid until the cycle ends.  NULL if the memory is exhausted
+void *HSM_ParamAlloc(HSM *This, uint32_t size);
+
+// Func: void *HSM_ParamPromote(HSM *This, void *param, uint32_t size)
+// Desc: Copy a param that must outlive the cycle, e.g. kept by a handler or deferred with HSM_Defer()
+// This: Pointer to HSM instance
+// param: Pointer to the param
+// size: Size of the param
+// return|void *: Pointer to the copy, freed with HSM_ParamFree().  NULL if the memory is exhausted
+void *HSM_ParamPromote(HSM *This, void *param, uint32_t size);
+
+// Func: void HSM_ParamFree(void *param)
+// Desc: Free a param promoted with HSM_ParamPromote()
+// param: Pointer to the promoted param
+void HSM_ParamFree(void *param);
+
+// Func: void HSM_ARENA_GetStats(HSM_ARENA *This, HSM_ARENA_STATS *stats, uint8_t reset)
+// Desc: Snapshot the usage of the arena
+// This: Pointer to HSM_ARENA object
+// stats: Pointer to the snapshot
+// reset: 1 - Restart the high-water mark and clear the overflow and promoted counts, 0 - leave them
+void HSM_ARENA_GetStats(HSM_ARENA *This, HSM_ARENA_STATS *stats, uint8_t reset);
+
+// Func: void HSM_ARENA_End(HSM *hsm)
+// Desc: End a run or dispatch of an HSM instance, resetting the arena when the cycle ends.  Called by HSM_Run()
+//       and HSM_Dispatch()
+// hsm: Pointer to HSM instance
+void HSM_ARENA_End(HSM *hsm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HSM_FEATURE_ARENA
+
+#endif // __HSM_ARENA_H__
@@ -0,0 +1,234 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "hsm_batch.h"
+
+#if HSM_FEATURE_BATCH
+void HSM_BATCH_Create(HSM_BATCH *This, const char *name, HSM_STATE *chart, uint16_t states, HSM_STATE *initState,
+                      HSM_BATCH_IDX *state, uint32_t count)
+{
+    uint32_t idx;
+    if (states > HSM_BATCH_MAX_STATES || initState < chart || initState >= chart + states)
+    {
+        HSM_DEBUG("Invalid HSM_BATCH chart of %d states", states);
+        // assert(0, "Invalid HSM_BATCH chart");
+        while(1);
+    }
+    This->chart = chart;
+    This->states = states;
+    This->state = state;
+    This->count = count;
+    for (idx = 0; idx < count; idx++)
+    {
+        This->current = idx;
+        HSM_Create(&This->hsm, name, initState);
+        state[idx] = (HSM_BATCH_IDX)(This->hsm.curState - chart);
+    }
+}
+
+#if HSM_FEATURE_STATS || HSM_FEATURE_RECORD || HSM_FEATURE_TRACE || HSM_FEATURE_ARENA
+// HSM_Run() adds the statistics, record, trace or arena hooks to each event
+#define HSM_BATCH_DIRECT    0
+#else
+#define HSM_BATCH_DIRECT    1
+#endif // HSM_FEATURE_STATS || HSM_FEATURE_RECORD || HSM_FEATURE_TRACE || HSM_FEATURE_ARENA
+
+#if HSM_FEATURE_HNDLR_STATE
+#define HSM_BATCH_HNDLR_STATE(hsm, st) { (hsm)->hndlrState = (st); }
+#else
+#define HSM_BATCH_HNDLR_STATE(hsm, st)
+#endif // HSM_FEATURE_HNDLR_STATE
+
+#if HSM_FEATURE_EVENT_FILTER
+// Tests whether the state declared that it does not handle the event
+#define HSM_BATCH_FILTERED(st, evt) \
+    ((st)->isFiltered && (evt) < HSM_EVENT_FILTER_SIZE && !((st)->events[(evt) / 32] & (1UL << ((evt) % 32))))
+#else
+#define HSM_BATCH_FILTERED(st, evt) 0
+#endif // HSM_FEATURE_EVENT_FILTER
+
+// Runs an event on an instance.  Unless HSM_Run() has hooks to call, the handler chain of the state is walked
+// directly and the state index is only stored back on a transition
+static inline void HSM_BATCH_RunOne(HSM_BATCH *This, HSM_STATE *state, uint32_t instance, HSM_EVENT event, void *param)
+{
+    HSM *hsm = &This->hsm;
+    HSM_STATE *link;
+    This->current = instance;
+    hsm->curState = state;
+#if HSM_BATCH_DIRECT
+#if HSM_FEATURE_DEBUG_ENABLE
+    if (0 == hsm->hsmDebugCfg)
+#endif // HSM_FEATURE_DEBUG_ENABLE
+    {
+        for (link = state; event; link = link->parent)
+        {
+            if (!HSM_BATCH_FILTERED(link, event))
+            {
+                HSM_BATCH_HNDLR_STATE(hsm, link);
+                event = link->handler(hsm, event, param);
+            }
+        }
+    }
+#if HSM_FEATURE_DEBUG_ENABLE
+    else
+#endif // HSM_FEATURE_DEBUG_ENABLE
+#endif // HSM_BATCH_DIRECT
+#if !HSM_BATCH_DIRECT || HSM_FEATURE_DEBUG_ENABLE
+    {
+        (void)link;
+        HSM_Run(hsm, event, param);
+    }
+#endif // !HSM_BATCH_DIRECT || HSM_FEATURE_DEBUG_ENABLE
+    if (hsm->curState != state)
+    {
+        This->state[instance] = (HSM_BATCH_IDX)(hsm->curState - This->chart);
+    }
+}
+
+// Runs an event on the n instances in list, or on instances 0 to n - 1 if there is no list.  The state is read again
+// for each instance, since an instance may be listed twice
+static void HSM_BATCH_RunGroup(HSM_BATCH *This, const uint32_t *list, uint32_t n, HSM_EVENT event, void *param)
+{
+    uint32_t instance;
+    uint32_t idx;
+    if (((void *)0) == list)
+    {
+        for (instance = 0; instance < n; instance++)
+        {
+            HSM_BATCH_RunOne(This, &This->chart[This->state[instance]], instance, event, param);
+        }
+        return;
+    }
+    for (idx = 0; idx < n; idx++)
+    {
+        instance = list[idx];
+        HSM_BATCH_RunOne(This, &This->chart[This->state[instance]], instance, event, param);
+    }
+}
+
+// Runs the event of each instance as HSM_BATCH_RunGroup(), skipping the instances without event
+static void HSM_BATCH_RunGroupEvents(HSM_BATCH *This, const uint32_t *list, uint32_t n,
+                                     const HSM_EVENT *events, void * const *params)
+{
+    uint32_t instance;
+    uint32_t idx;
+    for (idx = 0; idx < n; idx++)
+    {
+        instance = list ? list[idx] : idx;
+        if (events[instance])
+        {
+            HSM_BATCH_RunOne(This, &This->chart[This->state[instance]], instance, events[instance],
+                             params ? params[instance] : ((void *)0));
+        }
+    }
+}
+
+#if HSM_BATCH_BLOCK
+// Counting sort of a block of instances by current state into order[].  Returns the number of instances sorted
+static uint32_t HSM_BATCH_Group(HSM_BATCH *This, const uint32_t *list, uint32_t base, uint32_t n,
+                                const HSM_EVENT *events, uint32_t *order)
+{
+    uint32_t bucket[HSM_BATCH_MAX_STATES + 1];
+    uint32_t total = 0;
+    uint32_t idx;
+    uint32_t instance;
+    uint16_t st;
+
+    for (st = 0; st <= This->states; st++)
+    {
+        bucket[st] = 0;
+    }
+    for (idx = 0; idx < n; idx++)
+    {
+        instance = list ? list[base + idx] : base + idx;
+        if (!events || events[instance])
+        {
+            bucket[This->state[instance] + 1]++;
+            total++;
+        }
+    }
+    for (st = 1; st <= This->states; st++)
+    {
+        bucket[st] += bucket[st - 1];
+    }
+    for (idx = 0; idx < n; idx++)
+    {
+        instance = list ? list[base + idx] : base + idx;
+        if (!events || events[instance])
+        {
+            order[bucket[This->state[instance]]++] = instance;
+        }
+    }
+    return total;
+}
+#endif // HSM_BATCH_BLOCK
+
+// Runs the instances in list, or all instances if there is no list.  With HSM_BATCH_BLOCK, each block of instances
+// is sorted by state first, so the handlers of a state run back to back while the instance data is still visited
+// roughly in order
+static void HSM_BATCH_RunAll(HSM_BATCH *This, const uint32_t *list, uint32_t n,
+                             HSM_EVENT event, const HSM_EVENT *events, void *param, void * const *params)
+{
+#if HSM_BATCH_BLOCK
+    uint32_t order[HSM_BATCH_BLOCK];
+    uint32_t base;
+    uint32_t len;
+    uint32_t cnt;
+
+    for (base = 0; base < n; base += len)
+    {
+        len = (n - base < HSM_BATCH_BLOCK) ? n - base : HSM_BATCH_BLOCK;
+        cnt = HSM_BATCH_Group(This, list, base, len, events, order);
+        if (events)
+        {
+            HSM_BATCH_RunGroupEvents(This, order, cnt, events, params);
+        }
+        else
+        {
+            HSM_BATCH_RunGroup(This, order, cnt, event, param);
+        }
+    }
+#else
+    if (events)
+    {
+        HSM_BATCH_RunGroupEvents(This, list, n, events, params);
+    }
+    else
+    {
+        HSM_BATCH_RunGroup(This, list, n, event, param);
+    }
+#endif // HSM_BATCH_BLOCK
+}
+
+void HSM_RunBatch(HSM_BATCH *This, HSM_EVENT event, void *param, const uint32_t *instances, uint32_t n)
+{
+    HSM_BATCH_RunAll(This, instances, instances ? n : This->count, event, ((void *)0), param, ((void *)0));
+}
+
+void HSM_RunBatchEvents(HSM_BATCH *This, const HSM_EVENT *events, void * const *params)
+{
+    HSM_BATCH_RunAll(This, ((void *)0), This->count, HSME_NULL, events, ((void *)0), params);
+}
+#endif // HSM_FEATURE_BATCH
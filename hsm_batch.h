@@ -0,0 +1,90 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef __HSM_BATCH_H__
+#define __HSM_BATCH_H__
+
+#include "hsm.h"
+
+#if HSM_FEATURE_BATCH
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----Structure declaration----
+// A batch of instances sharing one chart.  The chart is a contiguous array of HSM_STATE so each instance
+// only stores the index of its current state.  The state handlers run on a single HSM context whose
+// curState is set from the index array before each event, and stored back after a transition
+typedef struct HSM_BATCH_T
+{
+    HSM hsm;                    // HSM context passed to the state handlers
+    HSM_STATE *chart;           // Contiguous array of the chart's states
+    uint16_t states;            // Number of states in the chart
+    HSM_BATCH_IDX *state;       // Current state index of each instance
+    uint32_t count;             // Number of instances
+    uint32_t current;           // Index of the instance being run
+} HSM_BATCH;
+
+//----Function Declarations----
+// Func: void HSM_BATCH_Create(HSM_BATCH *This, const char *name, HSM_STATE *chart, uint16_t states, HSM_STATE *initState,
+//                             HSM_BATCH_IDX *state, uint32_t count)
+// Desc: Create count instances of a chart, sending HSME_ENTRY and HSME_INIT to each as HSM_Create()
+// This: Pointer to HSM_BATCH object
+// name: Name of the batch (for debugging)
+// chart: Contiguous array of states, already created with HSM_STATE_Create()
+// states: Number of states in chart, up to HSM_BATCH_MAX_STATES
+// initState: Initial state, must be in chart
+// state: Array of count state indexes, one per instance
+// count: Number of instances
+void HSM_BATCH_Create(HSM_BATCH *This, const char *name, HSM_STATE *chart, uint16_t states, HSM_STATE *initState,
+                      HSM_BATCH_IDX *state, uint32_t count);
+
+// Use this macro in a state handler to get the index of the instance being run, to find the instance's data.
+// The HSM context passed to the state handlers is the first member of HSM_BATCH
+#define HSM_BATCH_Current(hsm) (((HSM_BATCH *)(hsm))->current)
+
+// Func: void HSM_RunBatch(HSM_BATCH *This, HSM_EVENT event, void *param, const uint32_t *instances, uint32_t n)
+// Desc: Run the same event on many instances, in order or sorted by state in blocks of HSM_BATCH_BLOCK
+// This: Pointer to HSM_BATCH object
+// event: HSM_EVENT processed by each instance
+// param: Parameter associated with HSM_EVENT
+// instances: Array of n instance indexes, or NULL to run all instances
+// n: Number of instances in the instances array (ignored if instances is NULL)
+void HSM_RunBatch(HSM_BATCH *This, HSM_EVENT event, void *param, const uint32_t *instances, uint32_t n);
+
+// Func: void HSM_RunBatchEvents(HSM_BATCH *This, const HSM_EVENT *events, void * const *params)
+// Desc: Run one event per instance, in order or sorted by state in blocks of HSM_BATCH_BLOCK
+// This: Pointer to HSM_BATCH object
+// events: Array of count events, HSME_NULL skips the instance
+// params: Array of count parameters, or NULL if the events have no parameters
+void HSM_RunBatchEvents(HSM_BATCH *This, const HSM_EVENT *events, void * const *params);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HSM_FEATURE_BATCH
+
+#endif // __HSM_BATCH_H__
@@ -0,0 +1,111 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "hsm_chart.h"
+
+#if HSM_FEATURE_CHART
+// Level of a validated state
+static uint16_t HSM_CHART_Level(const HSM_CHART_DEF *defs, uint16_t id)
+{
+    uint16_t level = 1;
+    for (id = defs[id].parent; id != HSM_CHART_NO_PARENT; id = defs[id].parent)
+    {
+        level++;
+    }
+    return level;
+}
+
+uint8_t HSM_CHART_Freeze(HSM_CHART *This, const HSM_CHART_DEF *defs, uint16_t count, HSM_STATE *states)
+{
+    uint16_t id;
+    uint16_t parent;
+    uint16_t level;
+    uint8_t maxDepth = 0;
+    uint32_t hash = 2166136261UL;
+    const char *name;
+
+    This->states = states;
+    This->count = 0;
+    This->maxDepth = 0;
+    This->id = 0;
+    // 1) Validate every state and compute its level by walking up its parents
+    for (id = 0; id < count; id++)
+    {
+        This->error = id;
+        if (((void *)0) == defs[id].handler)
+        {
+            HSM_DEBUG("HSM_CHART state %d[%s] has no handler", id, defs[id].name);
+            return HSM_CHART_ERR_HANDLER;
+        }
+        level = 1;
+        for (parent = defs[id].parent; parent != HSM_CHART_NO_PARENT; parent = defs[parent].parent)
+        {
+            if (parent >= count)
+            {
+                HSM_DEBUG("HSM_CHART state %d[%s] has invalid parent %d", id, defs[id].name, parent);
+                return HSM_CHART_ERR_PARENT;
+            }
+            if (++level > count)
+            {
+                HSM_DEBUG("HSM_CHART state %d[%s] is its own ancestor", id, defs[id].name);
+                return HSM_CHART_ERR_CYCLE;
+            }
+        }
+        if (level >= HSM_MAX_DEPTH)
+        {
+            HSM_DEBUG("HSM_CHART state %d[%s] needs HSM_MAX_DEPTH > %d", id, defs[id].name, level);
+            return HSM_CHART_ERR_DEPTH;
+        }
+        if (level > maxDepth)
+        {
+            maxDepth = (uint8_t)level;
+        }
+        // FNV-1a of the name and parent ID
+        for (name = defs[id].name; name && *name; name++)
+        {
+            hash = (hash ^ (uint8_t)*name) * 16777619UL;
+        }
+        hash = (hash ^ (defs[id].parent & 0xFF)) * 16777619UL;
+        hash = (hash ^ (defs[id].parent >> 8)) * 16777619UL;
+    }
+    // 2) Create the states level by level, so each parent exists before its children
+    for (level = 1; level <= maxDepth; level++)
+    {
+        for (id = 0; id < count; id++)
+        {
+            parent = defs[id].parent;
+            if (HSM_CHART_Level(defs, id) == level)
+            {
+                HSM_STATE_Create(&states[id], defs[id].name, defs[id].handler,
+                                 (parent == HSM_CHART_NO_PARENT) ? ((void *)0) : &states[parent]);
+            }
+        }
+    }
+    This->count = count;
+    This->maxDepth = maxDepth;
+    This->id = hash;
+    return HSM_CHART_OK;
+}
+#endif // HSM_FEATURE_CHART
@@ -0,0 +1,88 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef __HSM_CHART_H__
+#define __HSM_CHART_H__
+
+#include "hsm.h"
+
+#if HSM_FEATURE_CHART
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----Chart definitions----
+// Parent ID of a top level state
+#define HSM_CHART_NO_PARENT     0xFFFF
+// Results of HSM_CHART_Freeze()
+#define HSM_CHART_OK            0
+#define HSM_CHART_ERR_HANDLER   1   // State has no handler
+#define HSM_CHART_ERR_PARENT    2   // Parent ID is not a state of the chart
+#define HSM_CHART_ERR_CYCLE     3   // State is its own ancestor
+#define HSM_CHART_ERR_DEPTH     4   // Chart is deeper than HSM_MAX_DEPTH allows
+
+//----Structure declaration----
+// Definition of a state.  The ID of the state is its index in the definition table
+typedef struct HSM_CHART_DEF_T
+{
+    const char *name;           // name of state
+    HSM_FN handler;             // associated event handler for state
+    uint16_t parent;            // ID of the parent state, or HSM_CHART_NO_PARENT
+} HSM_CHART_DEF;
+
+typedef struct HSM_CHART_T
+{
+    HSM_STATE *states;          // Contiguous array of states, indexed by ID
+    uint16_t count;             // Number of states
+    uint8_t maxDepth;           // Level of the deepest state
+    uint32_t id;                // Fingerprint of the state names and hierarchy, e.g. to check a snapshot
+    uint16_t error;             // ID of the state that failed validation
+} HSM_CHART;
+
+// Use this macro to get the HSM_STATE of a state ID
+#define HSM_CHART_STATE(chart, id)      (&(chart)->states[(id)])
+// Use this macro to get the state ID of an HSM_STATE of the chart
+#define HSM_CHART_ID(chart, state)      ((uint16_t)((state) - (chart)->states))
+
+//----Function Declarations----
+// Func: uint8_t HSM_CHART_Freeze(HSM_CHART *This, const HSM_CHART_DEF *defs, uint16_t count, HSM_STATE *states)
+// Desc: Validate the state definitions and create the states contiguously in states[], so each state can be
+//       referred to by its ID.  Nothing is created if validation fails.  The chart ID is computed from the
+//       state names and parents.  The states are created with HSM_STATE_Create(), so they are linked by pointer
+//       and the instances still hold a pointer to their current state
+// This: Pointer to HSM_CHART object
+// defs: Table of count state definitions
+// count: Number of states, up to HSM_CHART_NO_PARENT
+// states: Array of count HSM_STATE objects owned by the chart
+// return|uint8_t: HSM_CHART_OK, or HSM_CHART_ERR_* with This->error set to the ID of the offending state
+uint8_t HSM_CHART_Freeze(HSM_CHART *This, const HSM_CHART_DEF *defs, uint16_t count, HSM_STATE *states);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HSM_FEATURE_CHART
+
+#endif // __HSM_CHART_H__
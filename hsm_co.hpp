@@ -0,0 +1,339 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef __HSM_CO_HPP__
+#define __HSM_CO_HPP__
+
+// Header-only C++20 coroutine adapter over the C API (hsm.h) for state actions that wait on I/O.  A state
+// handler starts an hsm::co::Action coroutine with Actor::Spawn() and returns at once.  The action runs until
+// it co_awaits an hsm::co::Completion, and the actor is then busy:
+//   1) Actor::Post() queues the events for the actor instead of running them
+//   2) Completion::Complete() may be called by any thread, e.g. an I/O callback, and hands the action to the
+//      dispatcher
+//   3) Dispatcher::Poll() resumes the action on the dispatcher's thread, outside of HSM_Run(), so it may call
+//      HSM_Tran()
+//   4) When the last action of the actor returns, the queued events are run in order
+// So one thread drives many machines waiting on I/O at once, without blocking in HSM_Run() and without
+// intermediate states that only wait for the completion event.  For example:
+//     struct CAMERA { HSM parent; hsm::co::Actor actor; hsm::co::Completion lens; };
+//     hsm::co::Action CAMERA_OpenLens(CAMERA *This)
+//     {
+//         LENS_Open(&This->lens);              // Calls This->lens.Complete(result) when the lens is open
+//         if (co_await This->lens < 0)
+//         {
+//             HSM_Tran((HSM *)This, &CAMERA_StateError, 0, 0);
+//         }
+//     }
+//     HSM_EVENT CAMERA_StateOnHndlr(HSM *This, HSM_EVENT event, void *param)
+//     {
+//         if (event == HSME_ENTRY)
+//         {
+//             ((CAMERA *)This)->actor.Spawn(CAMERA_OpenLens((CAMERA *)This));
+//         }
+//         ...
+//     }
+// Every Completion awaited must be completed once, and the HSM instance must outlive its actions.
+
+#include "hsm.h"
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+#include <vector>
+
+namespace hsm
+{
+namespace co
+{
+
+class Actor;
+class Dispatcher;
+
+// Return type of a coroutine started by Actor::Spawn().  It runs on the caller's thread until it co_awaits a
+// pending Completion, and is then resumed by the actor's dispatcher
+class Action
+{
+public:
+    struct promise_type
+    {
+        Actor *actor = nullptr; // Set by Actor::Spawn()
+
+        Action get_return_object(void)
+        {
+            return Action(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        // Started by Spawn() once the actor is known to Complete()
+        std::suspend_always initial_suspend(void) noexcept
+        {
+            return {};
+        }
+        // Stay suspended at the end, so Spawn() and the dispatcher see done() and release the actor
+        std::suspend_always final_suspend(void) noexcept
+        {
+            return {};
+        }
+        void return_void(void)
+        {
+        }
+        // State handlers are C functions, so an exception cannot be reported to HSM_Run()
+        void unhandled_exception(void)
+        {
+            std::terminate();
+        }
+    };
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Action(Action &&other) noexcept : handle(std::exchange(other.handle, nullptr))
+    {
+    }
+    Action(const Action &) = delete;
+    Action &operator=(const Action &) = delete;
+    // An action that was never spawned is destroyed with its object
+    ~Action()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+private:
+    friend class Actor;
+    explicit Action(Handle h) : handle(h)
+    {
+    }
+    Handle handle;
+};
+
+// Runs the actions that were completed by other threads.  One dispatcher drives any number of actors, and
+// all the actors' events and actions run on the thread calling Poll()
+class Dispatcher
+{
+public:
+    // Resume the completed actions and run the events queued for actors that are no longer busy.  Returns
+    // the number of actions resumed
+    std::size_t Poll(void);
+
+    // Block until an action is completed or Stop() is called.  A Stop() wakes up a single Wait(), so the
+    // dispatcher can wait again
+    void Wait(void)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this] { return !ready.empty() || stopped; });
+        stopped = false;
+    }
+
+    // Wake up Wait() without a completed action, or the next Wait() if none is blocked
+    void Stop(void)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+        cond.notify_one();
+    }
+
+private:
+    friend class Completion;
+    // Called by Completion::Complete() from any thread
+    void Ready(Action::Handle h)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.push_back(h);
+        cond.notify_one();
+    }
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<Action::Handle> ready;  // Actions to resume, guarded by mutex
+    std::vector<Action::Handle> batch;  // Actions being resumed by Poll()
+    bool stopped = false;
+};
+
+// Binds an HSM instance to a dispatcher.  All the calls must be made on the dispatcher's thread
+class Actor
+{
+public:
+    Actor(HSM *hsm, Dispatcher &dispatcher) : hsm(hsm), dispatcher(&dispatcher)
+    {
+    }
+    Actor(const Actor &) = delete;
+    Actor &operator=(const Actor &) = delete;
+
+    // Run the event now if the actor is idle, as HSM_Run(), otherwise queue it until its actions return.
+    // Returns true when the event was run
+    bool Post(HSM_EVENT event, void *param = nullptr)
+    {
+        if (pending || !queue.empty())
+        {
+            queue.emplace_back(event, param);
+            return false;
+        }
+        HSM_Run(hsm, event, param);
+        return true;
+    }
+
+    // Start an action from a state handler.  The actor is busy until the action returns
+    void Spawn(Action &&action)
+    {
+        Action::Handle h = std::exchange(action.handle, nullptr);
+        h.promise().actor = this;
+        h.resume();
+        if (h.done())
+        {
+            // Completed without waiting
+            h.destroy();
+            return;
+        }
+        pending++;
+    }
+
+    // Tests whether an action of the actor is waiting
+    bool IsBusy(void) const
+    {
+        return pending != 0;
+    }
+
+    // Number of events queued while busy
+    std::size_t Queued(void) const
+    {
+        return queue.size();
+    }
+
+    HSM *Get(void) const
+    {
+        return hsm;
+    }
+
+    Dispatcher &GetDispatcher(void) const
+    {
+        return *dispatcher;
+    }
+
+private:
+    friend class Dispatcher;
+    // Called by the dispatcher when an action returns
+    void Done(void)
+    {
+        pending--;
+        // Stop as soon as an event spawns another action
+        while (!pending && !queue.empty())
+        {
+            std::pair<HSM_EVENT, void *> evt = queue.front();
+            queue.pop_front();
+            HSM_Run(hsm, evt.first, evt.second);
+        }
+    }
+
+    HSM *hsm;
+    Dispatcher *dispatcher;
+    std::deque<std::pair<HSM_EVENT, void *>> queue; // Events posted while busy
+    unsigned pending = 0;                           // Number of actions waiting
+};
+
+// One-shot I/O completion awaited by an action.  co_await returns the result passed to Complete(), which
+// may be called by any thread before or after the action waits.  The action is resumed by Dispatcher::Poll()
+// in both cases.  Reset() makes it reusable once the await has returned
+class Completion
+{
+public:
+    Completion(void) = default;
+    Completion(const Completion &) = delete;
+    Completion &operator=(const Completion &) = delete;
+
+    // Signal the completion with the I/O result
+    void Complete(intptr_t value)
+    {
+        result = value;
+        if (state.exchange(DONE, std::memory_order_acq_rel) == WAITING)
+        {
+            waiter.promise().actor->GetDispatcher().Ready(waiter);
+        }
+    }
+
+    void Reset(void)
+    {
+        state.store(IDLE, std::memory_order_relaxed);
+    }
+
+    // Always suspend, so the action continues on the dispatcher, outside of HSM_Run() and HSM_Tran()
+    bool await_ready(void) const noexcept
+    {
+        return false;
+    }
+    void await_suspend(Action::Handle h) noexcept
+    {
+        waiter = h;
+        int expected = IDLE;
+        if (!state.compare_exchange_strong(expected, WAITING, std::memory_order_acq_rel))
+        {
+            // Complete() was called before the action waits
+            h.promise().actor->GetDispatcher().Ready(h);
+        }
+    }
+    intptr_t await_resume(void) const noexcept
+    {
+        return result;
+    }
+
+private:
+    enum
+    {
+        IDLE,
+        WAITING,
+        DONE
+    };
+    std::atomic<int> state{IDLE};
+    Action::Handle waiter;
+    intptr_t result = 0;
+};
+
+inline std::size_t Dispatcher::Poll(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        batch.swap(ready);
+    }
+    std::size_t count = batch.size();
+    for (Action::Handle h : batch)
+    {
+        h.resume();
+        if (h.done())
+        {
+            Actor *actor = h.promise().actor;
+            h.destroy();
+            actor->Done();
+        }
+    }
+    batch.clear();
+    return count;
+}
+
+} // namespace co
+} // namespace hsm
+
+#endif // __HSM_CO_HPP__
@@ -0,0 +1,128 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "hsm_mbox.h"
+
+#if HSM_FEATURE_MBOX
+#if HSM_MBOX_DEPTH & (HSM_MBOX_DEPTH - 1)
+#error "HSM_MBOX_DEPTH must be a power of 2"
+#endif // HSM_MBOX_DEPTH
+
+// Bounded multi-producer/single-consumer ring.  Each slot carries a sequence number:
+//   seq == pos                 : slot is free for the producer claiming position pos
+//   seq == pos + 1             : slot holds the event posted at position pos
+//   seq == pos + HSM_MBOX_DEPTH: slot was consumed and is free for the next lap
+void HSM_MBOX_Create(HSM_MBOX *This, HSM *hsm)
+{
+    uintptr_t idx;
+    This->hsm = hsm;
+    for (idx = 0; idx < HSM_MBOX_DEPTH; idx++)
+    {
+        atomic_init(&This->slot[idx].seq, idx);
+    }
+    atomic_init(&This->tail, 0);
+    This->head = 0;
+}
+
+uint8_t HSM_MBOX_Post(HSM_MBOX *This, HSM_EVENT event, void *param)
+{
+    HSM_MBOX_SLOT *slot;
+    uintptr_t pos = atomic_load_explicit(&This->tail, memory_order_relaxed);
+    intptr_t diff;
+    for (;;)
+    {
+        slot = &This->slot[pos & (HSM_MBOX_DEPTH - 1)];
+        diff = (intptr_t)atomic_load_explicit(&slot->seq, memory_order_acquire) - (intptr_t)pos;
+        if (diff == 0)
+        {
+            // Slot is free, try to claim the position
+            if (atomic_compare_exchange_weak_explicit(&This->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // Consumer has not freed the slot from the previous lap, mailbox is full
+            return 0;
+        }
+        else
+        {
+            // Another producer claimed the position, reload
+            pos = atomic_load_explicit(&This->tail, memory_order_relaxed);
+        }
+    }
+    slot->event = event;
+    slot->param = param;
+    // Publish the event to the consumer
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    return 1;
+}
+
+uint32_t HSM_MBOX_Dispatch(HSM_MBOX *This)
+{
+    uint32_t cnt = 0;
+    uint16_t batch;
+    // Drain in batches so the count cannot wrap while producers keep posting
+    do
+    {
+        batch = HSM_MBOX_DispatchMax(This, HSM_MBOX_DEPTH);
+        cnt += batch;
+    } while (batch && cnt <= 0xFFFFFFFFUL - HSM_MBOX_DEPTH);
+    return cnt;
+}
+
+uint16_t HSM_MBOX_DispatchMax(HSM_MBOX *This, uint16_t max)
+{
+    HSM_MBOX_SLOT *slot;
+    HSM_EVENT event;
+    void *param;
+    uint16_t cnt = 0;
+    while (cnt < max)
+    {
+        slot = &This->slot[This->head & (HSM_MBOX_DEPTH - 1)];
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != This->head + 1)
+        {
+            // Empty, or the producer of the next position has not published yet
+            break;
+        }
+        event = slot->event;
+        param = slot->param;
+        // Free the slot for the next lap before running, so producers are not held up by the handler
+        atomic_store_explicit(&slot->seq, This->head + HSM_MBOX_DEPTH, memory_order_release);
+        This->head++;
+        HSM_Run(This->hsm, event, param);
+        cnt++;
+    }
+    return cnt;
+}
+
+uint8_t HSM_MBOX_IsEmpty(HSM_MBOX *This)
+{
+    HSM_MBOX_SLOT *slot = &This->slot[This->head & (HSM_MBOX_DEPTH - 1)];
+    return atomic_load_explicit(&slot->seq, memory_order_acquire) != This->head + 1;
+}
+#endif // HSM_FEATURE_MBOX
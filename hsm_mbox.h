@@ -0,0 +1,95 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef __HSM_MBOX_H__
+#define __HSM_MBOX_H__
+
+#include "hsm.h"
+
+#if HSM_FEATURE_MBOX
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----Structure declaration----
+typedef struct HSM_MBOX_SLOT_T
+{
+    atomic_uintptr_t seq;       // Sequence number that tells producers and consumer who owns the slot
+    HSM_EVENT event;            // Posted event
+    void *param;                // Parameter associated with the posted event
+} HSM_MBOX_SLOT;
+
+typedef struct HSM_MBOX_T
+{
+    HSM *hsm;                   // HSM instance the events are run on
+    HSM_MBOX_SLOT slot[HSM_MBOX_DEPTH];
+    _Alignas(HSM_CACHE_LINE) atomic_uintptr_t tail; // Next position claimed by a producer
+    _Alignas(HSM_CACHE_LINE) uintptr_t head;        // Next position read by the consumer
+} HSM_MBOX;
+
+//----Function Declarations----
+// Func: void HSM_MBOX_Create(HSM_MBOX *This, HSM *hsm)
+// Desc: Create a mailbox that feeds events to an HSM instance
+// This: Pointer to HSM_MBOX object
+// hsm: Pointer to HSM instance that runs the posted events
+void HSM_MBOX_Create(HSM_MBOX *This, HSM *hsm);
+
+// Func: uint8_t HSM_MBOX_Post(HSM_MBOX *This, HSM_EVENT event, void *param)
+// Desc: Post an event to the mailbox.  Lock-free and safe to call from any number of threads.
+//       Events posted by one thread are run in the order they were posted
+// This: Pointer to HSM_MBOX object
+// event: HSM_EVENT to be run by HSM_MBOX_Dispatch()
+// param: Parameter associated with HSM_EVENT
+// return|uint8_t: 1 - event is posted, 0 - mailbox is full, event is not posted and may be retried
+uint8_t HSM_MBOX_Post(HSM_MBOX *This, HSM_EVENT event, void *param);
+
+// Func: uint32_t HSM_MBOX_Dispatch(HSM_MBOX *This)
+// Desc: Run posted events on the HSM until the mailbox is empty or 0xFFFFFFFF - HSM_MBOX_DEPTH events are dispatched.
+//       Must only be called by a single consumer thread
+// This: Pointer to HSM_MBOX object
+// return|uint32_t: Number of events dispatched
+uint32_t HSM_MBOX_Dispatch(HSM_MBOX *This);
+
+// Func: uint16_t HSM_MBOX_DispatchMax(HSM_MBOX *This, uint16_t max)
+// Desc: Run up to max posted events on the HSM.  Must only be called by a single consumer thread
+// This: Pointer to HSM_MBOX object
+// max: Maximum number of events to dispatch
+// return|uint16_t: Number of events dispatched
+uint16_t HSM_MBOX_DispatchMax(HSM_MBOX *This, uint16_t max);
+
+// Func: uint8_t HSM_MBOX_IsEmpty(HSM_MBOX *This)
+// Desc: Tests whether the consumer has a posted event to dispatch.  Must only be called by the consumer thread
+// This: Pointer to HSM_MBOX object
+// return|uint8_t: 1 - no event is ready to dispatch, 0 - otherwise
+uint8_t HSM_MBOX_IsEmpty(HSM_MBOX *This);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HSM_FEATURE_MBOX
+
+#endif // __HSM_MBOX_H__
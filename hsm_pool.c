@@ -0,0 +1,222 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string.h>
+#include "hsm_pool.h"
+
+#if HSM_FEATURE_POOL
+// Instances are carved from cache line aligned slabs.  A freed instance goes on a free list linked through
+// the instance itself, and an instance never used yet is taken from the newest slab by bumping a pointer, so
+// allocating and freeing are O(1) and a new slab needs no initialization
+
+#ifndef HSM_POOL_SLAB_ALLOC
+#include <stdlib.h>
+#define HSM_POOL_SLAB_ALLOC(size)   aligned_alloc(HSM_POOL_ALIGN, (size))
+#ifndef HSM_POOL_SLAB_FREE
+#define HSM_POOL_SLAB_FREE(ptr)     free(ptr)
+#endif // HSM_POOL_SLAB_FREE
+#endif // HSM_POOL_SLAB_ALLOC
+#ifndef HSM_POOL_SLAB_FREE
+// The slabs of a custom HSM_POOL_SLAB_ALLOC(size) are not freed unless HSM_POOL_SLAB_FREE(ptr) is defined too
+#define HSM_POOL_SLAB_FREE(ptr)     ((void)(ptr))
+#endif // HSM_POOL_SLAB_FREE
+
+#if HSM_POOL_ALIGN & (HSM_POOL_ALIGN - 1)
+#error "HSM_POOL_ALIGN must be a power of 2"
+#endif // HSM_POOL_ALIGN
+
+#define HSM_POOL_ROUND(x)           (((x) + HSM_POOL_ALIGN - 1) & ~(uintptr_t)(HSM_POOL_ALIGN - 1))
+// The slab header takes a whole line, so the instances are aligned too
+#define HSM_POOL_HEADER             HSM_POOL_ROUND(sizeof(HSM_POOL_SLAB))
+#define HSM_POOL_FREE_MAGIC         0x464D5348  // "HSMF" in little endian
+
+void HSM_POOL_Create(HSM_POOL *This, uint32_t size, uint32_t limit)
+{
+    if (size < sizeof(HSM_POOL_FREE))
+    {
+        size = sizeof(HSM_POOL_FREE);
+    }
+    This->free = ((void *)0);
+    This->next = ((void *)0);
+    This->end = ((void *)0);
+    This->slabs = ((void *)0);
+    This->limit = limit;
+    memset(&This->stats, 0, sizeof(This->stats));
+    This->stats.size = HSM_POOL_ROUND(size);
+}
+
+void HSM_POOL_Destroy(HSM_POOL *This)
+{
+    HSM_POOL_SLAB *slab;
+    HSM_POOL_LOCK();
+    while (This->slabs)
+    {
+        slab = This->slabs;
+        This->slabs = slab->next;
+        if (slab->owned)
+        {
+            HSM_POOL_SLAB_FREE(slab);
+        }
+    }
+    This->free = ((void *)0);
+    This->next = ((void *)0);
+    This->end = ((void *)0);
+    This->stats.slabs = 0;
+    This->stats.capacity = 0;
+    HSM_POOL_UNLOCK();
+}
+
+// Makes an aligned slab the newest one, the instances left in the previous one go on the free list
+static uint32_t HSM_POOL_Link(HSM_POOL *This, uint8_t *mem, uint32_t bytes, uint8_t owned)
+{
+    HSM_POOL_SLAB *slab = (HSM_POOL_SLAB *)mem;
+    HSM_POOL_FREE *obj;
+    uint32_t count = (bytes - HSM_POOL_HEADER) / This->stats.size;
+    while (This->next && This->next + This->stats.size <= This->end)
+    {
+        obj = (HSM_POOL_FREE *)This->next;
+        obj->next = This->free;
+        This->free = obj;
+        This->next += This->stats.size;
+    }
+    slab->next = This->slabs;
+    slab->owned = owned;
+    This->slabs = slab;
+    This->next = mem + HSM_POOL_HEADER;
+    This->end = This->next + count * This->stats.size;
+    This->stats.slabs++;
+    This->stats.capacity += count;
+    return count;
+}
+
+uint32_t HSM_POOL_AddSlab(HSM_POOL *This, void *mem, uint32_t bytes)
+{
+    uint32_t count;
+    uintptr_t skip = HSM_POOL_ROUND((uintptr_t)mem) - (uintptr_t)mem;
+    if (bytes < skip + HSM_POOL_HEADER + This->stats.size)
+    {
+        return 0;
+    }
+    HSM_POOL_LOCK();
+    count = HSM_POOL_Link(This, (uint8_t *)mem + skip, bytes - skip, 0);
+    HSM_POOL_UNLOCK();
+    return count;
+}
+
+void *HSM_POOL_Get(HSM_POOL *This)
+{
+    void *obj;
+    uint32_t bytes;
+    uint8_t *mem;
+    HSM_POOL_LOCK();
+    if (This->limit && This->stats.used >= This->limit)
+    {
+        This->stats.failed++;
+        HSM_POOL_UNLOCK();
+        return ((void *)0);
+    }
+    if (This->free)
+    {
+        obj = This->free;
+        This->free = This->free->next;
+    }
+    else
+    {
+        if (This->next + This->stats.size > This->end)
+        {
+            // Allocate a slab for at least one instance
+            bytes = HSM_POOL_HEADER + This->stats.size;
+            bytes = bytes < HSM_POOL_SLAB_SIZE ? HSM_POOL_ROUND(HSM_POOL_SLAB_SIZE) : bytes;
+            mem = HSM_POOL_SLAB_ALLOC(bytes);
+            if (((void *)0) == mem)
+            {
+                This->stats.failed++;
+                HSM_POOL_UNLOCK();
+                HSM_DEBUG("Pool of %lu byte instances is exhausted", (unsigned long)This->stats.size);
+                return ((void *)0);
+            }
+            HSM_POOL_Link(This, mem, bytes, 1);
+        }
+        obj = This->next;
+        This->next += This->stats.size;
+    }
+    if (++This->stats.used > This->stats.highWater)
+    {
+        This->stats.highWater = This->stats.used;
+    }
+    This->stats.allocs++;
+    HSM_POOL_UNLOCK();
+    memset(obj, 0, This->stats.size);
+    return obj;
+}
+
+void HSM_POOL_Put(HSM_POOL *This, void *obj)
+{
+    HSM_POOL_FREE *link = (HSM_POOL_FREE *)obj;
+#if HSM_FEATURE_SAFETY_CHECK
+    // [optional] Check for an instance freed twice
+    if (HSM_POOL_FREE_MAGIC == link->magic)
+    {
+        HSM_DEBUG("!!!!Illegal free of instance %p, already free!!!!", obj);
+        return;
+    }
+    link->magic = HSM_POOL_FREE_MAGIC;
+#endif // HSM_FEATURE_SAFETY_CHECK
+    HSM_POOL_LOCK();
+    link->next = This->free;
+    This->free = link;
+    This->stats.used--;
+    This->stats.frees++;
+    HSM_POOL_UNLOCK();
+}
+
+HSM *HSM_Alloc(HSM_POOL *This, const char *name, HSM_STATE *initState)
+{
+    HSM *hsm = (HSM *)HSM_POOL_Get(This);
+    if (hsm)
+    {
+        HSM_Create(hsm, name, initState);
+    }
+    return hsm;
+}
+
+void HSM_Free(HSM_POOL *This, HSM *hsm, void *param)
+{
+    HSM_Destroy(hsm, param);
+    HSM_POOL_Put(This, hsm);
+}
+
+void HSM_POOL_GetStats(HSM_POOL *This, HSM_POOL_STATS *stats, uint8_t reset)
+{
+    HSM_POOL_LOCK();
+    *stats = This->stats;
+    if (reset)
+    {
+        This->stats.highWater = This->stats.used;
+        This->stats.failed = 0;
+    }
+    HSM_POOL_UNLOCK();
+}
+#endif // HSM_FEATURE_POOL
@@ -0,0 +1,140 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __HSM_POOL_H__
+#define __HSM_POOL_H__
+
+#include "hsm.h"
+
+#if HSM_FEATURE_POOL
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----Structure declaration----
+typedef struct HSM_POOL_T HSM_POOL;
+typedef struct HSM_POOL_SLAB_T HSM_POOL_SLAB;
+typedef struct HSM_POOL_FREE_T HSM_POOL_FREE;
+
+// Header at the start of each slab, followed by the instances
+struct HSM_POOL_SLAB_T
+{
+    HSM_POOL_SLAB *next;        // Next slab of the pool
+    uint8_t owned;              // 1 - allocated with HSM_POOL_SLAB_ALLOC(), 0 - given to HSM_POOL_AddSlab()
+};
+
+// Link stored in a free instance
+struct HSM_POOL_FREE_T
+{
+    HSM_POOL_FREE *next;        // Next free instance
+    uint32_t magic;             // Marks the instance as free to catch a double HSM_Free()
+};
+
+typedef struct HSM_POOL_STATS_T
+{
+    uint32_t size;              // Bytes of each instance, rounded up to HSM_POOL_ALIGN
+    uint32_t slabs;             // Number of slabs
+    uint32_t capacity;          // Number of instances that fit in the slabs
+    uint32_t used;              // Number of instances allocated
+    uint32_t highWater;         // Highest number of instances allocated at once
+    uint32_t failed;            // Number of allocations that found the pool exhausted
+    uint64_t allocs;            // Number of allocations
+    uint64_t frees;             // Number of frees
+} HSM_POOL_STATS;
+
+struct HSM_POOL_T
+{
+    HSM_POOL_FREE *free;        // Free instances, the last freed first since it is likely in cache
+    uint8_t *next;              // Instances of the newest slab never used yet, so a slab needs no initialization
+    uint8_t *end;               // End of the newest slab
+    HSM_POOL_SLAB *slabs;       // Slabs of the pool, the newest first
+    uint32_t limit;             // Maximum number of instances allocated at once, 0 for no limit
+    HSM_POOL_STATS stats;
+};
+
+//----Function Declarations----
+// Func: void HSM_POOL_Create(HSM_POOL *This, uint32_t size, uint32_t limit)
+// Desc: Create an empty pool of instances of a structure embedding HSM as its first member, e.g. CAMERA.
+//       Slabs of HSM_POOL_SLAB_SIZE are allocated as the pool runs out of instances
+// This: Pointer to HSM_POOL object
+// size: Size of the instance structure, e.g. sizeof(CAMERA)
+// limit: Maximum number of instances allocated at once, 0 for no limit
+void HSM_POOL_Create(HSM_POOL *This, uint32_t size, uint32_t limit);
+
+// Func: void HSM_POOL_Destroy(HSM_POOL *This)
+// Desc: Free the slabs allocated by the pool.  The instances must be freed first
+// This: Pointer to HSM_POOL object
+void HSM_POOL_Destroy(HSM_POOL *This);
+
+// Func: uint32_t HSM_POOL_AddSlab(HSM_POOL *This, void *mem, uint32_t bytes)
+// Desc: Add memory to the pool, e.g. a static buffer when slabs are not allocated at run time
+// This: Pointer to HSM_POOL object
+// mem: Memory kept by the pool until HSM_POOL_Destroy()
+// bytes: Size of the memory
+// return|uint32_t: Number of instances added
+uint32_t HSM_POOL_AddSlab(HSM_POOL *This, void *mem, uint32_t bytes);
+
+// Func: void *HSM_POOL_Get(HSM_POOL *This)
+// Desc: Allocate a zeroed instance without creating it, so the user data can be set before HSM_Create()
+// This: Pointer to HSM_POOL object
+// return|void *: Pointer to the instance, NULL if the pool is exhausted
+void *HSM_POOL_Get(HSM_POOL *This);
+
+// Func: void HSM_POOL_Put(HSM_POOL *This, void *obj)
+// Desc: Return an instance to the pool without destroying it
+// This: Pointer to HSM_POOL object
+// obj: Pointer to the instance from HSM_POOL_Get()
+void HSM_POOL_Put(HSM_POOL *This, void *obj);
+
+// Func: HSM *HSM_Alloc(HSM_POOL *This, const char *name, HSM_STATE *initState)
+// Desc: Allocate a zeroed instance and create it with HSM_Create()
+// This: Pointer to HSM_POOL object
+// name: Name of state machine (for debugging)
+// initState: Initial state of statemachine
+// return|HSM *: Pointer to the instance, NULL if the pool is exhausted
+HSM *HSM_Alloc(HSM_POOL *This, const char *name, HSM_STATE *initState);
+
+// Func: void HSM_Free(HSM_POOL *This, HSM *hsm, void *param)
+// Desc: Destroy an instance with HSM_Destroy(), sending HSME_EXIT to its active states, and return it to the pool
+// This: Pointer to HSM_POOL object
+// hsm: Pointer to the instance from HSM_Alloc()
+// param: Optional Parameter associated with HSME_EXIT event
+void HSM_Free(HSM_POOL *This, HSM *hsm, void *param);
+
+// Func: void HSM_POOL_GetStats(HSM_POOL *This, HSM_POOL_STATS *stats, uint8_t reset)
+// Desc: Snapshot the usage of the pool
+// This: Pointer to HSM_POOL object
+// stats: Pointer to the snapshot
+// reset: 1 - Restart the high-water mark from the current usage and clear the failed count, 0 - leave them
+void HSM_POOL_GetStats(HSM_POOL *This, HSM_POOL_STATS *stats, uint8_t reset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HSM_FEATURE_POOL
+
+#endif // __HSM_POOL_H__
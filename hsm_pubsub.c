@@ -0,0 +1,251 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "hsm_pubsub.h"
+
+#if HSM_FEATURE_PUBSUB
+// Each event has a list of the subscriptions of the instances whose active states subscribe to it, so a publish
+// only visits the instances that handle the event.  An instance has one subscription per event, counting the
+// active states that subscribe to it, linked when the first of them is entered and unlinked when the last is exited
+
+void HSM_BUS_Create(HSM_BUS *This)
+{
+    uint16_t idx;
+    for (idx = 0; idx < HSM_PUBSUB_EVENTS; idx++)
+    {
+        This->subs[idx] = ((void *)0);
+    }
+    This->cursor = ((void *)0);
+    This->published = 0;
+    This->delivered = 0;
+}
+
+void HSM_STATE_Subscribe(HSM_STATE *This, const HSM_EVENT *events, uint8_t count)
+{
+    uint8_t idx;
+    for (idx = 0; idx < count; idx++)
+    {
+        if (events[idx] >= HSM_PUBSUB_EVENTS)
+        {
+            HSM_DEBUG("Please increase HSM_PUBSUB_EVENTS > %lu", (unsigned long)events[idx]);
+            // assert(0, "Please increase HSM_PUBSUB_EVENTS");
+            while(1);
+        }
+    }
+    This->subscribe = events;
+    This->subscribeCount = count;
+}
+
+static void HSM_BUS_Unlink(HSM_BUS *This, HSM_SUB *sub)
+{
+    HSM_BUS_CURSOR *cursor;
+    // Step over the subscription in the publishes in progress
+    for (cursor = This->cursor; cursor; cursor = cursor->outer)
+    {
+        if (cursor->next == sub)
+        {
+            cursor->next = sub->next;
+        }
+    }
+    *sub->link = sub->next;
+    if (sub->next)
+    {
+        sub->next->link = sub->link;
+    }
+    sub->link = ((void *)0);
+}
+
+void HSM_BUS_EnterState(HSM *hsm, HSM_STATE *state)
+{
+    HSM_BUS *bus = hsm->bus;
+    HSM_SUB *sub;
+    HSM_SUB *slot;
+    uint8_t idx;
+    uint8_t evt;
+
+    for (evt = 0; evt < state->subscribeCount; evt++)
+    {
+        slot = ((void *)0);
+        for (idx = 0; idx < hsm->subCount; idx++)
+        {
+            sub = &hsm->subs[idx];
+            if (((void *)0) == sub->link)
+            {
+                slot = slot ? slot : sub;
+            }
+            else if (sub->event == state->subscribe[evt])
+            {
+                break;
+            }
+        }
+        if (idx < hsm->subCount)
+        {
+            // A parent state already subscribed to the event
+            hsm->subs[idx].states++;
+            continue;
+        }
+        if (((void *)0) == slot)
+        {
+            HSM_DEBUG("%s[%s] has no slot HSM_SUB for event %lu", hsm->name, state->name,
+                      (unsigned long)state->subscribe[evt]);
+            // assert(0, "Please pass more HSM_SUB to HSM_BUS_Join()");
+            while(1);
+        }
+        slot->hsm = hsm;
+        slot->event = state->subscribe[evt];
+        slot->states = 1;
+        slot->next = bus->subs[slot->event];
+        slot->link = &bus->subs[slot->event];
+        if (slot->next)
+        {
+            slot->next->link = &slot->next;
+        }
+        bus->subs[slot->event] = slot;
+    }
+}
+
+void HSM_BUS_ExitState(HSM *hsm, HSM_STATE *state)
+{
+    HSM_SUB *sub;
+    uint8_t idx;
+    uint8_t evt;
+
+    for (evt = 0; evt < state->subscribeCount; evt++)
+    {
+        for (idx = 0; idx < hsm->subCount; idx++)
+        {
+            sub = &hsm->subs[idx];
+            if (sub->link && sub->event == state->subscribe[evt])
+            {
+                if (0 == --sub->states)
+                {
+                    HSM_BUS_Unlink(hsm->bus, sub);
+                }
+                break;
+            }
+        }
+    }
+}
+
+void HSM_BUS_Join(HSM_BUS *This, HSM *hsm, HSM_SUB *subs, uint8_t count)
+{
+    HSM_STATE *state;
+    uint8_t idx;
+
+    if (hsm->bus)
+    {
+        HSM_BUS_Leave(hsm);
+    }
+    for (idx = 0; idx < count; idx++)
+    {
+        subs[idx].link = ((void *)0);
+    }
+    hsm->bus = This;
+    hsm->subs = subs;
+    hsm->subCount = count;
+    // Subscribe the active states, which were entered before the instance joined
+    for (state = hsm->curState; state->level; state = state->parent)
+    {
+        HSM_BUS_EnterState(hsm, state);
+    }
+#if HSM_FEATURE_REGIONS
+    for (idx = hsm->curState->regionFirst; idx < hsm->curState->regionFirst + hsm->curState->regionCount; idx++)
+    {
+        for (state = hsm->regions[idx]; state != hsm->curState; state = state->parent)
+        {
+            HSM_BUS_EnterState(hsm, state);
+        }
+    }
+#endif // HSM_FEATURE_REGIONS
+}
+
+void HSM_BUS_Leave(HSM *hsm)
+{
+    uint8_t idx;
+    for (idx = 0; idx < hsm->subCount; idx++)
+    {
+        if (hsm->subs[idx].link)
+        {
+            HSM_BUS_Unlink(hsm->bus, &hsm->subs[idx]);
+        }
+    }
+    hsm->bus = ((void *)0);
+    hsm->subs = ((void *)0);
+    hsm->subCount = 0;
+}
+
+uint32_t HSM_BUS_Publish(HSM_BUS *This, HSM_EVENT event, HSM_MSG *msg)
+{
+    HSM_BUS_CURSOR cursor;
+    HSM_SUB *sub;
+    uint32_t count = 0;
+
+    if (event >= HSM_PUBSUB_EVENTS)
+    {
+        HSM_DEBUG("Event %lu can not be published, Please increase HSM_PUBSUB_EVENTS", (unsigned long)event);
+        // assert(0, "Please increase HSM_PUBSUB_EVENTS");
+        while(1);
+    }
+    // The cursor is moved if a handler unsubscribes the next subscriber
+    cursor.next = This->subs[event];
+    cursor.outer = This->cursor;
+    This->cursor = &cursor;
+    while ((sub = cursor.next))
+    {
+        cursor.next = sub->next;
+        HSM_Run(sub->hsm, event, msg);
+        count++;
+    }
+    This->cursor = cursor.outer;
+    This->published++;
+    This->delivered += count;
+    // All subscribers are done, drop the reference of the publisher
+    if (msg)
+    {
+        HSM_MSG_Unref(msg);
+    }
+    return count;
+}
+
+void HSM_MSG_Create(HSM_MSG *This, void (*release)(HSM_MSG *This))
+{
+    This->refs = 1;
+    This->release = release;
+}
+
+HSM_MSG *HSM_MSG_Ref(HSM_MSG *This)
+{
+    This->refs++;
+    return This;
+}
+
+void HSM_MSG_Unref(HSM_MSG *This)
+{
+    if (0 == --This->refs && This->release)
+    {
+        This->release(This);
+    }
+}
+#endif // HSM_FEATURE_PUBSUB
@@ -0,0 +1,149 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __HSM_PUBSUB_H__
+#define __HSM_PUBSUB_H__
+
+#include "hsm.h"
+
+#if HSM_FEATURE_PUBSUB
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----Structure declaration----
+typedef struct HSM_BUS_T HSM_BUS;
+typedef struct HSM_SUB_T HSM_SUB;
+typedef struct HSM_MSG_T HSM_MSG;
+typedef struct HSM_BUS_CURSOR_T HSM_BUS_CURSOR;
+
+// Header of a published payload, placed first in the payload structure so the payload is passed as param
+// without a copy.  The payload is released after the last reference is dropped
+struct HSM_MSG_T
+{
+    uint32_t refs;              // References held by the publisher and the handlers that keep the payload
+    void (*release)(HSM_MSG *This); // Frees the payload, NULL for a static payload
+};
+
+// Subscription of an HSM instance to an event, while one of its active states subscribes to the event
+struct HSM_SUB_T
+{
+    HSM_SUB *next;              // Next subscriber of the event
+    HSM_SUB **link;             // Link pointing to this subscription in the bus, NULL if unused
+    HSM *hsm;                   // Subscribed HSM instance
+    HSM_EVENT event;            // Subscribed event
+    uint8_t states;             // Number of active states subscribing to the event
+};
+
+// Position of a publish in progress, moved when the next subscription is unsubscribed by a handler
+struct HSM_BUS_CURSOR_T
+{
+    HSM_SUB *next;              // Next subscription to run
+    HSM_BUS_CURSOR *outer;      // Publish in progress when this one started, for publishes from handlers
+};
+
+struct HSM_BUS_T
+{
+    HSM_SUB *subs[HSM_PUBSUB_EVENTS]; // Subscriptions of each event, the latest first
+    HSM_BUS_CURSOR *cursor;     // Innermost publish in progress, NULL if none
+    uint32_t published;         // Events published
+    uint32_t delivered;         // Events run on a subscriber
+};
+
+//----Function Declarations----
+// Func: void HSM_BUS_Create(HSM_BUS *This)
+// Desc: Create an empty bus.  The bus and its payload references are not thread safe, and must be driven by the
+//       thread running the HSM instances
+// This: Pointer to HSM_BUS object
+void HSM_BUS_Create(HSM_BUS *This);
+
+// Func: void HSM_STATE_Subscribe(HSM_STATE *This, const HSM_EVENT *events, uint8_t count)
+// Desc: Declare the events published to the HSM instances while they are in the state or one of its substates.
+//       The array is kept by the state, not copied
+// This: Pointer to HSM_STATE object, already created with HSM_STATE_Create()
+// events: Array of events below HSM_PUBSUB_EVENTS
+// count: Number of events in the array
+void HSM_STATE_Subscribe(HSM_STATE *This, const HSM_EVENT *events, uint8_t count);
+
+// Func: void HSM_BUS_Join(HSM_BUS *This, HSM *hsm, HSM_SUB *subs, uint8_t count)
+// Desc: Subscribe an HSM instance to the events of its active states.  The subscriptions then follow the
+//       transitions of the instance.  Call after HSM_Create() or HSM_Restore(), which reset the instance
+// This: Pointer to HSM_BUS object
+// hsm: Pointer to HSM instance
+// subs: Array of subscriptions owned by the instance, one per event subscribed at a time by its active states
+// count: Number of subscriptions in the array
+void HSM_BUS_Join(HSM_BUS *This, HSM *hsm, HSM_SUB *subs, uint8_t count);
+
+// Func: void HSM_BUS_Leave(HSM *hsm)
+// Desc: Unsubscribe an HSM instance from all events of its bus
+// hsm: Pointer to HSM instance
+void HSM_BUS_Leave(HSM *hsm);
+
+// Func: uint32_t HSM_BUS_Publish(HSM_BUS *This, HSM_EVENT event, HSM_MSG *msg)
+// Desc: Run an event on each HSM instance subscribed to it, with the payload as param.  Instances subscribing
+//       during the publish receive the next one.  The reference of the publisher is dropped after the last subscriber
+// This: Pointer to HSM_BUS object
+// event: HSM_EVENT below HSM_PUBSUB_EVENTS
+// msg: Payload created with HSM_MSG_Create(), or NULL
+// return|uint32_t: Number of instances the event was run on
+uint32_t HSM_BUS_Publish(HSM_BUS *This, HSM_EVENT event, HSM_MSG *msg);
+
+// Func: void HSM_MSG_Create(HSM_MSG *This, void (*release)(HSM_MSG *This))
+// Desc: Create a payload holding the reference of the publisher
+// This: Pointer to HSM_MSG header of the payload
+// release: Called to free the payload after the last reference is dropped, NULL if nothing to free
+void HSM_MSG_Create(HSM_MSG *This, void (*release)(HSM_MSG *This));
+
+// Func: HSM_MSG *HSM_MSG_Ref(HSM_MSG *This)
+// Desc: Add a reference, e.g. for a handler that keeps the payload after it returns
+// This: Pointer to HSM_MSG header of the payload
+// return|HSM_MSG *: This
+HSM_MSG *HSM_MSG_Ref(HSM_MSG *This);
+
+// Func: void HSM_MSG_Unref(HSM_MSG *This)
+// Desc: Drop a reference, releasing the payload after the last one
+// This: Pointer to HSM_MSG header of the payload
+void HSM_MSG_Unref(HSM_MSG *This);
+
+// Func: void HSM_BUS_EnterState(HSM *hsm, HSM_STATE *state)
+// Desc: Subscribe an HSM instance to the events of a state.  Called by HSM_Tran() after HSME_ENTRY of each state
+// hsm: Pointer to HSM instance
+// state: Pointer to the entered HSM_STATE
+void HSM_BUS_EnterState(HSM *hsm, HSM_STATE *state);
+
+// Func: void HSM_BUS_ExitState(HSM *hsm, HSM_STATE *state)
+// Desc: Unsubscribe an HSM instance from the events of a state.  Called by HSM_Tran() after HSME_EXIT of each state
+// hsm: Pointer to HSM instance
+// state: Pointer to the exited HSM_STATE
+void HSM_BUS_ExitState(HSM *hsm, HSM_STATE *state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HSM_FEATURE_PUBSUB
+
+#endif // __HSM_PUBSUB_H__
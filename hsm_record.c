@@ -0,0 +1,265 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "hsm_record.h"
+
+#if HSM_FEATURE_RECORD
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// The replay is paced on CLOCK_MONOTONIC, which clock_nanosleep() waits on, whatever clock timed the records
+static uint64_t HSM_RecordMonotonic(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#ifndef HSM_RECORD_CLOCK
+#define HSM_RECORD_CLOCK HSM_RecordMonotonic
+#endif // HSM_RECORD_CLOCK
+
+// Records are written to the buffer when HSM_Run() is called, so the log is in call order, and the state is filled
+// in when it returns.  Each write of the buffer to the file starts a new generation, so a call returning after its
+// record was written leaves the state unknown
+static FILE *pstHsmRecordFile;
+static uint64_t ulHsmRecordStart;
+static uint32_t uHsmRecordGen = 1;
+static uint32_t uHsmRecordLen;
+static uint32_t uHsmRecordInstances;
+static uint64_t aulHsmRecordBuf[HSM_RECORD_BUFFER / sizeof(uint64_t)];
+static _Thread_local uint8_t ucHsmRecordDepth;
+
+#define HSM_RECORD_PAD(size)    (((size) + 7) & ~7U)
+
+static void HSM_RECORD_Write(void)
+{
+    if (uHsmRecordLen)
+    {
+        fwrite(aulHsmRecordBuf, 1, uHsmRecordLen, pstHsmRecordFile);
+        uHsmRecordLen = 0;
+        uHsmRecordGen++;
+    }
+}
+
+uint8_t HSM_RECORD_Start(const char *path)
+{
+    HSM_RECORD_HEADER header = { HSM_RECORD_MAGIC, HSM_RECORD_VERSION, 0 };
+    FILE *file = fopen(path, "wb");
+    if (((void *)0) == file)
+    {
+        return 0;
+    }
+    fwrite(&header, 1, sizeof(header), file);
+    HSM_RECORD_LOCK();
+    uHsmRecordLen = 0;
+    ulHsmRecordStart = HSM_RECORD_CLOCK();
+    pstHsmRecordFile = file;
+    HSM_RECORD_UNLOCK();
+    return 1;
+}
+
+void HSM_RECORD_Stop(void)
+{
+    HSM_RECORD_LOCK();
+    if (pstHsmRecordFile)
+    {
+        HSM_RECORD_Write();
+        fclose(pstHsmRecordFile);
+        pstHsmRecordFile = ((void *)0);
+    }
+    HSM_RECORD_UNLOCK();
+}
+
+void HSM_RECORD_Flush(void)
+{
+    HSM_RECORD_LOCK();
+    if (pstHsmRecordFile)
+    {
+        HSM_RECORD_Write();
+        fflush(pstHsmRecordFile);
+    }
+    HSM_RECORD_UNLOCK();
+}
+
+uint32_t HSM_RECORD_StateId(const char *name)
+{
+    // FNV-1a, never HSM_RECORD_STATE_UNKNOWN
+    uint32_t hash = 2166136261UL;
+    for (; name && *name; name++)
+    {
+        hash = (hash ^ (uint8_t)*name) * 16777619UL;
+    }
+    return hash ? hash : 1;
+}
+
+uint32_t HSM_RECORD_NewInstance(void)
+{
+    return __atomic_fetch_add(&uHsmRecordInstances, 1, __ATOMIC_RELAXED);
+}
+
+uint64_t HSM_RECORD_Begin(HSM *This, uint8_t type, HSM_EVENT event, void *param)
+{
+    HSM_RECORD *record;
+    uint64_t handle = 0;
+    uint16_t size = 0;
+#ifdef HSM_RECORD_PAYLOAD
+    uint64_t payload[HSM_RECORD_PAYLOAD_MAX / sizeof(uint64_t)];
+    uint16_t idx;
+    if (pstHsmRecordFile && type == HSM_RECORD_RUN)
+    {
+        size = HSM_RECORD_PAYLOAD(This, event, param, payload, HSM_RECORD_PAYLOAD_MAX);
+    }
+#endif // HSM_RECORD_PAYLOAD
+
+    HSM_RECORD_LOCK();
+    if (pstHsmRecordFile)
+    {
+        if (uHsmRecordLen + sizeof(HSM_RECORD) + HSM_RECORD_PAD(size) > sizeof(aulHsmRecordBuf))
+        {
+            HSM_RECORD_Write();
+        }
+        record = (HSM_RECORD *)((uint8_t *)aulHsmRecordBuf + uHsmRecordLen);
+        record->time = HSM_RECORD_CLOCK() - ulHsmRecordStart;
+        record->param = (uintptr_t)param;
+        record->instance = This->recId;
+        record->event = event;
+        record->state = HSM_RECORD_STATE_UNKNOWN;
+        record->type = type;
+        record->depth = ucHsmRecordDepth;
+        record->size = size;
+#ifdef HSM_RECORD_PAYLOAD
+        for (idx = 0; idx < HSM_RECORD_PAD(size) / sizeof(uint64_t); idx++)
+        {
+            ((uint64_t *)(record + 1))[idx] = payload[idx];
+        }
+#endif // HSM_RECORD_PAYLOAD
+        handle = ((uint64_t)uHsmRecordGen << 32) | uHsmRecordLen;
+        uHsmRecordLen += sizeof(HSM_RECORD) + HSM_RECORD_PAD(size);
+    }
+    HSM_RECORD_UNLOCK();
+    ucHsmRecordDepth++;
+    return handle;
+}
+
+void HSM_RECORD_End(HSM *This, uint64_t handle)
+{
+    ucHsmRecordDepth--;
+    if (0 == handle)
+    {
+        return;
+    }
+    HSM_RECORD_LOCK();
+    if (pstHsmRecordFile && (uint32_t)(handle >> 32) == uHsmRecordGen)
+    {
+        ((HSM_RECORD *)((uint8_t *)aulHsmRecordBuf + (uint32_t)handle))->state = This->curState->recId;
+    }
+    HSM_RECORD_UNLOCK();
+}
+
+uint8_t HSM_REPLAY_File(const char *path, HSM_REPLAY_FN fn, void *ctx, double speed, HSM_REPLAY_STATS *stats)
+{
+    struct stat st;
+    struct timespec ts;
+    uint8_t *log;
+    uint8_t *end;
+    HSM_RECORD *record;
+    HSM *hsm;
+    uint64_t start;
+    uint64_t due;
+    int fd = open(path, O_RDONLY);
+
+    stats->records = 0;
+    stats->runs = 0;
+    stats->nested = 0;
+    stats->mismatches = 0;
+    stats->firstMismatch = 0;
+    stats->elapsed = 0;
+    if (fd < 0)
+    {
+        return 0;
+    }
+    if (fstat(fd, &st) || st.st_size < (off_t)sizeof(HSM_RECORD_HEADER))
+    {
+        close(fd);
+        return 0;
+    }
+    // Private writable mapping, so the handlers may modify the payloads they receive
+    log = mmap(((void *)0), st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == log)
+    {
+        return 0;
+    }
+    if (((HSM_RECORD_HEADER *)log)->magic != HSM_RECORD_MAGIC || ((HSM_RECORD_HEADER *)log)->version != HSM_RECORD_VERSION)
+    {
+        munmap(log, st.st_size);
+        return 0;
+    }
+    end = log + st.st_size;
+    start = HSM_RecordMonotonic();
+    for (record = (HSM_RECORD *)(log + sizeof(HSM_RECORD_HEADER)); (uint8_t *)(record + 1) <= end;
+         record = (HSM_RECORD *)((uint8_t *)(record + 1) + HSM_RECORD_PAD(record->size)))
+    {
+        stats->records++;
+        if (record->depth)
+        {
+            stats->nested++;
+            continue;
+        }
+        if (speed > 0)
+        {
+            // Wait for the recorded offset of the call from the start of the replay
+            due = start + (uint64_t)(record->time / speed);
+            ts.tv_sec = due / 1000000000;
+            ts.tv_nsec = due % 1000000000;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, ((void *)0));
+        }
+        hsm = fn(ctx, record);
+        if (hsm && record->type == HSM_RECORD_RUN)
+        {
+            HSM_Run(hsm, record->event, record->size ? (void *)(record + 1) : (void *)(uintptr_t)record->param);
+            stats->runs++;
+        }
+        if (((void *)0) == hsm || (record->state != HSM_RECORD_STATE_UNKNOWN && hsm->curState->recId != record->state))
+        {
+            if (0 == stats->mismatches++)
+            {
+                stats->firstMismatch = stats->records - 1;
+                HSM_DEBUG("HSM_REPLAY record %llu of instance %u ends in state %08x instead of %08x",
+                          (unsigned long long)stats->firstMismatch, record->instance,
+                          hsm ? hsm->curState->recId : 0, record->state);
+            }
+        }
+    }
+    stats->elapsed = HSM_RecordMonotonic() - start;
+    munmap(log, st.st_size);
+    return 1;
+}
+#endif // HSM_FEATURE_RECORD
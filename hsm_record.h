@@ -0,0 +1,127 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __HSM_RECORD_H__
+#define __HSM_RECORD_H__
+
+#include "hsm.h"
+
+#if HSM_FEATURE_RECORD
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----Record definitions----
+// Log layout, in host byte order: HSM_RECORD_HEADER followed by HSM_RECORD entries, each followed by its payload
+// padded to a multiple of 8 bytes.  Entries are in the order HSM_Run() was called
+#define HSM_RECORD_MAGIC        0x524D5348  // "HSMR"
+#define HSM_RECORD_VERSION      1
+// Types of record
+#define HSM_RECORD_RUN          0   // HSM_Run()
+#define HSM_RECORD_CREATE       1   // HSM_Create(), state is the state after HSME_INIT
+#define HSM_RECORD_RESTORE      2   // HSM_Restore()
+// State of a record whose HSM_Run() was still running when the buffer was written
+#define HSM_RECORD_STATE_UNKNOWN    0
+
+//----Structure declaration----
+typedef struct HSM_RECORD_HEADER_T
+{
+    uint32_t magic;             // HSM_RECORD_MAGIC
+    uint16_t version;           // HSM_RECORD_VERSION
+    uint16_t reserved;
+} HSM_RECORD_HEADER;
+
+typedef struct HSM_RECORD_T
+{
+    uint64_t time;              // ns since HSM_RECORD_Start()
+    uint64_t param;             // Value of param, recId of the initial state for HSM_RECORD_CREATE
+    uint32_t instance;          // recId of the HSM instance
+    HSM_EVENT event;            // Event run
+    uint32_t state;             // recId of the current state once the call returned
+    uint8_t type;               // HSM_RECORD_RUN, HSM_RECORD_CREATE or HSM_RECORD_RESTORE
+    uint8_t depth;              // Number of HSM_Run() calls this call is nested in
+    uint16_t size;              // Bytes of payload following the record
+} HSM_RECORD;
+
+// Called by HSM_REPLAY_File() to get the HSM instance of a record.  For HSM_RECORD_CREATE the instance must be
+// created with HSM_Create() in the state whose recId is param.  For HSM_RECORD_RESTORE the instance must be created
+// with HSM_Restore() in the state whose recId is state
+typedef HSM *(*HSM_REPLAY_FN)(void *ctx, const HSM_RECORD *record);
+
+typedef struct HSM_REPLAY_STATS_T
+{
+    uint64_t records;           // Records read
+    uint64_t runs;              // Calls of HSM_Run() replayed
+    uint64_t nested;            // Nested records, replayed by the handler of the enclosing call
+    uint64_t mismatches;        // Replayed calls ending in another state than recorded
+    uint64_t firstMismatch;     // Index of the first mismatching record
+    uint64_t elapsed;           // ns taken by the replay
+} HSM_REPLAY_STATS;
+
+//----Function Declarations----
+// Func: uint8_t HSM_RECORD_Start(const char *path)
+// Desc: Start recording every HSM_Run(), HSM_Create() and HSM_Restore() into a log file
+// path: Path of the log file
+// return|uint8_t: 1 - recording, 0 - file could not be opened
+uint8_t HSM_RECORD_Start(const char *path);
+
+// Func: void HSM_RECORD_Stop(void)
+// Desc: Write the buffered records and close the log file
+void HSM_RECORD_Stop(void);
+
+// Func: void HSM_RECORD_Flush(void)
+// Desc: Write the buffered records to the log file
+void HSM_RECORD_Flush(void);
+
+// Func: uint32_t HSM_RECORD_StateId(const char *name)
+// Desc: Get the ID of a state in the record log.  Used by HSM_STATE_Create() to set recId
+// name: Name of the state
+// return|uint32_t: Hash of the name
+uint32_t HSM_RECORD_StateId(const char *name);
+
+// Func: uint8_t HSM_REPLAY_File(const char *path, HSM_REPLAY_FN fn, void *ctx, double speed, HSM_REPLAY_STATS *stats)
+// Desc: Replay a log through HSM_Run(), comparing the state of each instance with the recorded one.  Nested records
+//       are not run again, since the enclosing call runs them
+// path: Path of the log file
+// fn: Callback that gets the HSM instance of each record
+// ctx: Context passed to fn
+// speed: 0 - replay as fast as possible, 1.0 - replay at the recorded timing, 2.0 - twice as fast, etc.
+// stats: Pointer to the replay statistics
+// return|uint8_t: 1 - log is replayed, 0 - log could not be read
+uint8_t HSM_REPLAY_File(const char *path, HSM_REPLAY_FN fn, void *ctx, double speed, HSM_REPLAY_STATS *stats);
+
+// Hooks called by hsm.c
+uint64_t HSM_RECORD_Begin(HSM *This, uint8_t type, HSM_EVENT event, void *param);
+void HSM_RECORD_End(HSM *This, uint64_t handle);
+uint32_t HSM_RECORD_NewInstance(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HSM_FEATURE_RECORD
+
+#endif // __HSM_RECORD_H__
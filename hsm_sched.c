@@ -0,0 +1,271 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "hsm_sched.h"
+
+#if HSM_FEATURE_SCHED
+#include <sched.h>
+
+// Worker running on this thread, used to keep actors posted by a state handler on the same worker
+static _Thread_local HSM_SCHED_WORKER *pstHsmCurWorker;
+
+static void HSM_SCHED_Push(HSM_SCHED_WORKER *worker, HSM_ACTOR *first, HSM_ACTOR *last, uint32_t count)
+{
+    pthread_mutex_lock(&worker->lock);
+    last->next = ((void *)0);
+    if (worker->tail)
+    {
+        worker->tail->next = first;
+    }
+    else
+    {
+        worker->head = first;
+    }
+    worker->tail = last;
+    worker->count += count;
+    pthread_mutex_unlock(&worker->lock);
+}
+
+static HSM_ACTOR *HSM_SCHED_Pop(HSM_SCHED_WORKER *worker)
+{
+    HSM_ACTOR *actor;
+    pthread_mutex_lock(&worker->lock);
+    actor = worker->head;
+    if (actor)
+    {
+        worker->head = actor->next;
+        if (((void *)0) == worker->head)
+        {
+            worker->tail = ((void *)0);
+        }
+        worker->count--;
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return actor;
+}
+
+static HSM_ACTOR *HSM_SCHED_Steal(HSM_SCHED *sched, HSM_SCHED_WORKER *thief)
+{
+    HSM_SCHED_WORKER *victim;
+    HSM_ACTOR *first;
+    HSM_ACTOR *last;
+    uint32_t count;
+    uint32_t idx;
+    uint16_t offset;
+    // Visit the other workers, starting with the next one, and take half of the first non-empty run queue
+    for (offset = 1; offset < sched->workers; offset++)
+    {
+        victim = &sched->worker[(thief->index + offset) % sched->workers];
+        pthread_mutex_lock(&victim->lock);
+        if (0 == victim->count)
+        {
+            pthread_mutex_unlock(&victim->lock);
+            continue;
+        }
+        count = (victim->count + 1) / 2;
+        first = victim->head;
+        last = first;
+        for (idx = 1; idx < count; idx++)
+        {
+            last = last->next;
+        }
+        victim->head = last->next;
+        if (((void *)0) == victim->head)
+        {
+            victim->tail = ((void *)0);
+        }
+        victim->count -= count;
+        pthread_mutex_unlock(&victim->lock);
+        // Run the first stolen actor now and queue the rest locally
+        if (count > 1)
+        {
+            HSM_SCHED_Push(thief, first->next, last, count - 1);
+        }
+        return first;
+    }
+    return ((void *)0);
+}
+
+static void HSM_SCHED_Ready(HSM_ACTOR *actor)
+{
+    HSM_SCHED *sched = actor->sched;
+    HSM_SCHED_WORKER *worker = &sched->worker[actor->home];
+    if (pstHsmCurWorker && pstHsmCurWorker->sched == sched)
+    {
+        // Posted from a state handler, keep the actor on this worker while its data is in cache
+        worker = pstHsmCurWorker;
+    }
+    atomic_fetch_add(&sched->pending, 1);
+    HSM_SCHED_Push(worker, actor, actor, 1);
+    if (atomic_load(&sched->sleepers))
+    {
+        pthread_mutex_lock(&sched->sleepLock);
+        pthread_cond_signal(&sched->wake);
+        pthread_mutex_unlock(&sched->sleepLock);
+    }
+}
+
+static void HSM_SCHED_RunActor(HSM_ACTOR *actor)
+{
+    HSM_MBOX_DispatchMax(&actor->mbox, HSM_SCHED_BATCH);
+    // Release the actor, then check for events posted while it was running.  The fence pairs with
+    // HSM_ACTOR_Post() so either the poster or this worker sees the other and reschedules the actor
+    atomic_store(&actor->scheduled, 0);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!HSM_MBOX_IsEmpty(&actor->mbox) && !atomic_exchange(&actor->scheduled, 1))
+    {
+        HSM_SCHED_Ready(actor);
+    }
+}
+
+static void *HSM_SCHED_Worker(void *arg)
+{
+    HSM_SCHED_WORKER *self = (HSM_SCHED_WORKER *)arg;
+    HSM_SCHED *sched = self->sched;
+    HSM_ACTOR *actor;
+    uint8_t isIdle = 0;
+    uint8_t isDone;
+
+    pstHsmCurWorker = self;
+    for (;;)
+    {
+        actor = HSM_SCHED_Pop(self);
+        if (((void *)0) == actor)
+        {
+            actor = HSM_SCHED_Steal(sched, self);
+        }
+        if (actor)
+        {
+            atomic_fetch_sub(&sched->pending, 1);
+            HSM_SCHED_RunActor(actor);
+            isIdle = 0;
+            continue;
+        }
+        if (!isIdle)
+        {
+            // Give producers one chance before sleeping
+            isIdle = 1;
+            sched_yield();
+            continue;
+        }
+        pthread_mutex_lock(&sched->sleepLock);
+        atomic_fetch_add(&sched->sleepers, 1);
+        while (!atomic_load(&sched->pending) && !atomic_load(&sched->stop))
+        {
+            pthread_cond_wait(&sched->wake, &sched->sleepLock);
+        }
+        atomic_fetch_sub(&sched->sleepers, 1);
+        isDone = atomic_load(&sched->stop) && !atomic_load(&sched->pending);
+        pthread_mutex_unlock(&sched->sleepLock);
+        if (isDone)
+        {
+            break;
+        }
+        isIdle = 0;
+    }
+    pstHsmCurWorker = ((void *)0);
+    return ((void *)0);
+}
+
+uint8_t HSM_SCHED_Create(HSM_SCHED *This, uint16_t workers)
+{
+    uint16_t idx;
+    HSM_SCHED_WORKER *worker;
+    if (workers < 1 || workers > HSM_SCHED_MAX_WORKERS)
+    {
+        HSM_DEBUG("Invalid number of HSM_SCHED workers %d", workers);
+        return 0;
+    }
+    This->workers = workers;
+    atomic_init(&This->nextHome, 0);
+    atomic_init(&This->pending, 0);
+    atomic_init(&This->sleepers, 0);
+    atomic_init(&This->stop, 0);
+    pthread_mutex_init(&This->sleepLock, ((void *)0));
+    pthread_cond_init(&This->wake, ((void *)0));
+    for (idx = 0; idx < workers; idx++)
+    {
+        worker = &This->worker[idx];
+        pthread_mutex_init(&worker->lock, ((void *)0));
+        worker->head = ((void *)0);
+        worker->tail = ((void *)0);
+        worker->count = 0;
+        worker->sched = This;
+        worker->index = idx;
+    }
+    for (idx = 0; idx < workers; idx++)
+    {
+        if (pthread_create(&This->worker[idx].thread, ((void *)0), HSM_SCHED_Worker, &This->worker[idx]))
+        {
+            HSM_DEBUG("Failed to start HSM_SCHED worker %d", idx);
+            // Only join the workers that were started
+            This->workers = idx;
+            HSM_SCHED_Destroy(This);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void HSM_SCHED_Destroy(HSM_SCHED *This)
+{
+    uint16_t idx;
+    pthread_mutex_lock(&This->sleepLock);
+    atomic_store(&This->stop, 1);
+    pthread_cond_broadcast(&This->wake);
+    pthread_mutex_unlock(&This->sleepLock);
+    for (idx = 0; idx < This->workers; idx++)
+    {
+        pthread_join(This->worker[idx].thread, ((void *)0));
+        pthread_mutex_destroy(&This->worker[idx].lock);
+    }
+    pthread_cond_destroy(&This->wake);
+    pthread_mutex_destroy(&This->sleepLock);
+}
+
+void HSM_ACTOR_Create(HSM_ACTOR *This, HSM_SCHED *sched, HSM *hsm)
+{
+    HSM_MBOX_Create(&This->mbox, hsm);
+    This->sched = sched;
+    This->next = ((void *)0);
+    atomic_init(&This->scheduled, 0);
+    This->home = atomic_fetch_add(&sched->nextHome, 1) % sched->workers;
+}
+
+uint8_t HSM_ACTOR_Post(HSM_ACTOR *This, HSM_EVENT event, void *param)
+{
+    if (!HSM_MBOX_Post(&This->mbox, event, param))
+    {
+        return 0;
+    }
+    // Pairs with the fence in HSM_SCHED_RunActor()
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_exchange(&This->scheduled, 1))
+    {
+        HSM_SCHED_Ready(This);
+    }
+    return 1;
+}
+#endif // HSM_FEATURE_SCHED
@@ -0,0 +1,110 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef __HSM_SCHED_H__
+#define __HSM_SCHED_H__
+
+#include "hsm_mbox.h"
+
+#if HSM_FEATURE_SCHED
+#if !HSM_FEATURE_MBOX
+#error "HSM_FEATURE_SCHED requires HSM_FEATURE_MBOX"
+#endif // !HSM_FEATURE_MBOX
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----Structure declaration----
+typedef struct HSM_ACTOR_T HSM_ACTOR;
+typedef struct HSM_SCHED_T HSM_SCHED;
+
+struct HSM_ACTOR_T
+{
+    HSM_MBOX mbox;              // Events posted to the HSM instance
+    HSM_SCHED *sched;           // Scheduler running the HSM instance
+    HSM_ACTOR *next;            // Next actor in the run queue
+    atomic_uint scheduled;      // Set while the actor is on a run queue or running on a worker
+    uint16_t home;              // Worker whose run queue receives posts from outside the scheduler
+};
+
+typedef struct HSM_SCHED_WORKER_T
+{
+    _Alignas(HSM_CACHE_LINE) pthread_mutex_t lock;  // Protects the run queue
+    HSM_ACTOR *head;            // Run queue of actors with posted events
+    HSM_ACTOR *tail;
+    uint32_t count;             // Number of actors on the run queue
+    HSM_SCHED *sched;           // Owning scheduler
+    pthread_t thread;           // Worker thread
+    uint16_t index;             // Index of the worker in the scheduler
+} HSM_SCHED_WORKER;
+
+struct HSM_SCHED_T
+{
+    HSM_SCHED_WORKER worker[HSM_SCHED_MAX_WORKERS];
+    uint16_t workers;           // Number of worker threads
+    atomic_uint nextHome;       // Round-robin assignment of actors to workers
+    atomic_uint pending;        // Number of actors on all run queues
+    atomic_uint sleepers;       // Number of idle workers waiting on wake
+    atomic_uint stop;           // Set by HSM_SCHED_Destroy()
+    pthread_mutex_t sleepLock;
+    pthread_cond_t wake;
+};
+
+//----Function Declarations----
+// Func: uint8_t HSM_SCHED_Create(HSM_SCHED *This, uint16_t workers)
+// Desc: Create the scheduler and start its worker threads
+// This: Pointer to HSM_SCHED object
+// workers: Number of worker threads, 1 to HSM_SCHED_MAX_WORKERS
+// return|uint8_t: 1 - scheduler is running, 0 - invalid number of workers or threads could not be started
+uint8_t HSM_SCHED_Create(HSM_SCHED *This, uint16_t workers);
+
+// Func: void HSM_SCHED_Destroy(HSM_SCHED *This)
+// Desc: Run all pending events, then stop and join the worker threads.  Actors must no longer be posted to
+// This: Pointer to HSM_SCHED object
+void HSM_SCHED_Destroy(HSM_SCHED *This);
+
+// Func: void HSM_ACTOR_Create(HSM_ACTOR *This, HSM_SCHED *sched, HSM *hsm)
+// Desc: Bind an HSM instance to the scheduler.  The HSM is only ever run by one worker at a time
+// This: Pointer to HSM_ACTOR object
+// sched: Pointer to the scheduler
+// hsm: Pointer to the HSM instance, already created with HSM_Create()
+void HSM_ACTOR_Create(HSM_ACTOR *This, HSM_SCHED *sched, HSM *hsm);
+
+// Func: uint8_t HSM_ACTOR_Post(HSM_ACTOR *This, HSM_EVENT event, void *param)
+// Desc: Post an event to the actor from any thread, including state handlers running on a worker
+// This: Pointer to HSM_ACTOR object
+// event: HSM_EVENT to be run by the HSM
+// param: Parameter associated with HSM_EVENT
+// return|uint8_t: 1 - event is posted, 0 - actor mailbox is full, event is not posted and may be retried
+uint8_t HSM_ACTOR_Post(HSM_ACTOR *This, HSM_EVENT event, void *param);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HSM_FEATURE_SCHED
+
+#endif // __HSM_SCHED_H__
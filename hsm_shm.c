@@ -0,0 +1,300 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "hsm_shm.h"
+
+#if HSM_FEATURE_SHM
+// The segment has a channel per producer process, each a single-producer/single-consumer ring of events and a
+// ring of payload bytes.  The producer fills a payload in place in the arena and posts its offset, and the receiver
+// runs the event with the payload mapped in its own address space, so the payload is never copied.  Payloads are
+// released in the order they were posted, after the receiver ran their event.  A receiver with nothing to run sleeps
+// on a futex in the segment, which producers only wake when the receiver has announced it sleeps.  Each channel is
+// claimed by locking its robust mutex, which the kernel hands to the next producer if the owner dies, whatever its
+// PID namespace and even if its process id is reused.
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#if HSM_SHM_DEPTH & (HSM_SHM_DEPTH - 1)
+#error "HSM_SHM_DEPTH must be a power of 2"
+#endif // HSM_SHM_DEPTH
+#if HSM_SHM_ARENA & (HSM_SHM_ARENA - 1)
+#error "HSM_SHM_ARENA must be a power of 2"
+#endif // HSM_SHM_ARENA
+
+#define HSM_SHM_MAGIC       0x4D485348  // "HSHM" in little endian
+// Payloads are aligned to 8 bytes
+#define HSM_SHM_ROUND(x)    (((x) + 7) & ~(uint32_t)7)
+
+// Maps the segment, creating it for the receiver
+static HSM_SHM_SEG *HSM_SHM_Map(const char *name, uint8_t create)
+{
+    void *seg;
+    int fd = shm_open(name, create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, 0600);
+    if (fd < 0)
+    {
+        return ((void *)0);
+    }
+    if (create && ftruncate(fd, sizeof(HSM_SHM_SEG)) < 0)
+    {
+        close(fd);
+        shm_unlink(name);
+        return ((void *)0);
+    }
+    seg = mmap(((void *)0), sizeof(HSM_SHM_SEG), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return (MAP_FAILED == seg) ? ((void *)0) : seg;
+}
+
+uint8_t HSM_SHM_Create(HSM_SHM *This, const char *name, HSM **hsms, uint16_t count)
+{
+    HSM_SHM_SEG *seg;
+    pthread_mutexattr_t attr;
+    uint16_t idx;
+    // Replace a segment left by a previous receiver
+    shm_unlink(name);
+    seg = HSM_SHM_Map(name, 1);
+    if (((void *)0) == seg)
+    {
+        HSM_DEBUG("Failed to create the segment %s, errno:%d", name, errno);
+        return 0;
+    }
+    // The segment is zeroed by ftruncate(), so the channels are empty and free
+    seg->channels = HSM_SHM_CHANNELS;
+    seg->depth = HSM_SHM_DEPTH;
+    seg->arena = HSM_SHM_ARENA;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    for (idx = 0; idx < HSM_SHM_CHANNELS; idx++)
+    {
+        pthread_mutex_init(&seg->chan[idx].lease, &attr);
+    }
+    pthread_mutexattr_destroy(&attr);
+    atomic_store_explicit(&seg->magic, HSM_SHM_MAGIC, memory_order_release);
+    This->seg = seg;
+    This->chan = ((void *)0);
+    This->hsms = hsms;
+    This->count = count;
+    This->name = name;
+    return 1;
+}
+
+uint8_t HSM_SHM_Open(HSM_SHM *This, const char *name)
+{
+    HSM_SHM_SEG *seg = HSM_SHM_Map(name, 0);
+    uint16_t idx;
+    int err;
+    if (((void *)0) == seg)
+    {
+        return 0;
+    }
+    if (atomic_load_explicit(&seg->magic, memory_order_acquire) != HSM_SHM_MAGIC || seg->channels != HSM_SHM_CHANNELS ||
+        seg->depth != HSM_SHM_DEPTH || seg->arena != HSM_SHM_ARENA)
+    {
+        HSM_DEBUG("Segment %s is not ready or does not match HSM_SHM_CHANNELS/DEPTH/ARENA", name);
+        munmap(seg, sizeof(HSM_SHM_SEG));
+        return 0;
+    }
+    // Claim a free channel, or the channel of a producer that died without HSM_SHM_Close()
+    for (idx = 0; idx < HSM_SHM_CHANNELS; idx++)
+    {
+        err = pthread_mutex_trylock(&seg->chan[idx].lease);
+        if (EOWNERDEAD == err)
+        {
+            // The previous producer died holding the channel
+            err = pthread_mutex_consistent(&seg->chan[idx].lease);
+        }
+        if (0 == err)
+        {
+            This->seg = seg;
+            This->chan = &seg->chan[idx];
+            This->hsms = ((void *)0);
+            This->count = 0;
+            This->name = name;
+            return 1;
+        }
+    }
+    HSM_DEBUG("Please increase HSM_SHM_CHANNELS > %d", HSM_SHM_CHANNELS);
+    munmap(seg, sizeof(HSM_SHM_SEG));
+    return 0;
+}
+
+void HSM_SHM_Close(HSM_SHM *This)
+{
+    if (This->chan)
+    {
+        // The ring and the arena positions stay in the segment for the next producer of the channel
+        pthread_mutex_unlock(&This->chan->lease);
+    }
+    else
+    {
+        shm_unlink(This->name);
+    }
+    munmap(This->seg, sizeof(HSM_SHM_SEG));
+    This->seg = ((void *)0);
+    This->chan = ((void *)0);
+}
+
+void *HSM_SHM_Alloc(HSM_SHM *This, uint32_t size)
+{
+    HSM_SHM_CHAN *chan = This->chan;
+    uint32_t pos = chan->arenaHead;
+    uint32_t off = pos & (HSM_SHM_ARENA - 1);
+    uint32_t skip = 0;
+    size = HSM_SHM_ROUND(size);
+    if (size > HSM_SHM_ARENA)
+    {
+        return ((void *)0);
+    }
+    // A payload is contiguous, so the end of the arena is skipped when the payload does not fit
+    if (off + size > HSM_SHM_ARENA)
+    {
+        skip = HSM_SHM_ARENA - off;
+    }
+    if (pos + skip + size - chan->arenaCache > HSM_SHM_ARENA)
+    {
+        chan->arenaCache = atomic_load_explicit(&chan->arenaTail, memory_order_acquire);
+        if (pos + skip + size - chan->arenaCache > HSM_SHM_ARENA)
+        {
+            chan->full++;
+            return ((void *)0);
+        }
+    }
+    chan->arenaHead = pos + skip + size;
+    return &chan->arena[(off + skip) & (HSM_SHM_ARENA - 1)];
+}
+
+uint8_t HSM_SHM_Post(HSM_SHM *This, uint16_t target, HSM_EVENT event, void *payload)
+{
+    HSM_SHM_CHAN *chan = This->chan;
+    HSM_SHM_SLOT *slot;
+    uint32_t tail = atomic_load_explicit(&chan->tail, memory_order_relaxed);
+    if (tail - chan->headCache >= HSM_SHM_DEPTH)
+    {
+        chan->headCache = atomic_load_explicit(&chan->head, memory_order_acquire);
+        if (tail - chan->headCache >= HSM_SHM_DEPTH)
+        {
+            chan->full++;
+            return 0;
+        }
+    }
+#if HSM_FEATURE_SAFETY_CHECK
+    // [optional] Check for a payload not allocated with HSM_SHM_Alloc()
+    if (payload && ((uint8_t *)payload < chan->arena || (uint8_t *)payload >= &chan->arena[HSM_SHM_ARENA]))
+    {
+        HSM_DEBUG("!!!!Illegal payload %p of HSM_SHM_Post, not in the arena!!!!", payload);
+        return 0;
+    }
+#endif // HSM_FEATURE_SAFETY_CHECK
+    slot = &chan->slot[tail & (HSM_SHM_DEPTH - 1)];
+    slot->event = event;
+    slot->payload = payload ? (uint32_t)((uint8_t *)payload - chan->arena) : HSM_SHM_NO_PAYLOAD;
+    slot->end = chan->arenaHead;
+    slot->target = target;
+    // Publish the event before testing whether the receiver sleeps, which it announces before testing for events
+    atomic_store_explicit(&chan->tail, tail + 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&This->seg->sleeping, memory_order_seq_cst))
+    {
+        atomic_fetch_add_explicit(&This->seg->doorbell, 1, memory_order_seq_cst);
+        syscall(SYS_futex, &This->seg->doorbell, FUTEX_WAKE, 1, ((void *)0), ((void *)0), 0);
+    }
+    return 1;
+}
+
+uint32_t HSM_SHM_Dispatch(HSM_SHM *This)
+{
+    HSM_SHM_CHAN *chan;
+    HSM_SHM_SLOT *slot;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t cnt = 0;
+    uint16_t idx;
+    for (idx = 0; idx < HSM_SHM_CHANNELS; idx++)
+    {
+        chan = &This->seg->chan[idx];
+        head = atomic_load_explicit(&chan->head, memory_order_relaxed);
+        // Run the events posted so far, so a busy channel does not hold up the others
+        tail = atomic_load_explicit(&chan->tail, memory_order_acquire);
+        while (head != tail)
+        {
+            slot = &chan->slot[head & (HSM_SHM_DEPTH - 1)];
+            if (slot->target >= This->count)
+            {
+                HSM_DEBUG("\tEvent:%lx dropped, no HSM instance %u", (unsigned long)slot->event, slot->target);
+            }
+            else if (HSM_SHM_NO_PAYLOAD != slot->payload && slot->payload >= HSM_SHM_ARENA)
+            {
+                HSM_DEBUG("\tEvent:%lx dropped, payload %u is not in the arena", (unsigned long)slot->event,
+                          slot->payload);
+            }
+            else
+            {
+                HSM_Run(This->hsms[slot->target], slot->event,
+                        (HSM_SHM_NO_PAYLOAD == slot->payload) ? ((void *)0) : &chan->arena[slot->payload]);
+            }
+            // Release the slot and the payload once the event is run
+            atomic_store_explicit(&chan->arenaTail, slot->end, memory_order_release);
+            atomic_store_explicit(&chan->head, ++head, memory_order_release);
+            cnt++;
+        }
+    }
+    return cnt;
+}
+
+// Tests whether a channel has an event posted
+static uint8_t HSM_SHM_Ready(HSM_SHM *This)
+{
+    uint16_t idx;
+    for (idx = 0; idx < HSM_SHM_CHANNELS; idx++)
+    {
+        if (atomic_load_explicit(&This->seg->chan[idx].tail, memory_order_seq_cst) !=
+            atomic_load_explicit(&This->seg->chan[idx].head, memory_order_relaxed))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint8_t HSM_SHM_Wait(HSM_SHM *This, uint32_t timeout)
+{
+    struct timespec ts = { timeout / 1000, (timeout % 1000) * 1000000L };
+    unsigned int bell = atomic_load_explicit(&This->seg->doorbell, memory_order_relaxed);
+    // Announce the sleep before testing for events, so a producer posting meanwhile rings the doorbell
+    atomic_store_explicit(&This->seg->sleeping, 1, memory_order_seq_cst);
+    if (!HSM_SHM_Ready(This))
+    {
+        syscall(SYS_futex, &This->seg->doorbell, FUTEX_WAIT, bell, &ts, ((void *)0), 0);
+    }
+    atomic_store_explicit(&This->seg->sleeping, 0, memory_order_relaxed);
+    return HSM_SHM_Ready(This);
+}
+#endif // HSM_FEATURE_SHM
@@ -0,0 +1,153 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __HSM_SHM_H__
+#define __HSM_SHM_H__
+
+#include "hsm.h"
+
+#if HSM_FEATURE_SHM
+#include <pthread.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----Structure declaration----
+#define HSM_SHM_NO_PAYLOAD  0xFFFFFFFF
+
+// Posted event.  The segment is mapped at a different address in each process, so payloads are offsets
+typedef struct HSM_SHM_SLOT_T
+{
+    HSM_EVENT event;            // Posted event
+    uint32_t payload;           // Offset of the payload in the arena of the channel, HSM_SHM_NO_PAYLOAD if none
+    uint32_t end;               // Arena position after the payload, released once the event is run
+    uint16_t target;            // Index of the HSM instance given to HSM_SHM_Create()
+    uint16_t reserved;
+} HSM_SHM_SLOT;
+
+// Single-producer/single-consumer channel from one producer process to the receiver
+typedef struct HSM_SHM_CHAN_T
+{
+    HSM_SHM_SLOT slot[HSM_SHM_DEPTH];
+    _Alignas(HSM_CACHE_LINE) uint8_t arena[HSM_SHM_ARENA]; // Payloads, in the order of their events
+    _Alignas(HSM_CACHE_LINE) atomic_uint tail;  // Next slot written by the producer
+    uint32_t headCache;         // Producer's copy of head, refreshed when the channel looks full
+    uint32_t arenaHead;         // Next arena position reserved by the producer
+    uint32_t arenaCache;        // Producer's copy of arenaTail, refreshed when the arena looks full
+    uint32_t full;              // Number of posts refused because the channel or the arena is full
+    _Alignas(HSM_CACHE_LINE) atomic_uint head;  // Next slot read by the receiver
+    atomic_uint arenaTail;      // Arena position released by the receiver
+    _Alignas(HSM_CACHE_LINE) pthread_mutex_t lease; // Robust mutex held by the producer, released by the kernel if it dies
+} HSM_SHM_CHAN;
+
+// Layout of the shared memory segment
+typedef struct HSM_SHM_SEG_T
+{
+    atomic_uint magic;          // Set by the receiver once the segment is initialized
+    uint32_t channels;          // HSM_SHM_CHANNELS, HSM_SHM_DEPTH and HSM_SHM_ARENA of the receiver,
+    uint32_t depth;             // which must match those of the producers
+    uint32_t arena;
+    _Alignas(HSM_CACHE_LINE) atomic_uint doorbell; // Futex bumped by a producer when the receiver sleeps
+    atomic_uint sleeping;       // Set while the receiver waits in HSM_SHM_Wait()
+    _Alignas(HSM_CACHE_LINE) HSM_SHM_CHAN chan[HSM_SHM_CHANNELS];
+} HSM_SHM_SEG;
+
+// Mapping of a segment in a process, as the receiver or as a producer
+typedef struct HSM_SHM_T
+{
+    HSM_SHM_SEG *seg;           // Mapped segment
+    HSM_SHM_CHAN *chan;         // Channel claimed by a producer, NULL for the receiver
+    HSM **hsms;                 // HSM instances of the receiver, indexed by the target of the events
+    uint16_t count;             // Number of HSM instances
+    const char *name;           // Name of the segment, unlinked by the receiver on HSM_SHM_Close()
+} HSM_SHM;
+
+//----Function Declarations----
+// Func: uint8_t HSM_SHM_Create(HSM_SHM *This, const char *name, HSM **hsms, uint16_t count)
+// Desc: Create the named segment as the receiver of the events for a set of HSM instances.  A segment left with
+//       the same name, e.g. by a receiver that crashed, is replaced
+// This: Pointer to HSM_SHM object
+// name: Name of the segment for shm_open(), e.g. "/camera"
+// hsms: Array of HSM instances that run the events, indexed by the target given to HSM_SHM_Post()
+// count: Number of HSM instances in the array
+// return|uint8_t: 1 - segment is created, 0 - error
+uint8_t HSM_SHM_Create(HSM_SHM *This, const char *name, HSM **hsms, uint16_t count);
+
+// Func: uint8_t HSM_SHM_Open(HSM_SHM *This, const char *name)
+// Desc: Open the named segment as a producer, claiming one of its channels.  The channel of a producer that exited
+//       without HSM_SHM_Close() is reclaimed.  The channel is held by the calling thread, which must call
+//       HSM_SHM_Close() and stay alive as long as the channel is in use
+// This: Pointer to HSM_SHM object
+// name: Name of the segment given to HSM_SHM_Create()
+// return|uint8_t: 1 - channel is claimed, 0 - segment is not created yet, does not match the configuration, or
+//                 has no free channel
+uint8_t HSM_SHM_Open(HSM_SHM *This, const char *name);
+
+// Func: void HSM_SHM_Close(HSM_SHM *This)
+// Desc: Unmap the segment.  A producer frees its channel for another producer, and the events it posted are still
+//       run.  The receiver removes the name of the segment
+// This: Pointer to HSM_SHM object
+void HSM_SHM_Close(HSM_SHM *This);
+
+// Func: void *HSM_SHM_Alloc(HSM_SHM *This, uint32_t size)
+// Desc: Reserve a payload in the arena of the producer's channel, to be filled in place and passed to the next
+//       HSM_SHM_Post().  The payload is released after the receiver ran the event, so handlers copy what they keep
+// This: Pointer to HSM_SHM object of a producer
+// size: Size of the payload
+// return|void *: Pointer to the payload, NULL if the arena is full
+void *HSM_SHM_Alloc(HSM_SHM *This, uint32_t size);
+
+// Func: uint8_t HSM_SHM_Post(HSM_SHM *This, uint16_t target, HSM_EVENT event, void *payload)
+// Desc: Post an event to an HSM instance of the receiver, waking it up if it waits.  Lock-free, and events are
+//       run in the order they were posted by the producer
+// This: Pointer to HSM_SHM object of a producer
+// target: Index of the HSM instance given to HSM_SHM_Create()
+// event: HSM_EVENT to be run by HSM_SHM_Dispatch()
+// payload: Payload from the last HSM_SHM_Alloc(), passed as param, or NULL
+// return|uint8_t: 1 - event is posted, 0 - channel is full, event is not posted and may be retried
+uint8_t HSM_SHM_Post(HSM_SHM *This, uint16_t target, HSM_EVENT event, void *payload);
+
+// Func: uint32_t HSM_SHM_Dispatch(HSM_SHM *This)
+// Desc: Run the posted events of all channels on the HSM instances, with the payloads in place as param
+// This: Pointer to HSM_SHM object of the receiver
+// return|uint32_t: Number of events dispatched
+uint32_t HSM_SHM_Dispatch(HSM_SHM *This);
+
+// Func: uint8_t HSM_SHM_Wait(HSM_SHM *This, uint32_t timeout)
+// Desc: Sleep until an event is posted, for a receive loop calling HSM_SHM_Dispatch()
+// This: Pointer to HSM_SHM object of the receiver
+// timeout: Maximum time to sleep in ms
+// return|uint8_t: 1 - events are ready, 0 - timed out or interrupted
+uint8_t HSM_SHM_Wait(HSM_SHM *This, uint32_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HSM_FEATURE_SHM
+
+#endif // __HSM_SHM_H__
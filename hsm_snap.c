@@ -0,0 +1,228 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "hsm_snap.h"
+
+#if HSM_FEATURE_SNAPSHOT
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Offset of the user data, after the state IDs padded to 8 bytes
+#define HSM_SNAP_USER_OFFSET(count)     (sizeof(HSM_SNAP_HEADER) + (((uint64_t)(count) * sizeof(uint16_t) + 7) & ~7ULL))
+
+void HSM_SNAP_Create(HSM_SNAP *This, HSM_CHART *chart, const char *name, void *instances, uint32_t stride,
+                     uint32_t count, uint32_t userOffset, uint32_t userSize)
+{
+    This->chart = chart;
+    This->name = name;
+    This->instances = (uint8_t *)instances;
+    This->stride = stride;
+    This->count = count;
+    This->userOffset = userOffset;
+    This->userSize = userSize;
+}
+
+uint64_t HSM_SNAP_Size(HSM_SNAP *This)
+{
+    return HSM_SNAP_USER_OFFSET(This->count) + (uint64_t)This->count * This->userSize;
+}
+
+uint64_t HSM_SNAP_Save(HSM_SNAP *This, void *buf, uint64_t size)
+{
+    HSM_SNAP_HEADER *header = (HSM_SNAP_HEADER *)buf;
+    uint16_t *ids = (uint16_t *)(header + 1);
+    uint8_t *user = (uint8_t *)buf + HSM_SNAP_USER_OFFSET(This->count);
+    uint8_t *instance = This->instances;
+    uint64_t total = HSM_SNAP_Size(This);
+    uint32_t idx;
+    uint16_t id;
+
+    if (size < total)
+    {
+        return 0;
+    }
+    header->magic = HSM_SNAP_MAGIC;
+    header->version = HSM_SNAP_VERSION;
+    header->reserved = 0;
+    header->chartId = This->chart->id;
+    header->count = This->count;
+    header->userSize = This->userSize;
+    header->reserved2 = 0;
+    for (idx = 0; idx < This->count; idx++, instance += This->stride)
+    {
+        id = HSM_CHART_ID(This->chart, ((HSM *)instance)->curState);
+        if (id >= This->chart->count)
+        {
+            HSM_DEBUG("HSM_SNAP instance %u is not in a state of the chart", idx);
+            return 0;
+        }
+        ids[idx] = id;
+        if (This->userSize)
+        {
+            memcpy(user, instance + This->userOffset, This->userSize);
+            user += This->userSize;
+        }
+    }
+    // Clear the padding so identical instances give identical snapshots
+    for (idx = This->count; idx < (HSM_SNAP_USER_OFFSET(This->count) - sizeof(HSM_SNAP_HEADER)) / sizeof(uint16_t); idx++)
+    {
+        ids[idx] = 0;
+    }
+    return total;
+}
+
+uint8_t HSM_SNAP_Restore(HSM_SNAP *This, const void *buf, uint64_t size)
+{
+    const HSM_SNAP_HEADER *header = (const HSM_SNAP_HEADER *)buf;
+    const uint16_t *ids = (const uint16_t *)(header + 1);
+    const uint8_t *user = (const uint8_t *)buf + HSM_SNAP_USER_OFFSET(This->count);
+    uint8_t *instance = This->instances;
+    uint16_t states = This->chart->count;
+    uint16_t invalid = 0;
+    uint32_t idx;
+
+    // 1) Validate the snapshot, so nothing is restored from a bad one
+    if (size < sizeof(HSM_SNAP_HEADER) || header->magic != HSM_SNAP_MAGIC)
+    {
+        return HSM_SNAP_ERR_FORMAT;
+    }
+    if (header->version != HSM_SNAP_VERSION)
+    {
+        return HSM_SNAP_ERR_VERSION;
+    }
+    if (header->chartId != This->chart->id)
+    {
+        return HSM_SNAP_ERR_CHART;
+    }
+    if (header->count != This->count || header->userSize != This->userSize)
+    {
+        return HSM_SNAP_ERR_LAYOUT;
+    }
+    if (size < HSM_SNAP_Size(This))
+    {
+        return HSM_SNAP_ERR_FORMAT;
+    }
+    for (idx = 0; idx < This->count; idx++)
+    {
+        invalid |= (ids[idx] >= states);
+    }
+    if (invalid)
+    {
+        return HSM_SNAP_ERR_STATE;
+    }
+    // 2) Reinstate the current state of each instance
+    for (idx = 0; idx < This->count; idx++, instance += This->stride)
+    {
+        HSM_Restore((HSM *)instance, This->name, HSM_CHART_STATE(This->chart, ids[idx]));
+        if (This->userSize)
+        {
+            memcpy(instance + This->userOffset, user, This->userSize);
+            user += This->userSize;
+        }
+    }
+    return HSM_SNAP_OK;
+}
+
+uint8_t HSM_SNAP_SaveFile(HSM_SNAP *This, const char *path)
+{
+    uint64_t size = HSM_SNAP_Size(This);
+    uint8_t result = HSM_SNAP_ERR_FILE;
+    char tmp[PATH_MAX];
+    void *buf;
+    int fd;
+    // Write path.tmp and rename it over path once synced, so a crash never leaves a partial snapshot at path
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+    {
+        return HSM_SNAP_ERR_FILE;
+    }
+    fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return HSM_SNAP_ERR_FILE;
+    }
+    if (0 == ftruncate(fd, size))
+    {
+        buf = mmap(((void *)0), size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (MAP_FAILED != buf)
+        {
+            if (HSM_SNAP_Save(This, buf, size))
+            {
+                result = HSM_SNAP_OK;
+            }
+            munmap(buf, size);
+        }
+    }
+    if (HSM_SNAP_OK == result && (fsync(fd) < 0 || rename(tmp, path) < 0))
+    {
+        result = HSM_SNAP_ERR_FILE;
+    }
+    close(fd);
+    if (HSM_SNAP_OK != result)
+    {
+        unlink(tmp);
+    }
+    return result;
+}
+
+uint8_t HSM_SNAP_RestoreFile(HSM_SNAP *This, const char *path)
+{
+    uint8_t result = HSM_SNAP_ERR_FILE;
+    struct stat st;
+    void *buf;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return HSM_SNAP_ERR_FILE;
+    }
+    if (0 == fstat(fd, &st))
+    {
+        if (st.st_size < (off_t)sizeof(HSM_SNAP_HEADER))
+        {
+            result = HSM_SNAP_ERR_FORMAT;
+        }
+        else
+        {
+#ifdef MAP_POPULATE
+            // Read the whole file up front instead of faulting in each page
+            buf = mmap(((void *)0), st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+#else
+            buf = mmap(((void *)0), st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+#endif // MAP_POPULATE
+            if (MAP_FAILED != buf)
+            {
+                result = HSM_SNAP_Restore(This, buf, st.st_size);
+                munmap(buf, st.st_size);
+            }
+        }
+    }
+    close(fd);
+    return result;
+}
+#endif // HSM_FEATURE_SNAPSHOT
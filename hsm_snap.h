@@ -0,0 +1,140 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __HSM_SNAP_H__
+#define __HSM_SNAP_H__
+
+#include "hsm_chart.h"
+
+#if HSM_FEATURE_SNAPSHOT
+#if !HSM_FEATURE_CHART
+#error "HSM_FEATURE_SNAPSHOT requires HSM_FEATURE_CHART"
+#endif // !HSM_FEATURE_CHART
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----Snapshot definitions----
+// Snapshot layout, in host byte order:
+//   HSM_SNAP_HEADER
+//   uint16_t state ID of each instance, padded to a multiple of 8 bytes
+//   userSize bytes of user data of each instance
+#define HSM_SNAP_MAGIC          0x534D5348  // "HSMS"
+#define HSM_SNAP_VERSION        1
+// Results of HSM_SNAP_Restore()
+#define HSM_SNAP_OK             0
+#define HSM_SNAP_ERR_FORMAT     1   // Not a snapshot, truncated or saved on a host of different byte order
+#define HSM_SNAP_ERR_VERSION    2   // Snapshot version is not supported
+#define HSM_SNAP_ERR_CHART      3   // Snapshot was saved with another chart
+#define HSM_SNAP_ERR_LAYOUT     4   // Number of instances or user data size differ
+#define HSM_SNAP_ERR_STATE      5   // State ID is not in the chart
+#define HSM_SNAP_ERR_FILE       6   // File could not be opened, mapped or written
+
+//----Structure declaration----
+typedef struct HSM_SNAP_HEADER_T
+{
+    uint32_t magic;             // HSM_SNAP_MAGIC
+    uint16_t version;           // HSM_SNAP_VERSION
+    uint16_t reserved;
+    uint32_t chartId;           // ID of the chart, see HSM_CHART_Freeze()
+    uint32_t count;             // Number of instances
+    uint32_t userSize;          // Bytes of user data per instance
+    uint32_t reserved2;
+} HSM_SNAP_HEADER;
+
+// Describes an array of instances of a chart.  Each instance is a user structure whose first member is its HSM
+// object (e.g. CAMERA), and may hold user data at a fixed offset that is saved as an opaque blob
+typedef struct HSM_SNAP_T
+{
+    HSM_CHART *chart;           // Chart of the instances
+    const char *name;           // Name of the restored instances (for debugging)
+    uint8_t *instances;         // First instance
+    uint32_t stride;            // Bytes between instances, e.g. sizeof(CAMERA)
+    uint32_t count;             // Number of instances
+    uint32_t userOffset;        // Offset of the user data in each instance
+    uint32_t userSize;          // Bytes of user data per instance, 0 for none
+} HSM_SNAP;
+
+//----Function Declarations----
+// Func: void HSM_SNAP_Create(HSM_SNAP *This, HSM_CHART *chart, const char *name, void *instances, uint32_t stride,
+//                            uint32_t count, uint32_t userOffset, uint32_t userSize)
+// Desc: Describe the array of instances saved and restored by a snapshot
+// This: Pointer to HSM_SNAP object
+// chart: Pointer to HSM_CHART of the instances, already frozen
+// name: Name of the restored instances (for debugging)
+// instances: Pointer to the first instance, starting with its HSM object
+// stride: Bytes between instances
+// count: Number of instances
+// userOffset: Offset of the user data in each instance
+// userSize: Bytes of user data per instance, 0 for none
+void HSM_SNAP_Create(HSM_SNAP *This, HSM_CHART *chart, const char *name, void *instances, uint32_t stride,
+                     uint32_t count, uint32_t userOffset, uint32_t userSize);
+
+// Func: uint64_t HSM_SNAP_Size(HSM_SNAP *This)
+// Desc: Get the size of the snapshot
+// This: Pointer to HSM_SNAP object
+// return|uint64_t: Size of the snapshot in bytes
+uint64_t HSM_SNAP_Size(HSM_SNAP *This);
+
+// Func: uint64_t HSM_SNAP_Save(HSM_SNAP *This, void *buf, uint64_t size)
+// Desc: Save the current state and user data of each instance.  Every instance must be in a state of the chart
+// This: Pointer to HSM_SNAP object
+// buf: Buffer of the snapshot, aligned to 8 bytes
+// size: Size of the buffer
+// return|uint64_t: Size of the snapshot, 0 if the buffer is too small
+uint64_t HSM_SNAP_Save(HSM_SNAP *This, void *buf, uint64_t size);
+
+// Func: uint8_t HSM_SNAP_Restore(HSM_SNAP *This, const void *buf, uint64_t size)
+// Desc: Restore each instance to its saved state with HSM_Restore(), without invoking HSME_ENTRY and HSME_INIT,
+//       and copy back its user data.  The snapshot is validated before any instance is restored
+// This: Pointer to HSM_SNAP object
+// buf: Snapshot, aligned to 8 bytes
+// size: Size of the snapshot
+// return|uint8_t: HSM_SNAP_OK, or HSM_SNAP_ERR_*
+uint8_t HSM_SNAP_Restore(HSM_SNAP *This, const void *buf, uint64_t size);
+
+// Func: uint8_t HSM_SNAP_SaveFile(HSM_SNAP *This, const char *path)
+// Desc: Save the snapshot to a file through a memory mapping.  The snapshot is written to path.tmp, synced and
+//       renamed over path, so a previous snapshot is replaced atomically
+// This: Pointer to HSM_SNAP object
+// path: Path of the snapshot file
+// return|uint8_t: HSM_SNAP_OK, or HSM_SNAP_ERR_FILE
+uint8_t HSM_SNAP_SaveFile(HSM_SNAP *This, const char *path);
+
+// Func: uint8_t HSM_SNAP_RestoreFile(HSM_SNAP *This, const char *path)
+// Desc: Restore the instances from a memory mapped snapshot file
+// This: Pointer to HSM_SNAP object
+// path: Path of the snapshot file
+// return|uint8_t: HSM_SNAP_OK, or HSM_SNAP_ERR_*
+uint8_t HSM_SNAP_RestoreFile(HSM_SNAP *This, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HSM_FEATURE_SNAPSHOT
+
+#endif // __HSM_SNAP_H__
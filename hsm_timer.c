@@ -0,0 +1,282 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "hsm_timer.h"
+
+#if HSM_FEATURE_TIMER
+#ifndef HSM_TIMER_CLOCK
+#include <time.h>
+
+static uint64_t HSM_TimerClockDefault(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#define HSM_TIMER_CLOCK HSM_TimerClockDefault
+#endif // HSM_TIMER_CLOCK
+
+// Hierarchical timing wheel: Level 0 has one slot per tick, level n has one slot per 2^(n * HSM_TIMER_WHEEL_BITS)
+// ticks.  A timer is placed on the lowest level that covers its remaining ticks, and is cascaded to a lower level
+// when the ticks of the lower level wrap around to its slot.  Arm, disarm and expiry are O(1)
+#define HSM_TIMER_RANGE         ((uint64_t)1 << (HSM_TIMER_WHEEL_BITS * HSM_TIMER_WHEEL_LEVELS))
+
+static void HSM_TIMER_Insert(HSM_TIMER_WHEEL *This, HSM_TIMER *timer)
+{
+    uint32_t expire = timer->expire;
+    uint32_t delta = expire - This->now;
+    uint8_t level;
+    HSM_TIMER **slot;
+    if (delta >= HSM_TIMER_RANGE)
+    {
+        // Park in the last slot in range, the timer is placed again when cascaded
+        delta = (uint32_t)(HSM_TIMER_RANGE - 1);
+        expire = This->now + delta;
+    }
+    for (level = 0; level < HSM_TIMER_WHEEL_LEVELS - 1; level++)
+    {
+        if (delta < (1UL << ((level + 1) * HSM_TIMER_WHEEL_BITS)))
+        {
+            break;
+        }
+    }
+    slot = &This->slot[level][(expire >> (level * HSM_TIMER_WHEEL_BITS)) & HSM_TIMER_MASK];
+    timer->next = *slot;
+    if (timer->next)
+    {
+        timer->next->link = &timer->next;
+    }
+    timer->link = slot;
+    *slot = timer;
+}
+
+static void HSM_TIMER_Unlink(HSM_TIMER *timer)
+{
+    *timer->link = timer->next;
+    if (timer->next)
+    {
+        timer->next->link = timer->link;
+    }
+}
+
+static void HSM_TIMER_Release(HSM_TIMER *timer)
+{
+    // Remove from the list of the HSM instance
+    *timer->hsmLink = timer->hsmNext;
+    if (timer->hsmNext)
+    {
+        timer->hsmNext->hsmLink = timer->hsmLink;
+    }
+    timer->hsmLink = ((void *)0);
+    timer->wheel->armed--;
+    timer->wheel = ((void *)0);
+}
+
+static uint32_t HSM_TIMER_Tick(HSM_TIMER_WHEEL *This)
+{
+    uint32_t cnt = 0;
+    uint8_t level;
+    HSM_TIMER **slot;
+    HSM_TIMER *timer;
+
+    This->now++;
+    // 1) Cascade the higher levels whose lower level wrapped around
+    for (level = 1; level < HSM_TIMER_WHEEL_LEVELS; level++)
+    {
+        if (This->now & ((1UL << (level * HSM_TIMER_WHEEL_BITS)) - 1))
+        {
+            break;
+        }
+        slot = &This->slot[level][(This->now >> (level * HSM_TIMER_WHEEL_BITS)) & HSM_TIMER_MASK];
+        timer = *slot;
+        *slot = ((void *)0);
+        while (timer)
+        {
+            HSM_TIMER *next = timer->next;
+            HSM_TIMER_Insert(This, timer);
+            timer = next;
+        }
+    }
+    // 2) Run the expired timers.  Timers armed or re-armed here expire at least one tick later, so never in this slot
+    slot = &This->slot[0][This->now & HSM_TIMER_MASK];
+    while ((timer = *slot))
+    {
+        HSM_TIMER_Unlink(timer);
+        if (timer->period)
+        {
+            timer->expire += timer->period;
+            HSM_TIMER_Insert(This, timer);
+        }
+        else
+        {
+            HSM_TIMER_Release(timer);
+        }
+        HSM_Run(timer->hsm, timer->event, timer->param);
+        cnt++;
+    }
+    return cnt;
+}
+
+// Returns the number of ticks up to max that have no expiry and no cascade, so they can be skipped
+static uint32_t HSM_TIMER_Idle(HSM_TIMER_WHEEL *This, uint32_t max)
+{
+    uint32_t idle;
+    uint32_t tick;
+    if (0 == This->armed)
+    {
+        return max;
+    }
+    for (idle = 0; idle < max; idle++)
+    {
+        tick = This->now + idle + 1;
+        if (0 == (tick & HSM_TIMER_MASK) || This->slot[0][tick & HSM_TIMER_MASK])
+        {
+            break;
+        }
+    }
+    return idle;
+}
+
+void HSM_TIMER_WHEEL_Create(HSM_TIMER_WHEEL *This, uint64_t tickNs)
+{
+    uint8_t level;
+    uint32_t idx;
+    for (level = 0; level < HSM_TIMER_WHEEL_LEVELS; level++)
+    {
+        for (idx = 0; idx < HSM_TIMER_SLOTS; idx++)
+        {
+            This->slot[level][idx] = ((void *)0);
+        }
+    }
+    This->now = 0;
+    This->armed = 0;
+    This->tickNs = tickNs;
+    This->lastNs = (HSM_TIMER_VIRTUAL == tickNs) ? 0 : HSM_TIMER_CLOCK();
+}
+
+uint32_t HSM_TIMER_Advance(HSM_TIMER_WHEEL *This, uint32_t ticks)
+{
+    uint32_t cnt = 0;
+    uint32_t idle;
+    while (ticks)
+    {
+        idle = HSM_TIMER_Idle(This, ticks);
+        This->now += idle;
+        ticks -= idle;
+        if (ticks)
+        {
+            cnt += HSM_TIMER_Tick(This);
+            ticks--;
+        }
+    }
+    return cnt;
+}
+
+uint32_t HSM_TIMER_Poll(HSM_TIMER_WHEEL *This)
+{
+    uint32_t cnt = 0;
+    uint64_t ticks;
+    if (HSM_TIMER_VIRTUAL == This->tickNs)
+    {
+        // Jump to the next tick with expiries
+        while (This->armed && 0 == cnt)
+        {
+            cnt = HSM_TIMER_Advance(This, HSM_TIMER_Idle(This, 0xFFFFFFFE) + 1);
+        }
+        return cnt;
+    }
+    ticks = (HSM_TIMER_CLOCK() - This->lastNs) / This->tickNs;
+    This->lastNs += ticks * This->tickNs;
+    for (; ticks > 0xFFFFFFFF; ticks -= 0xFFFFFFFF)
+    {
+        cnt += HSM_TIMER_Advance(This, 0xFFFFFFFF);
+    }
+    return cnt + HSM_TIMER_Advance(This, (uint32_t)ticks);
+}
+
+void HSM_TIMER_Create(HSM_TIMER *This, HSM *hsm, HSM_EVENT event, void *param)
+{
+    This->wheel = ((void *)0);
+    This->hsmLink = ((void *)0);
+    This->hsm = hsm;
+    This->owner = ((void *)0);
+    This->event = event;
+    This->param = param;
+}
+
+void HSM_TIMER_Arm(HSM_TIMER *This, HSM_TIMER_WHEEL *wheel, HSM_STATE *owner, uint32_t ticks, uint32_t period)
+{
+    HSM_TIMER_Disarm(This);
+    This->wheel = wheel;
+    This->owner = owner;
+    This->period = period;
+    This->expire = wheel->now + (ticks ? ticks : 1);
+    HSM_TIMER_Insert(wheel, This);
+    wheel->armed++;
+    // Track the timer on the HSM instance, so HSM_Tran() can disarm it on HSME_EXIT of the owner, and HSM_Destroy()
+    // can disarm all of them
+    This->hsmNext = This->hsm->timers;
+    if (This->hsmNext)
+    {
+        This->hsmNext->hsmLink = &This->hsmNext;
+    }
+    This->hsmLink = &This->hsm->timers;
+    This->hsm->timers = This;
+}
+
+uint8_t HSM_TIMER_Disarm(HSM_TIMER *This)
+{
+    if (((void *)0) == This->wheel)
+    {
+        return 0;
+    }
+    HSM_TIMER_Unlink(This);
+    HSM_TIMER_Release(This);
+    return 1;
+}
+
+void HSM_TIMER_CancelState(HSM *hsm, HSM_STATE *state)
+{
+    HSM_TIMER *timer = hsm->timers;
+    HSM_TIMER *next;
+    while (timer)
+    {
+        next = timer->hsmNext;
+        if (timer->owner == state)
+        {
+            HSM_TIMER_Disarm(timer);
+        }
+        timer = next;
+    }
+}
+
+void HSM_TIMER_CancelAll(HSM *hsm)
+{
+    while (hsm->timers)
+    {
+        HSM_TIMER_Disarm(hsm->timers);
+    }
+}
+#endif // HSM_FEATURE_TIMER
@@ -0,0 +1,137 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __HSM_TIMER_H__
+#define __HSM_TIMER_H__
+
+#include "hsm.h"
+
+#if HSM_FEATURE_TIMER
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----Timer definitions----
+#define HSM_TIMER_SLOTS         (1UL << HSM_TIMER_WHEEL_BITS)
+#define HSM_TIMER_MASK          (HSM_TIMER_SLOTS - 1)
+// Tick period of the virtual clock, see HSM_TIMER_WHEEL_Create()
+#define HSM_TIMER_VIRTUAL       0
+
+//----Structure declaration----
+typedef struct HSM_TIMER_WHEEL_T HSM_TIMER_WHEEL;
+typedef struct HSM_TIMER_T HSM_TIMER;
+
+struct HSM_TIMER_T
+{
+    HSM_TIMER *next;            // Next timer in the wheel slot
+    HSM_TIMER **link;           // Link pointing to this timer in the wheel slot
+    HSM_TIMER *hsmNext;         // Next timer in the HSM instance list
+    HSM_TIMER **hsmLink;        // Link pointing to this timer in the HSM instance list, NULL if disarmed
+    HSM_TIMER_WHEEL *wheel;     // Wheel the timer is armed on, NULL if disarmed
+    HSM *hsm;                   // HSM instance the event is run on
+    HSM_STATE *owner;           // State whose HSME_EXIT disarms the timer
+    HSM_EVENT event;            // Event run on expiry
+    void *param;                // Parameter associated with the event
+    uint32_t expire;            // Tick of expiry
+    uint32_t period;            // Ticks between periodic expiries, 0 for one-shot
+};
+
+struct HSM_TIMER_WHEEL_T
+{
+    HSM_TIMER *slot[HSM_TIMER_WHEEL_LEVELS][HSM_TIMER_SLOTS]; // Wheel level n holds timers due in 2^(n * bits) tick units
+    uint32_t now;               // Ticks processed
+    uint32_t armed;             // Number of armed timers
+    uint64_t tickNs;            // Tick period in ns, or HSM_TIMER_VIRTUAL
+    uint64_t lastNs;            // Clock of the last tick processed by HSM_TIMER_Poll()
+};
+
+//----Function Declarations----
+// Func: void HSM_TIMER_WHEEL_Create(HSM_TIMER_WHEEL *This, uint64_t tickNs)
+// Desc: Create a timer wheel.  The wheel and its timers are not thread safe, and must be driven by the thread running
+//       the HSM instances
+// This: Pointer to HSM_TIMER_WHEEL object
+// tickNs: Tick period in ns for HSM_TIMER_Poll(), or HSM_TIMER_VIRTUAL to run the timers as fast as possible
+void HSM_TIMER_WHEEL_Create(HSM_TIMER_WHEEL *This, uint64_t tickNs);
+
+// Func: uint32_t HSM_TIMER_Advance(HSM_TIMER_WHEEL *This, uint32_t ticks)
+// Desc: Advance the wheel by ticks, running the event of each expired timer with HSM_Run().  Ticks without expiries
+//       are skipped quickly
+// This: Pointer to HSM_TIMER_WHEEL object
+// ticks: Number of ticks elapsed
+// return|uint32_t: Number of expired timers
+uint32_t HSM_TIMER_Advance(HSM_TIMER_WHEEL *This, uint32_t ticks);
+
+// Func: uint32_t HSM_TIMER_Poll(HSM_TIMER_WHEEL *This)
+// Desc: Advance the wheel by the ticks elapsed since the last poll.  With HSM_TIMER_VIRTUAL, the clock jumps to the
+//       next tick that has expiries instead
+// This: Pointer to HSM_TIMER_WHEEL object
+// return|uint32_t: Number of expired timers, 0 if the virtual clock has no armed timer left
+uint32_t HSM_TIMER_Poll(HSM_TIMER_WHEEL *This);
+
+// Func: void HSM_TIMER_Create(HSM_TIMER *This, HSM *hsm, HSM_EVENT event, void *param)
+// Desc: Create a disarmed timer that runs an event on an HSM instance
+// This: Pointer to HSM_TIMER object
+// hsm: Pointer to HSM instance
+// event: HSM_EVENT run on expiry
+// param: Parameter associated with HSM_EVENT
+void HSM_TIMER_Create(HSM_TIMER *This, HSM *hsm, HSM_EVENT event, void *param);
+
+// Func: void HSM_TIMER_Arm(HSM_TIMER *This, HSM_TIMER_WHEEL *wheel, HSM_STATE *owner, uint32_t ticks, uint32_t period)
+// Desc: Arm or re-arm the timer in O(1).  Safe to call from a state handler, including the handler of an expiry
+// This: Pointer to HSM_TIMER object
+// wheel: Pointer to HSM_TIMER_WHEEL object
+// owner: State that arms the timer, the timer is disarmed when the state handles HSME_EXIT.  NULL to keep it armed
+// ticks: Ticks until the first expiry, at least 1
+// period: Ticks between the following expiries, 0 for a one-shot timer
+void HSM_TIMER_Arm(HSM_TIMER *This, HSM_TIMER_WHEEL *wheel, HSM_STATE *owner, uint32_t ticks, uint32_t period);
+
+// Func: uint8_t HSM_TIMER_Disarm(HSM_TIMER *This)
+// Desc: Disarm the timer in O(1)
+// This: Pointer to HSM_TIMER object
+// return|uint8_t: 1 - timer was armed, 0 - otherwise
+uint8_t HSM_TIMER_Disarm(HSM_TIMER *This);
+
+// Use this macro to test whether a timer is armed
+#define HSM_TIMER_IsArmed(timer)    ((timer)->wheel != ((void *)0))
+
+// Func: void HSM_TIMER_CancelState(HSM *hsm, HSM_STATE *state)
+// Desc: Disarm the timers of an HSM instance owned by a state.  Called by HSM_Tran() after HSME_EXIT of each state
+// hsm: Pointer to HSM instance
+// state: Pointer to the owner HSM_STATE
+void HSM_TIMER_CancelState(HSM *hsm, HSM_STATE *state);
+
+// Func: void HSM_TIMER_CancelAll(HSM *hsm)
+// Desc: Disarm all the timers of an HSM instance, including those armed without owner.  Called by HSM_Destroy()
+// hsm: Pointer to HSM instance
+void HSM_TIMER_CancelAll(HSM *hsm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HSM_FEATURE_TIMER
+
+#endif // __HSM_TIMER_H__
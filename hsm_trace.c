@@ -0,0 +1,176 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "hsm_trace.h"
+
+#if HSM_FEATURE_TRACE
+#include <stdio.h>
+#ifndef HSM_TRACE_CLOCK
+#include <time.h>
+
+static uint64_t HSM_TraceClockDefault(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#define HSM_TRACE_CLOCK HSM_TraceClockDefault
+#endif // HSM_TRACE_CLOCK
+
+// Each thread writes to its own ring without locks or formatting, the records keep the pointers to the instance
+// and the states so the names are only looked up by the consumer
+static _Thread_local HSM_TRACE_RING *pstHsmTraceRing;
+static HSM_TRACE_RING *pstHsmTraceRings;
+
+#if HSM_FEATURE_DEBUG_ENABLE && HSM_FEATURE_DEBUG_NESTED_CALL
+#define HSM_TRACE_DEPTH_NOW()   (gucHsmNestLevel)
+#else
+#define HSM_TRACE_DEPTH_NOW()   (0)
+#endif // HSM_FEATURE_DEBUG_ENABLE && HSM_FEATURE_DEBUG_NESTED_CALL
+
+void HSM_TRACE_Attach(HSM_TRACE_RING *This, const char *name)
+{
+    This->name = name;
+    This->head = 0;
+    This->tailCache = 0;
+    This->dropped = 0;
+    This->tail = 0;
+    // Push on the list of rings, which are never removed
+    This->next = __atomic_load_n(&pstHsmTraceRings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&pstHsmTraceRings, &This->next, This, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    pstHsmTraceRing = This;
+}
+
+void HSM_TRACE_Write(HSM *hsm, uint8_t show, uint8_t kind, HSM_STATE *state, HSM_EVENT event, uintptr_t aux)
+{
+    HSM_TRACE_RING *ring = pstHsmTraceRing;
+    HSM_TRACE_REC *rec;
+    uint64_t head;
+
+    if (((void *)0) == ring)
+    {
+        return;
+    }
+    head = ring->head;
+    if (head - ring->tailCache >= HSM_TRACE_DEPTH)
+    {
+        // Only read the tail of the consumer when the ring looks full
+        ring->tailCache = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (head - ring->tailCache >= HSM_TRACE_DEPTH)
+        {
+            __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+    rec = &ring->rec[head & (HSM_TRACE_DEPTH - 1)];
+    rec->time = HSM_TRACE_CLOCK();
+    rec->aux = aux;
+    rec->hsm = hsm;
+    rec->state = state;
+    rec->event = event;
+    rec->kind = kind;
+    rec->show = show;
+    rec->depth = HSM_TRACE_DEPTH_NOW();
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t HSM_TRACE_Drain(HSM_TRACE_RING *This, HSM_TRACE_FN fn, void *ctx)
+{
+    uint64_t tail = This->tail;
+    uint64_t head = __atomic_load_n(&This->head, __ATOMIC_ACQUIRE);
+    uint32_t count = (uint32_t)(head - tail);
+    for (; tail != head; tail++)
+    {
+        fn(ctx, &This->rec[tail & (HSM_TRACE_DEPTH - 1)]);
+    }
+    // Hand the records back to the producer
+    __atomic_store_n(&This->tail, tail, __ATOMIC_RELEASE);
+    return count;
+}
+
+uint32_t HSM_TRACE_DrainAll(HSM_TRACE_FN fn, void *ctx)
+{
+    HSM_TRACE_RING *ring;
+    uint32_t count = 0;
+    for (ring = __atomic_load_n(&pstHsmTraceRings, __ATOMIC_ACQUIRE); ring; ring = ring->next)
+    {
+        count += HSM_TRACE_Drain(ring, fn, ctx);
+    }
+    return count;
+}
+
+uint64_t HSM_TRACE_Dropped(HSM_TRACE_RING *This)
+{
+    return __atomic_load_n(&This->dropped, __ATOMIC_RELAXED);
+}
+
+void HSM_TRACE_Print(void *ctx, const HSM_TRACE_REC *rec)
+{
+    FILE *file = (FILE *)ctx;
+    const char *kind[] = { "", "", "", "EXIT", "ENTRY", "INIT" };
+#if HSM_FEATURE_DEBUG_ENABLE
+    const char *color = (rec->show & HSM_SHOW_RUN) ? HSM_COLOR_BLU : HSM_COLOR_CYN;
+    const char *name = rec->hsm->name;
+#if HSM_FEATURE_DEBUG_NESTED_CALL
+    fprintf(file, "%s%s%s", color, apucHsmNestIndent[rec->depth < 5 ? rec->depth : 5], rec->hsm->prefix);
+#else
+    fprintf(file, "%s%s", color, rec->hsm->prefix);
+#endif // HSM_FEATURE_DEBUG_NESTED_CALL
+#else
+    char name[20];
+    snprintf(name, sizeof(name), "%p", (void *)rec->hsm);
+#endif // HSM_FEATURE_DEBUG_ENABLE
+    switch (rec->kind)
+    {
+    case HSM_TRACE_RUN:
+#ifdef HSM_DEBUG_EVT2STR
+        fprintf(file, "Run %s[%s](evt:%s, param:%08lx)", name, rec->state->name, HSM_DEBUG_EVT2STR(rec->event),
+                (unsigned long)rec->aux);
+#else
+        fprintf(file, "Run %s[%s](evt:%lx, param:%08lx)", name, rec->state->name, (unsigned long)rec->event,
+                (unsigned long)rec->aux);
+#endif // HSM_DEBUG_EVT2STR
+        break;
+    case HSM_TRACE_PASS:
+#ifdef HSM_DEBUG_EVT2STR
+        fprintf(file, "  evt:%s unhandled, passing to %s[%s]", HSM_DEBUG_EVT2STR(rec->event), name, rec->state->name);
+#else
+        fprintf(file, "  evt:%lx unhandled, passing to %s[%s]", (unsigned long)rec->event, name, rec->state->name);
+#endif // HSM_DEBUG_EVT2STR
+        break;
+    case HSM_TRACE_TRAN:
+        fprintf(file, "Tran %s[%s -> %s]", name, rec->state->name, ((HSM_STATE *)(uintptr_t)rec->aux)->name);
+        break;
+    default:
+        fprintf(file, "  %s[%s](%s)", name, rec->state->name, kind[rec->kind]);
+        break;
+    }
+#if HSM_FEATURE_DEBUG_ENABLE
+    fprintf(file, HSM_COLOR_NON HSM_NEWLINE);
+#else
+    fprintf(file, HSM_NEWLINE);
+#endif // HSM_FEATURE_DEBUG_ENABLE
+}
+#endif // HSM_FEATURE_TRACE
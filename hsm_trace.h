@@ -0,0 +1,141 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __HSM_TRACE_H__
+#define __HSM_TRACE_H__
+
+#include "hsm.h"
+
+#if HSM_FEATURE_TRACE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----Trace definitions----
+// Kinds of record, one per message of HSM_DEBUGC1/2/3
+#define HSM_TRACE_RUN           0   // HSM_Run() in state, aux is param
+#define HSM_TRACE_PASS          1   // Event unhandled, passed to state
+#define HSM_TRACE_TRAN          2   // HSM_Tran() from state, aux is the next state
+#define HSM_TRACE_EXIT          3   // HSME_EXIT of state
+#define HSM_TRACE_ENTRY         4   // HSME_ENTRY of state
+#define HSM_TRACE_INIT          5   // HSME_INIT of state
+#if !HSM_FEATURE_DEBUG_ENABLE
+// Same as the debug options of hsm.h, without the run-time filter all the records are written
+#define HSM_SHOW_RUN            (1)
+#define HSM_SHOW_TRAN           (2)
+#define HSM_SHOW_INTACT         (4)
+#endif // !HSM_FEATURE_DEBUG_ENABLE
+
+// Records the interaction in the ring buffer of the thread, if HSM_SET_DEBUG() enabled show for the instance
+#if HSM_FEATURE_DEBUG_ENABLE
+#define HSM_TRACE(show, kind, state, event, aux) \
+    { if (This->hsmDebug & (show)) HSM_TRACE_Write(This, (show), (kind), (state), (event), (uintptr_t)(aux)); }
+#else
+#define HSM_TRACE(show, kind, state, event, aux) \
+    { HSM_TRACE_Write(This, (show), (kind), (state), (event), (uintptr_t)(aux)); }
+#endif // HSM_FEATURE_DEBUG_ENABLE
+
+//----Structure declaration----
+typedef struct HSM_TRACE_REC_T
+{
+    uint64_t time;              // Clock of the record in ns
+    uint64_t aux;               // param of HSM_TRACE_RUN, next state of HSM_TRACE_TRAN
+    HSM *hsm;                   // HSM instance
+    HSM_STATE *state;           // State of the interaction
+    HSM_EVENT event;            // Event of the interaction
+    uint8_t kind;               // HSM_TRACE_RUN .. HSM_TRACE_INIT
+    uint8_t show;               // HSM_SHOW_RUN, HSM_SHOW_TRAN or HSM_SHOW_INTACT
+    uint8_t depth;              // Nesting of HSM_Run() calls, with HSM_FEATURE_DEBUG_NESTED_CALL
+    uint8_t reserved;
+} HSM_TRACE_REC;
+
+// Single producer, single consumer ring of records.  The thread running the HSM instances writes, a flusher reads
+typedef struct HSM_TRACE_RING_T
+{
+    HSM_TRACE_REC rec[HSM_TRACE_DEPTH];
+    struct HSM_TRACE_RING_T *next; // Next ring attached, for HSM_TRACE_DrainAll()
+    const char *name;           // Name of the thread (for debugging)
+    _Alignas(HSM_CACHE_LINE) uint64_t head; // Next record written by the producer
+    uint64_t tailCache;         // Last tail seen by the producer
+    uint64_t dropped;           // Records dropped because the ring was full
+    _Alignas(HSM_CACHE_LINE) uint64_t tail; // Next record read by the consumer
+} HSM_TRACE_RING;
+
+// Called by HSM_TRACE_Drain() for each record, in the order written
+typedef void (*HSM_TRACE_FN)(void *ctx, const HSM_TRACE_REC *rec);
+
+//----Function Declarations----
+// Func: void HSM_TRACE_Attach(HSM_TRACE_RING *This, const char *name)
+// Desc: Create a ring buffer and attach it to the calling thread, whose interactions are then recorded.  The ring
+//       must outlive the thread, and the states and instances traced must outlive the drain of their records
+// This: Pointer to HSM_TRACE_RING object
+// name: Name of the thread (for debugging)
+void HSM_TRACE_Attach(HSM_TRACE_RING *This, const char *name);
+
+// Func: void HSM_TRACE_Write(HSM *hsm, uint8_t show, uint8_t kind, HSM_STATE *state, HSM_EVENT event, uintptr_t aux)
+// Desc: Write a record to the ring of the calling thread without blocking.  Called through HSM_TRACE()
+// hsm: Pointer to HSM instance
+// show: HSM_SHOW_RUN, HSM_SHOW_TRAN or HSM_SHOW_INTACT
+// kind: HSM_TRACE_RUN .. HSM_TRACE_INIT
+// state: State of the interaction
+// event: Event of the interaction
+// aux: param of HSM_TRACE_RUN, next state of HSM_TRACE_TRAN
+void HSM_TRACE_Write(HSM *hsm, uint8_t show, uint8_t kind, HSM_STATE *state, HSM_EVENT event, uintptr_t aux);
+
+// Func: uint32_t HSM_TRACE_Drain(HSM_TRACE_RING *This, HSM_TRACE_FN fn, void *ctx)
+// Desc: Pass the records written so far to fn.  Must only be called by a single consumer thread
+// This: Pointer to HSM_TRACE_RING object
+// fn: Function called for each record
+// ctx: Context passed to fn
+// return|uint32_t: Number of records drained
+uint32_t HSM_TRACE_Drain(HSM_TRACE_RING *This, HSM_TRACE_FN fn, void *ctx);
+
+// Func: uint32_t HSM_TRACE_DrainAll(HSM_TRACE_FN fn, void *ctx)
+// Desc: Drain the rings of all the threads, one ring after the other
+// fn: Function called for each record
+// ctx: Context passed to fn
+// return|uint32_t: Number of records drained
+uint32_t HSM_TRACE_DrainAll(HSM_TRACE_FN fn, void *ctx);
+
+// Func: uint64_t HSM_TRACE_Dropped(HSM_TRACE_RING *This)
+// Desc: Get the number of records dropped because the consumer fell behind
+// This: Pointer to HSM_TRACE_RING object
+// return|uint64_t: Number of records dropped
+uint64_t HSM_TRACE_Dropped(HSM_TRACE_RING *This);
+
+// Func: void HSM_TRACE_Print(void *ctx, const HSM_TRACE_REC *rec)
+// Desc: HSM_TRACE_FN that prints a record as HSM_DEBUGC1/2/3 would have, in color if HSM_FEATURE_DEBUG_COLOR
+// ctx: FILE * to print to
+// rec: Pointer to the record
+void HSM_TRACE_Print(void *ctx, const HSM_TRACE_REC *rec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HSM_FEATURE_TRACE
+
+#endif // __HSM_TRACE_H__
@@ -0,0 +1,435 @@
+"""
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+"""
+
+# HSM chart compiler in Python 3
+# Reads a chart in SCXML or in a subset of PlantUML and generates the C code of the chart for hsm.h:
+#   <out>.h - The events, the states, the create function and the prototypes of the actions to implement
+#   <out>.c - The states as static HSM_STATE tables and a switch based handler per state.  The handler of each
+#             leaf state also handles the events of its parent states, and each transition replays a precomputed
+#             exit/entry path with HSM_TranDirect() that already includes the initial substates of the target
+#   <out>_actions.c - Stubs of the actions, only written with -s when the file does not exist
+#
+# Usage: python3 hsmgen.py [-p PREFIX] [-o out] [-s] chart.scxml|chart.puml
+#
+# SCXML: <state>, <initial>, the initial attribute, <onentry>, <onexit> and <transition> with event, target and
+#        cond.  A transition without target is an internal transition.  The content of <onentry>, <onexit> and
+#        <transition> is copied in the comment of the action stub, and cond is a C expression where This and
+#        param are in scope.  <parallel>, <history> and <final> are not supported.
+# PlantUML: "state X", "state X {" ... "}", "[*] --> X", "A --> B : EVENT [cond] / action",
+#           "X : entry / action", "X : exit / action" and "X : EVENT [cond] / action" for internal transitions.
+import argparse
+import os
+import re
+import sys
+import xml.etree.ElementTree as ET
+
+class ChartError(Exception):
+    pass
+
+class Transition:
+    """A transition of a state, without target for an internal transition"""
+    def __init__(self, event, target=None, cond=None, action=None):
+        self.event = event              # name of the event
+        self.target = target            # id of the target state, None if internal
+        self.cond = cond                # C expression of the guard, None if none
+        self.action = action            # description of the action, None if no action
+        self.fn = None                  # name of the action function
+
+class State:
+    """A state of the chart"""
+    def __init__(self, sid, parent=None):
+        self.sid = sid                  # id of the state in the chart
+        self.parent = parent            # parent state, None for a top level state
+        self.children = []              # substates in order of declaration
+        self.initial = None             # id of the initial substate
+        self.entry = None               # description of the entry action, None if no action
+        self.exit = None                # description of the exit action, None if no action
+        self.transitions = []           # transitions in order of declaration
+        self.level = 1 if parent is None else parent.level + 1
+        if parent:
+            parent.children.append(self)
+
+    def Path(self):
+        """This returns the states from the top level state down to this state"""
+        return (self.parent.Path() if self.parent else []) + [self]
+
+class Chart:
+    """The states of a chart"""
+    def __init__(self):
+        self.states = {}                # states by id
+        self.order = []                 # states in order of declaration
+        self.top = []                   # top level states
+        self.initial = None             # id of the initial state
+        self.events = []                # events in order of first use
+
+    def AddState(self, sid, parent=None):
+        """This adds a state to the chart"""
+        if sid in self.states:
+            raise ChartError("state %s declared twice" % sid)
+        state = State(sid, parent)
+        self.states[sid] = state
+        self.order.append(state)
+        if parent is None:
+            self.top.append(state)
+        return state
+
+    def AddTransition(self, state, transition):
+        """This adds a transition to a state"""
+        if transition.event not in self.events:
+            self.events.append(transition.event)
+        state.transitions.append(transition)
+
+    def Resolve(self, sid, where):
+        """This returns the state of an id"""
+        if sid not in self.states:
+            raise ChartError("unknown state %s in %s" % (sid, where))
+        return self.states[sid]
+
+    def Check(self):
+        """This checks the chart and fills the default initial states"""
+        if not self.top:
+            raise ChartError("the chart has no state")
+        if self.initial is None:
+            self.initial = self.top[0].sid
+        self.Resolve(self.initial, "initial state of the chart")
+        for state in self.order:
+            if state.children:
+                if state.initial is None:
+                    state.initial = state.children[0].sid
+                if self.Resolve(state.initial, "initial state of " + state.sid).parent is not state:
+                    raise ChartError("initial state %s is not a substate of %s" % (state.initial, state.sid))
+            for transition in state.transitions:
+                if transition.target is not None:
+                    self.Resolve(transition.target, "transition of " + state.sid)
+                if not re.match(r"^[A-Za-z_][A-Za-z0-9_]*$", transition.event):
+                    raise ChartError("event %s of %s is not a C identifier" % (transition.event, state.sid))
+
+    def Leaf(self, state):
+        """This returns the initial states entered from a state, innermost first"""
+        entries = []
+        while state.children:
+            state = self.states[state.initial]
+            entries.insert(0, state)
+        return entries
+
+#----Parsers----
+def Text(element):
+    """This returns the executable content of an SCXML element as a single line"""
+    parts = [element.text or ""] + [ET.tostring(child, encoding="unicode") for child in element]
+    return re.sub(r"\s*xmlns(:\w+)?=\"[^\"]*\"", "", " ".join(" ".join(parts).split())) or None
+
+def ParseScxml(path):
+    """This reads an SCXML chart"""
+    chart = Chart()
+    root = ET.parse(path).getroot()
+    tag = lambda element: element.tag.split("}")[-1]
+    def Parse(element, parent):
+        for child in element:
+            if tag(child) in ("parallel", "history", "final"):
+                raise ChartError("<%s> is not supported" % tag(child))
+            if tag(child) != "state":
+                continue
+            if "id" not in child.attrib:
+                raise ChartError("<state> without id")
+            state = chart.AddState(child.attrib["id"], parent)
+            state.initial = child.attrib.get("initial")
+            for item in child:
+                if tag(item) == "initial":
+                    state.initial = [t for t in item if tag(t) == "transition"][0].attrib["target"]
+                elif tag(item) == "onentry":
+                    state.entry = Text(item) or "entry"
+                elif tag(item) == "onexit":
+                    state.exit = Text(item) or "exit"
+                elif tag(item) == "transition":
+                    if "event" not in item.attrib:
+                        raise ChartError("transition without event in %s is not supported" % state.sid)
+                    for event in item.attrib["event"].split():
+                        chart.AddTransition(state, Transition(event, item.attrib.get("target"),
+                                                              item.attrib.get("cond"), Text(item)))
+            Parse(child, state)
+    if tag(root) != "scxml":
+        raise ChartError("%s is not an SCXML document" % path)
+    Parse(root, None)
+    chart.initial = root.attrib.get("initial")
+    return chart
+
+def ParsePlantUml(path):
+    """This reads a chart in a subset of PlantUML"""
+    chart = Chart()
+    scope = [None]
+    initials = []
+    def Get(sid):
+        return chart.states[sid] if sid in chart.states else chart.AddState(sid, scope[-1])
+    def Label(label):
+        # EVENT [cond] / action
+        match = re.match(r"^\s*([^\s\[/]+)?\s*(?:\[(.*)\])?\s*(?:/\s*(.*))?$", label or "")
+        if not match or not match.group(1):
+            raise ChartError("missing event in '%s'" % label)
+        return match.group(1), match.group(2), (match.group(3) or "").strip() or None
+    for number, line in enumerate(open(path), 1):
+        line = line.strip()
+        where = "%s:%d" % (path, number)
+        if not line or line.startswith("'") or line.startswith("@") or line.startswith("hide ") or line.startswith("skinparam"):
+            continue
+        match = re.match(r"^state\s+(?:\"[^\"]*\"\s+as\s+)?([\w.]+)\s*(\{)?\s*$", line)
+        if match:
+            state = Get(match.group(1))
+            if match.group(2):
+                scope.append(state)
+            continue
+        if line == "}":
+            if len(scope) == 1:
+                raise ChartError("%s: unbalanced }" % where)
+            scope.pop()
+            continue
+        match = re.match(r"^(\[\*\]|[\w.]+)\s*-+(?:\w+-+)?>\s*(\[\*\]|[\w.]+)\s*(?::\s*(.*))?$", line)
+        if match:
+            src, dst, label = match.groups()
+            if dst == "[*]":
+                raise ChartError("%s: final states are not supported" % where)
+            if src == "[*]":
+                initials.append((scope[-1], dst))
+                Get(dst)
+                continue
+            event, cond, action = Label(label)
+            chart.AddTransition(Get(src), Transition(event, Get(dst).sid, cond, action))
+            continue
+        match = re.match(r"^([\w.]+)\s*:\s*(.*)$", line)
+        if match:
+            state = Get(match.group(1))
+            event, cond, action = Label(match.group(2))
+            if event == "entry":
+                state.entry = action or "entry"
+            elif event == "exit":
+                state.exit = action or "exit"
+            else:
+                chart.AddTransition(state, Transition(event, None, cond, action or event))
+            continue
+        raise ChartError("%s: cannot parse '%s'" % (where, line))
+    for parent, sid in initials:
+        if parent is None:
+            chart.initial = sid
+        else:
+            parent.initial = sid
+    return chart
+
+#----Code generator----
+def Fnv(name):
+    """This returns HSM_RECORD_StateId() of a state name"""
+    value = 2166136261
+    for byte in name.encode():
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value or 1
+
+class Generator:
+    """Generates the C code of a chart"""
+    def __init__(self, chart, prefix, base):
+        self.chart = chart
+        self.prefix = prefix
+        self.base = base
+        self.paths = {}                 # path name to (exits, entries, target)
+        for state in chart.order:
+            state.cname = "".join(re.sub(r"\W", "_", s.sid[:1].upper() + s.sid[1:]) for s in state.Path())
+            state.name = ".".join(s.sid for s in state.Path())
+            count = {}
+            for transition in state.transitions:
+                if transition.action or transition.target is None:
+                    count[transition.event] = count.get(transition.event, 0) + 1
+                    suffix = "" if count[transition.event] == 1 else str(count[transition.event])
+                    transition.fn = "%s_%s_%s%s" % (prefix, state.cname, transition.event, suffix)
+
+    def StateVar(self, state):
+        return "%s_State%s" % (self.prefix, state.cname)
+
+    def Path(self, leaf, target):
+        """This returns the name of the precomputed path of a transition from a leaf state"""
+        name = "%s_Tran%s_%s" % (self.prefix, leaf.cname, target.cname)
+        if name not in self.paths:
+            # Same path as HSM_Tran() from the leaf state, then the initial substates
+            src, dst = leaf, target
+            exits, entries = [], []
+            while src is not None and dst is not None and src.level != dst.level:
+                if src.level > dst.level:
+                    exits.append(src)
+                    src = src.parent
+                else:
+                    entries.append(dst)
+                    dst = dst.parent
+            while src is not dst:
+                exits.append(src)
+                src = src.parent
+                entries.append(dst)
+                dst = dst.parent
+            entries = self.chart.Leaf(target) + entries
+            self.paths[name] = (exits, entries, target)
+        return name
+
+    def Header(self):
+        guard = "__%s_H__" % re.sub(r"\W", "_", os.path.basename(self.base)).upper()
+        out = ["// Generated by hsmgen.py, do not edit", "#ifndef " + guard, "#define " + guard, "",
+               '#include "hsm.h"', "", "#ifdef __cplusplus", 'extern "C" {', "#endif", "", "//----Events----"]
+        for idx, event in enumerate(self.chart.events):
+            out.append("#define HSME_%-16s (HSME_START%s)" % (event, " + %d" % idx if idx else ""))
+        out += ["", "//----States----"]
+        out += ["extern HSM_STATE %s;" % self.StateVar(state) for state in self.chart.order]
+        out += ["", "//----Function Declarations----",
+                "// Func: void %s_Create(HSM *This, const char *name)" % self.prefix,
+                "// Desc: Create an HSM instance of the chart in its initial state",
+                "// This: Pointer to HSM instance", "// name: Name of state machine (for debugging)",
+                "void %s_Create(HSM *This, const char *name);" % self.prefix, "",
+                "//----Actions to implement----"]
+        out += ["void %s(HSM *This, void *param);" % fn for fn, _ in self.Actions()]
+        out += ["", "#ifdef __cplusplus", "}", "#endif", "", "#endif // " + guard, ""]
+        return "\n".join(out)
+
+    def Actions(self):
+        """This returns the action functions with their description"""
+        actions = []
+        for state in self.chart.order:
+            if state.entry:
+                actions.append(("%s_%sEntry" % (self.prefix, state.cname), "%s entry: %s" % (state.name, state.entry)))
+            if state.exit:
+                actions.append(("%s_%sExit" % (self.prefix, state.cname), "%s exit: %s" % (state.name, state.exit)))
+            for transition in state.transitions:
+                if transition.fn:
+                    actions.append((transition.fn, "%s %s%s: %s" % (state.name, transition.event,
+                                    " [%s]" % transition.cond if transition.cond else "", transition.action or "")))
+        return actions
+
+    def Transition(self, leaf, transition, indent):
+        """This returns the code of a transition taken from a leaf state"""
+        fn = transition.fn or "((void *)0)"
+        if transition.target is None:
+            return [indent + "%s(This, param);" % fn]
+        target = self.chart.states[transition.target]
+        name = self.Path(leaf, target)
+        exits, entries, _ = self.paths[name]
+        # The innermost state entered, or the leaf state itself for a self transition
+        nextState = entries[0] if entries else target
+        return [indent + "HSM_TranDirect(This, &%s, %s, %d, %d, param, %s);" %
+                (self.StateVar(nextState), name, len(exits), len(entries), fn)]
+
+    def Handler(self, state):
+        out = ["static HSM_EVENT %sHndlr(HSM *This, HSM_EVENT event, void *param)" % self.StateVar(state), "{",
+               "    switch (event)", "    {"]
+        if state.entry:
+            out += ["    case HSME_ENTRY:", "        %s_%sEntry(This, param);" % (self.prefix, state.cname), "        break;"]
+        if state.exit:
+            out += ["    case HSME_EXIT:", "        %s_%sExit(This, param);" % (self.prefix, state.cname), "        break;"]
+        if state.children:
+            # Reached by HSM_Create() or HSM_Tran() to this state, transitions go straight to a leaf state
+            leaf = self.chart.Leaf(state)
+            name = self.Path(state, leaf[0])
+            out += ["    case HSME_INIT:",
+                    "        HSM_TranDirect(This, &%s, %s, 0, %d, param, ((void *)0));" %
+                    (self.StateVar(leaf[0]), name, len(self.paths[name][1])), "        break;"]
+        else:
+            # Flattened: the events of the parent states are handled here, innermost state first
+            for event in self.chart.events:
+                candidates = [t for s in reversed(state.Path()) for t in s.transitions if t.event == event]
+                if not candidates:
+                    continue
+                out.append("    case HSME_%s:" % event)
+                for transition in candidates:
+                    if transition.cond:
+                        out += ["        if (%s)" % transition.cond, "        {"]
+                        out += self.Transition(state, transition, "            ")
+                        out += ["            return HSME_NULL;", "        }"]
+                    else:
+                        out += self.Transition(state, transition, "        ")
+                        out.append("        return HSME_NULL;")
+                        break
+                else:
+                    out.append("        break;")
+        out += ["    default:", "        break;", "    }", "    return event;", "}", ""]
+        return out
+
+    def Source(self):
+        header = os.path.basename(self.base) + ".h"
+        out = ["// Generated by hsmgen.py, do not edit", '#include "%s"' % header, ""]
+        out += ["static HSM_EVENT %sHndlr(HSM *This, HSM_EVENT event, void *param);" % self.StateVar(state)
+                for state in self.chart.order]
+        out.append("")
+        for state in self.chart.order:
+            parent = "&" + self.StateVar(state.parent) if state.parent else "(HSM_STATE *)&HSM_ROOT"
+            out.append('HSM_STATE %s = HSM_STATE_INIT("%s", %sHndlr, %s, %d, 0x%08XUL);' %
+                       (self.StateVar(state), state.name, self.StateVar(state), parent, state.level, Fnv(state.name)))
+        out.append("")
+        handlers = []
+        for state in self.chart.order:
+            handlers += self.Handler(state)
+        # Paths are collected while generating the handlers
+        out.append("// Precomputed paths: states to exit innermost first, then states to enter innermost first")
+        for name, (exits, entries, target) in self.paths.items():
+            states = exits + entries or [target]
+            out.append("static HSM_STATE * const %s[] = { %s };" % (name, ", ".join("&" + self.StateVar(s) for s in states)))
+        out.append("")
+        out += handlers
+        out += ["void %s_Create(HSM *This, const char *name)" % self.prefix, "{",
+                "    HSM_Create(This, name, &%s);" % self.StateVar(self.chart.states[self.chart.initial]), "}", ""]
+        return "\n".join(out)
+
+    def Stubs(self):
+        out = ['#include "%s.h"' % os.path.basename(self.base), ""]
+        for fn, description in self.Actions():
+            out += ["// %s" % description, "void %s(HSM *This, void *param)" % fn, "{", "}", ""]
+        return "\n".join(out)
+
+def Write(path, text):
+    """This writes a file only if its content changed, so make does not rebuild needlessly"""
+    if os.path.exists(path) and open(path).read() == text:
+        return
+    with open(path, "w") as out:
+        out.write(text)
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the C code of an HSM chart")
+    parser.add_argument("chart", help="chart in SCXML (.scxml) or PlantUML (.puml)")
+    parser.add_argument("-p", "--prefix", help="prefix of the generated names (default: name of the chart)")
+    parser.add_argument("-o", "--out", help="base name of the generated files (default: <chart>_chart)")
+    parser.add_argument("-s", "--stubs", action="store_true", help="write <out>_actions.c if it does not exist")
+    args = parser.parse_args()
+    name = os.path.splitext(os.path.basename(args.chart))[0]
+    base = args.out or os.path.splitext(args.chart)[0] + "_chart"
+    try:
+        if args.chart.endswith(".puml") or args.chart.endswith(".plantuml"):
+            chart = ParsePlantUml(args.chart)
+        else:
+            chart = ParseScxml(args.chart)
+            name = ET.parse(args.chart).getroot().attrib.get("name", name)
+        chart.Check()
+    except (ChartError, ET.ParseError, OSError) as error:
+        sys.stderr.write("hsmgen: %s\n" % error)
+        return 1
+    generator = Generator(chart, args.prefix or re.sub(r"\W", "_", name).upper(), base)
+    source = generator.Source()
+    Write(base + ".h", generator.Header())
+    Write(base + ".c", source)
+    if args.stubs and not os.path.exists(base + "_actions.c"):
+        Write(base + "_actions.c", generator.Stubs())
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,47 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef __HSMC_H__
+#define __HSMC_H__
+
+// C API of the hsmc Python module, for C state handlers registered with HSM.CreateState().
+// The module is built with its own copy of hsm.c, so C handlers must call the core through this table:
+//     HSMC_API *api = (HSMC_API *)PyCapsule_Import("hsmc.api", 0);
+//     ..
+//     api->tran(This, api->state(stateObject), 0, NULL);
+#include "hsm.h"
+
+#define HSMC_API_CAPSULE        "hsmc.api"
+#define HSMC_HNDLR_CAPSULE      "hsmc.handler"
+
+typedef struct HSMC_API_T
+{
+    void (*tran)(HSM *This, HSM_STATE *nextState, void *param, void (*method)(HSM *This, void *param));
+    void (*run)(HSM *This, HSM_EVENT event, void *param);
+    uint8_t (*isInState)(HSM *This, HSM_STATE *state);
+    HSM_STATE *(*state)(void *stateObject);     // HSM_STATE of an hsmc.State object, NULL if not a state
+    HSM *(*hsm)(void *hsmObject);               // HSM of an hsmc.HSM object, NULL if not an HSM
+} HSMC_API;
+
+#endif // __HSMC_H__
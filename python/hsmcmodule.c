@@ -0,0 +1,628 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2018 Howard Chan
+https://github.com/howard-chan/HSM
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// Python 3 bindings of hsm.c with the API of hsm.py: a class derived from hsmc.HSM creates its states with
+// CreateState() and runs them with Run() and Tran().  The dispatch runs in hsm.c and only calls the Python
+// handlers, run_many() dispatches a sequence of events without returning to the interpreter in between, and a
+// hot state can have a C handler (see hsmc.h).  Built with HSM_FEATURE_HNDLR_STATE so a single C handler
+// calls the Python handler of each state.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
+#include "hsmc.h"
+
+#if !HSM_FEATURE_HNDLR_STATE
+#error "hsmc requires HSM_FEATURE_HNDLR_STATE"
+#endif // !HSM_FEATURE_HNDLR_STATE
+
+// Events of hsm.py, the Python events from HSMC_EVT_FIRST are passed to hsm.c unchanged
+#define HSMC_EVT_INIT           1
+#define HSMC_EVT_ENTRY          2
+#define HSMC_EVT_EXIT           3
+#define HSMC_EVT_FIRST          4
+// Events that are not integers (e.g. strings) are numbered from HSMC_EVT_OBJECT
+#define HSMC_EVT_OBJECT         0x80000000UL
+#define HSMC_EVT_OBJECT_MAX     (HSME_INIT - HSMC_EVT_OBJECT)
+
+typedef struct HSMC_STATE_T
+{
+    PyObject_HEAD
+    HSM_STATE state;            // State run by hsm.c
+    PyObject *name;             // Name of the state
+    PyObject *handler;          // Python handler, None for a C handler
+    PyObject *parent;           // Parent state, None for a top level state
+} HSMC_STATE;
+
+typedef struct HSMC_T
+{
+    PyObject_HEAD
+    HSM hsm;                    // Instance run by hsm.c
+    PyObject *name;             // Name of the instance
+    PyObject *states;           // States created by the instance
+    PyObject *method;           // Method of the transition in progress
+    PyObject *excType;          // Exception raised by a handler, until the call from Python returns
+    PyObject *excValue;
+    PyObject *excTb;
+} HSMC;
+
+static PyTypeObject HSMC_StateType;
+static PyTypeObject HSMC_Type;
+static PyObject *pstEvtIds;     // Event object to its number
+static PyObject *pstEvtObjs;    // Event objects by number from HSMC_EVT_OBJECT
+
+#define HSMC_OF(This)           ((HSMC *)((char *)(This) - offsetof(HSMC, hsm)))
+#define HSMC_STATE_OF(st)       ((HSMC_STATE *)((char *)(st) - offsetof(HSMC_STATE, state)))
+
+//----Events----
+static int HSMC_ToEvent(PyObject *obj, HSM_EVENT *event)
+{
+    PyObject *id;
+    if (PyLong_Check(obj))
+    {
+        unsigned long value = PyLong_AsUnsignedLong(obj);
+        if ((value == (unsigned long)-1 && PyErr_Occurred()) || value < HSMC_EVT_FIRST || value >= HSMC_EVT_OBJECT)
+        {
+            PyErr_Clear();
+            PyErr_Format(PyExc_ValueError, "integer events must be from %d to %lu", HSMC_EVT_FIRST,
+                         HSMC_EVT_OBJECT - 1);
+            return -1;
+        }
+        *event = (HSM_EVENT)value;
+        return 0;
+    }
+    id = PyDict_GetItemWithError(pstEvtIds, obj);
+    if (id)
+    {
+        *event = (HSM_EVENT)PyLong_AsUnsignedLong(id);
+        return 0;
+    }
+    if (PyErr_Occurred())
+    {
+        return -1;
+    }
+    // First use of the event
+    if (PyList_GET_SIZE(pstEvtObjs) >= (Py_ssize_t)HSMC_EVT_OBJECT_MAX)
+    {
+        PyErr_SetString(PyExc_OverflowError, "too many events");
+        return -1;
+    }
+    *event = (HSM_EVENT)(HSMC_EVT_OBJECT + PyList_GET_SIZE(pstEvtObjs));
+    id = PyLong_FromUnsignedLong(*event);
+    if (!id || PyDict_SetItem(pstEvtIds, obj, id) < 0 || PyList_Append(pstEvtObjs, obj) < 0)
+    {
+        Py_XDECREF(id);
+        return -1;
+    }
+    Py_DECREF(id);
+    return 0;
+}
+
+static PyObject *HSMC_FromEvent(HSM_EVENT event)
+{
+    switch (event)
+    {
+    case HSME_INIT:
+        return PyLong_FromLong(HSMC_EVT_INIT);
+    case HSME_ENTRY:
+        return PyLong_FromLong(HSMC_EVT_ENTRY);
+    case HSME_EXIT:
+        return PyLong_FromLong(HSMC_EVT_EXIT);
+    }
+    if (event >= HSMC_EVT_OBJECT)
+    {
+        PyObject *obj = PyList_GET_ITEM(pstEvtObjs, event - HSMC_EVT_OBJECT);
+        Py_INCREF(obj);
+        return obj;
+    }
+    return PyLong_FromUnsignedLong(event);
+}
+
+//----Handlers called by hsm.c----
+// Keeps the first exception of a handler, raised once the call from Python returns
+static void HSMC_Fail(HSMC *self)
+{
+    if (self->excType)
+    {
+        PyErr_Clear();
+        return;
+    }
+    PyErr_Fetch(&self->excType, &self->excValue, &self->excTb);
+}
+
+static PyObject *HSMC_Raise(HSMC *self)
+{
+    PyErr_Restore(self->excType, self->excValue, self->excTb);
+    self->excType = self->excValue = self->excTb = NULL;
+    return NULL;
+}
+
+static HSM_EVENT HSMC_Hndlr(HSM *This, HSM_EVENT event, void *param)
+{
+    HSMC *self = HSMC_OF(This);
+    HSMC_STATE *state = HSMC_STATE_OF(HSM_GET_HNDLR_STATE(This));
+    PyObject *arg;
+    PyObject *ret;
+    HSM_EVENT next = HSME_NULL;
+
+    if (self->excType)
+    {
+        // Stop the dispatch once a handler failed
+        return HSME_NULL;
+    }
+    arg = HSMC_FromEvent(event);
+    if (!arg)
+    {
+        HSMC_Fail(self);
+        return HSME_NULL;
+    }
+    ret = PyObject_CallOneArg(state->handler, arg);
+    if (!ret)
+    {
+        HSMC_Fail(self);
+    }
+    else if (ret == arg)
+    {
+        // Passed to the parent state
+        next = event;
+    }
+    else if (ret != Py_None && HSMC_ToEvent(ret, &next) < 0)
+    {
+        HSMC_Fail(self);
+        next = HSME_NULL;
+    }
+    Py_XDECREF(ret);
+    Py_DECREF(arg);
+    return next;
+}
+
+static void HSMC_Method(HSM *This, void *param)
+{
+    HSMC *self = HSMC_OF(This);
+    PyObject *ret;
+    if (!self->excType)
+    {
+        ret = PyObject_CallNoArgs(self->method);
+        if (!ret)
+        {
+            HSMC_Fail(self);
+        }
+        Py_XDECREF(ret);
+    }
+}
+
+//----State----
+static int HSMC_StateTraverse(HSMC_STATE *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->handler);
+    Py_VISIT(self->parent);
+    return 0;
+}
+
+static int HSMC_StateClear(HSMC_STATE *self)
+{
+    Py_CLEAR(self->handler);
+    Py_CLEAR(self->parent);
+    return 0;
+}
+
+static void HSMC_StateDealloc(HSMC_STATE *self)
+{
+    PyObject_GC_UnTrack(self);
+    HSMC_StateClear(self);
+    Py_XDECREF(self->name);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *HSMC_StateGetLevel(HSMC_STATE *self, void *closure)
+{
+    return PyLong_FromLong(self->state.level);
+}
+
+static PyObject *HSMC_StateRepr(HSMC_STATE *self)
+{
+    return PyUnicode_FromFormat("<hsmc.State %U>", self->name);
+}
+
+static PyMemberDef astStateMembers[] =
+{
+    { "name", T_OBJECT, offsetof(HSMC_STATE, name), READONLY, "name of state" },
+    { "handler", T_OBJECT, offsetof(HSMC_STATE, handler), READONLY, "associated event handler for state" },
+    { "parent", T_OBJECT, offsetof(HSMC_STATE, parent), READONLY, "parent state" },
+    { NULL }
+};
+
+static PyGetSetDef astStateGetSet[] =
+{
+    { "level", (getter)HSMC_StateGetLevel, NULL, "depth level of the state", NULL },
+    { NULL }
+};
+
+static PyTypeObject HSMC_StateType =
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "hsmc.State",
+    .tp_basicsize = sizeof(HSMC_STATE),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_doc = "State of an hsmc.HSM, created by HSM.CreateState()",
+    .tp_dealloc = (destructor)HSMC_StateDealloc,
+    .tp_traverse = (traverseproc)HSMC_StateTraverse,
+    .tp_clear = (inquiry)HSMC_StateClear,
+    .tp_repr = (reprfunc)HSMC_StateRepr,
+    .tp_members = astStateMembers,
+    .tp_getset = astStateGetSet,
+};
+
+//----HSM----
+static PyObject *HSMC_New(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    HSMC *self = (HSMC *)type->tp_alloc(type, 0);
+    if (!self)
+    {
+        return NULL;
+    }
+    self->states = PyList_New(0);
+    self->name = PyUnicode_FromString("");
+    if (!self->states || !self->name)
+    {
+        Py_DECREF(self);
+        return NULL;
+    }
+    // Like hsm.py, the instance starts in the root state until SetInitState()
+    HSM_Restore(&self->hsm, "", (HSM_STATE *)&HSM_ROOT);
+    return (PyObject *)self;
+}
+
+static int HSMC_Init(HSMC *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = { "name", NULL };
+    PyObject *name = NULL;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|U", kwlist, &name))
+    {
+        return -1;
+    }
+    if (name)
+    {
+        Py_INCREF(name);
+        Py_SETREF(self->name, name);
+    }
+    return 0;
+}
+
+static int HSMC_Traverse(HSMC *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->states);
+    Py_VISIT(self->method);
+    Py_VISIT(self->excType);
+    Py_VISIT(self->excValue);
+    Py_VISIT(self->excTb);
+    return 0;
+}
+
+static int HSMC_Clear(HSMC *self)
+{
+    Py_CLEAR(self->states);
+    Py_CLEAR(self->method);
+    Py_CLEAR(self->excType);
+    Py_CLEAR(self->excValue);
+    Py_CLEAR(self->excTb);
+    return 0;
+}
+
+static void HSMC_Dealloc(HSMC *self)
+{
+    PyObject_GC_UnTrack(self);
+    HSMC_Clear(self);
+    Py_XDECREF(self->name);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *HSMC_CreateState(HSMC *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = { "name", "handler", "parent", NULL };
+    PyObject *name;
+    PyObject *handler;
+    PyObject *parent = Py_None;
+    HSMC_STATE *state;
+    HSM_FN fn = HSMC_Hndlr;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "UO|O", kwlist, &name, &handler, &parent))
+    {
+        return NULL;
+    }
+    if (parent != Py_None && !PyObject_TypeCheck(parent, &HSMC_StateType))
+    {
+        PyErr_SetString(PyExc_TypeError, "The parent is not a State");
+        return NULL;
+    }
+    if (parent != Py_None && ((HSMC_STATE *)parent)->state.level + 1 >= HSM_MAX_DEPTH)
+    {
+        PyErr_Format(PyExc_ValueError, "States are nested deeper than HSM_MAX_DEPTH %d", HSM_MAX_DEPTH);
+        return NULL;
+    }
+    if (PyCapsule_IsValid(handler, HSMC_HNDLR_CAPSULE))
+    {
+        // C handler of a hot state
+        fn = (HSM_FN)PyCapsule_GetPointer(handler, HSMC_HNDLR_CAPSULE);
+    }
+    else if (PyLong_Check(handler))
+    {
+        // Address of a C handler, e.g. from ctypes
+        fn = (HSM_FN)PyLong_AsVoidPtr(handler);
+        if (!fn)
+        {
+            PyErr_SetString(PyExc_ValueError, "NULL handler");
+            return NULL;
+        }
+    }
+    else if (!PyCallable_Check(handler))
+    {
+        PyErr_SetString(PyExc_TypeError, "The handler is not callable, an hsmc.handler capsule or an address");
+        return NULL;
+    }
+    state = PyObject_GC_New(HSMC_STATE, &HSMC_StateType);
+    if (!state)
+    {
+        return NULL;
+    }
+    Py_INCREF(name);
+    Py_INCREF(parent);
+    state->name = name;
+    state->parent = parent;
+    state->handler = (fn == HSMC_Hndlr) ? handler : Py_None;
+    Py_INCREF(state->handler);
+    HSM_STATE_Create(&state->state, PyUnicode_AsUTF8(name), fn,
+                     (parent == Py_None) ? ((void *)0) : &((HSMC_STATE *)parent)->state);
+    PyObject_GC_Track(state);
+    // The instance keeps its states, as the states of hsm.c are never destroyed
+    if (PyList_Append(self->states, (PyObject *)state) < 0)
+    {
+        Py_DECREF(state);
+        return NULL;
+    }
+    return (PyObject *)state;
+}
+
+static int HSMC_CheckState(HSMC *self, PyObject *state)
+{
+    if (!PyObject_TypeCheck(state, &HSMC_StateType))
+    {
+        PyErr_SetString(PyExc_TypeError, "This is not a HSM State");
+        return -1;
+    }
+    return 0;
+}
+
+static PyObject *HSMC_SetInitState(HSMC *self, PyObject *state)
+{
+    if (HSMC_CheckState(self, state) < 0)
+    {
+        return NULL;
+    }
+    HSM_Restore(&self->hsm, PyUnicode_AsUTF8(self->name), &((HSMC_STATE *)state)->state);
+    Py_RETURN_NONE;
+}
+
+static PyObject *HSMC_GetState(HSMC *self, PyObject *unused)
+{
+    HSM_STATE *state = HSM_GetState(&self->hsm);
+    if (state == &HSM_ROOT)
+    {
+        Py_RETURN_NONE;
+    }
+    Py_INCREF(HSMC_STATE_OF(state));
+    return (PyObject *)HSMC_STATE_OF(state);
+}
+
+static PyObject *HSMC_IsInState(HSMC *self, PyObject *state)
+{
+    if (HSMC_CheckState(self, state) < 0)
+    {
+        return NULL;
+    }
+    return PyBool_FromLong(HSM_IsInState(&self->hsm, &((HSMC_STATE *)state)->state));
+}
+
+static PyObject *HSMC_Run(HSMC *self, PyObject *event)
+{
+    HSM_EVENT evt;
+    if (HSMC_ToEvent(event, &evt) < 0)
+    {
+        return NULL;
+    }
+    HSM_Run(&self->hsm, evt, ((void *)0));
+    if (self->excType)
+    {
+        return HSMC_Raise(self);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *HSMC_RunMany(HSMC *self, PyObject *events)
+{
+    PyObject *seq = PySequence_Fast(events, "events must be iterable");
+    Py_ssize_t idx;
+    Py_ssize_t count;
+    HSM_EVENT evt;
+
+    if (!seq)
+    {
+        return NULL;
+    }
+    count = PySequence_Fast_GET_SIZE(seq);
+    for (idx = 0; idx < count; idx++)
+    {
+        if (HSMC_ToEvent(PySequence_Fast_GET_ITEM(seq, idx), &evt) < 0)
+        {
+            break;
+        }
+        HSM_Run(&self->hsm, evt, ((void *)0));
+        if (self->excType)
+        {
+            HSMC_Raise(self);
+            break;
+        }
+    }
+    Py_DECREF(seq);
+    if (idx < count)
+    {
+        return NULL;
+    }
+    return PyLong_FromSsize_t(count);
+}
+
+static PyObject *HSMC_Tran(HSMC *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = { "nextState", "method", NULL };
+    PyObject *state;
+    PyObject *method = Py_None;
+    PyObject *outer;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O", kwlist, &state, &method) || HSMC_CheckState(self, state) < 0)
+    {
+        return NULL;
+    }
+    if (method != Py_None && !PyCallable_Check(method))
+    {
+        // Same as hsm.py, which ignores a method that is not callable
+        method = Py_None;
+    }
+    // A handler may call Tran() from HSME_INIT during the transition
+    outer = self->method;
+    Py_INCREF(method);
+    self->method = method;
+    HSM_Tran(&self->hsm, &((HSMC_STATE *)state)->state, ((void *)0), (method != Py_None) ? HSMC_Method : ((void *)0));
+    self->method = outer;
+    Py_DECREF(method);
+    // Raised by the outermost call from Python, as a failing handler returns HSME_NULL to hsm.c
+    if (self->excType && !outer)
+    {
+        return HSMC_Raise(self);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef astHsmMethods[] =
+{
+    { "CreateState", (PyCFunction)(void (*)(void))HSMC_CreateState, METH_VARARGS | METH_KEYWORDS,
+      "CreateState(name, handler, parent=None) adds a state to the HSM.  handler is a callable taking the event, "
+      "or a C handler as an hsmc.handler capsule or an address" },
+    { "SetInitState", (PyCFunction)HSMC_SetInitState, METH_O, "SetInitState(state) sets the initial HSM state" },
+    { "GetState", (PyCFunction)HSMC_GetState, METH_NOARGS, "GetState() returns the current HSM state" },
+    { "IsInState", (PyCFunction)HSMC_IsInState, METH_O, "IsInState(state) tests whether HSM is in state or parent state" },
+    { "Run", (PyCFunction)HSMC_Run, METH_O, "Run(event) runs the HSM with event" },
+    { "run_many", (PyCFunction)HSMC_RunMany, METH_O,
+      "run_many(events) runs the HSM with each event of a sequence, returns the number of events" },
+    { "Tran", (PyCFunction)(void (*)(void))HSMC_Tran, METH_VARARGS | METH_KEYWORDS,
+      "Tran(nextState, method=None) performs the state transition with calls of exit, entry and init" },
+    { NULL }
+};
+
+static PyMemberDef astHsmMembers[] =
+{
+    { "name", T_OBJECT, offsetof(HSMC, name), READONLY, "name of the HSM" },
+    { NULL }
+};
+
+static PyTypeObject HSMC_Type =
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "hsmc.HSM",
+    .tp_basicsize = sizeof(HSMC),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,
+    .tp_doc = "HSM(name='') runs a hierarchical state machine in hsm.c, derive it like hsm.HSM",
+    .tp_new = HSMC_New,
+    .tp_init = (initproc)HSMC_Init,
+    .tp_dealloc = (destructor)HSMC_Dealloc,
+    .tp_traverse = (traverseproc)HSMC_Traverse,
+    .tp_clear = (inquiry)HSMC_Clear,
+    .tp_methods = astHsmMethods,
+    .tp_members = astHsmMembers,
+};
+
+//----C API----
+static HSM_STATE *HSMC_ApiState(void *stateObject)
+{
+    return PyObject_TypeCheck((PyObject *)stateObject, &HSMC_StateType) ? &((HSMC_STATE *)stateObject)->state : ((void *)0);
+}
+
+static HSM *HSMC_ApiHsm(void *hsmObject)
+{
+    return PyObject_TypeCheck((PyObject *)hsmObject, &HSMC_Type) ? &((HSMC *)hsmObject)->hsm : ((void *)0);
+}
+
+static HSMC_API stHsmcApi =
+{
+    .tran = HSM_Tran,
+    .run = HSM_Run,
+    .isInState = HSM_IsInState,
+    .state = HSMC_ApiState,
+    .hsm = HSMC_ApiHsm,
+};
+
+//----Module----
+static struct PyModuleDef stHsmcModule =
+{
+    PyModuleDef_HEAD_INIT,
+    .m_name = "hsmc",
+    .m_doc = "Python bindings of the HSM framework in hsm.c, with the API of hsm.py",
+    .m_size = -1,
+};
+
+PyMODINIT_FUNC PyInit_hsmc(void)
+{
+    PyObject *module;
+    PyObject *event;
+    PyObject *api;
+
+    if (PyType_Ready(&HSMC_StateType) < 0 || PyType_Ready(&HSMC_Type) < 0)
+    {
+        return NULL;
+    }
+    module = PyModule_Create(&stHsmcModule);
+    if (!module)
+    {
+        return NULL;
+    }
+    pstEvtIds = PyDict_New();
+    pstEvtObjs = PyList_New(0);
+    // Same events as hsm.HSM_Event
+    event = PyObject_CallFunction((PyObject *)&PyType_Type, "s()N", "HSM_Event",
+                                 Py_BuildValue("{s:i,s:i,s:i,s:i,s:s}", "INIT", HSMC_EVT_INIT, "ENTRY", HSMC_EVT_ENTRY,
+                                               "EXIT", HSMC_EVT_EXIT, "FIRST", HSMC_EVT_FIRST, "__module__", "hsmc"));
+    api = PyCapsule_New(&stHsmcApi, HSMC_API_CAPSULE, NULL);
+    if (!pstEvtIds || !pstEvtObjs || !event || !api ||
+        PyModule_AddObjectRef(module, "HSM_Event", event) < 0 ||
+        PyModule_AddObjectRef(module, "HSM", (PyObject *)&HSMC_Type) < 0 ||
+        PyModule_AddObjectRef(module, "State", (PyObject *)&HSMC_StateType) < 0 ||
+        PyModule_AddObjectRef(module, "api", api) < 0)
+    {
+        Py_XDECREF(api);
+        Py_XDECREF(event);
+        Py_DECREF(module);
+        return NULL;
+    }
+    Py_DECREF(api);
+    Py_DECREF(event);
+    return module;
+}